@@ -3,6 +3,10 @@
  *
  * Creates /proc/lkp_info that shows module uptime and access count
  * using the seq_file interface.
+ *
+ * percpu_count=1 counts reads in per-CPU counters instead of one global
+ * atomic_t, and stress_ms=N runs a read stress test at load time that
+ * compares the two (results in dmesg).
  */
 #define pr_fmt(fmt) "lkp: " fmt
 
@@ -13,6 +17,15 @@
 #include <linux/seq_file.h>
 #include <linux/jiffies.h>
 #include <linux/atomic.h>
+#include <linux/percpu.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Gabriel Gonzalez");
@@ -25,6 +38,88 @@ static unsigned long load_jiffies;
 
 static atomic_t counter = ATOMIC_INIT(0);  // Create atomic counter belonging to this module
 
+/*
+ * Every reader of an atomic_t pulls its cache line over exclusively, so
+ * with many pollers on different cores the line just bounces between
+ * them.  In per-CPU mode a read only touches this CPU's slot; the total
+ * is summed on read, which only needs the other slots shared.
+ */
+static DEFINE_PER_CPU(unsigned long, percpu_reads);
+
+/* Per-CPU total as of the last switch to atomic mode */
+static unsigned long percpu_folded;
+static DEFINE_MUTEX(mode_lock);
+
+static bool percpu_count;
+
+static unsigned long lkp_info_percpu_sum(void)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu(percpu_reads, cpu);
+	return sum;
+}
+
+/*
+ * Switches the counting mode.  Leaving per-CPU mode folds the slots into
+ * percpu_folded once, so atomic-mode reads stay O(1) and still include
+ * them; readers that saw the old mode just before the fold may be missed
+ * by atomic mode until the next switch.
+ */
+static void lkp_info_set_mode(bool percpu)
+{
+	mutex_lock(&mode_lock);
+	WRITE_ONCE(percpu_count, percpu);
+	if (!percpu)
+		WRITE_ONCE(percpu_folded, lkp_info_percpu_sum());
+	mutex_unlock(&mode_lock);
+}
+
+static int lkp_info_mode_set(const char *val, const struct kernel_param *kp)
+{
+	bool percpu;
+	int err;
+
+	err = kstrtobool(val, &percpu);
+	if (err)
+		return err;
+	lkp_info_set_mode(percpu);
+	return 0;
+}
+
+static const struct kernel_param_ops lkp_info_mode_ops = {
+	.set = lkp_info_mode_set,
+	.get = param_get_bool,
+};
+
+module_param_cb(percpu_count, &lkp_info_mode_ops, &percpu_count, 0644);
+MODULE_PARM_DESC(percpu_count, "Count reads in per-CPU counters instead of one atomic_t (default 0)");
+
+static unsigned int stress_ms;
+module_param(stress_ms, uint, 0444);
+MODULE_PARM_DESC(stress_ms, "At load, run the read stress test for this many ms per step (0 = off)");
+
+static struct task_struct *stress_task;
+
+/*
+ * Bumps the counter in the current mode and returns the total over both
+ * modes, so switching percpu_count at runtime does not lose reads.  Only
+ * per-CPU mode sums the slots; atomic mode adds the total folded at the
+ * last switch.  In per-CPU mode the value is no longer unique to this
+ * reader.
+ */
+static unsigned long lkp_info_count(void)
+{
+	if (!READ_ONCE(percpu_count))
+		return (unsigned int)atomic_inc_return(&counter) +
+		       READ_ONCE(percpu_folded);
+
+	this_cpu_inc(percpu_reads);
+	return lkp_info_percpu_sum() + (unsigned int)atomic_read(&counter);
+}
+
 static int lkp_info_show(struct seq_file *m, void *v)
 {
 	seq_printf(m, "LKP Info Module\n");
@@ -56,10 +151,10 @@ static int lkp_info_show(struct seq_file *m, void *v)
 	This actually could lead to multiple people having the asme value or the otherway around values being skipped 
 	so the following is better
 	*/
-    int val = atomic_inc_return(&counter);
+    unsigned long val = lkp_info_count();
 
 	seq_printf(m, "Access count: ");
-	seq_printf(m,"%d\n", val);
+	seq_printf(m,"%lu\n", val);
 	seq_printf(m, "\n");
 	//Increment atomically. Honestly may have changed values at this point but doesnt matter since 
 	// we are done reading it. 
@@ -72,13 +167,165 @@ static int lkp_info_open(struct inode *inode, struct file *file)
 	return single_open(file, lkp_info_show, NULL);
 }
 
+/* read_iter rather than read so the stress threads can use kernel_read() */
 static const struct proc_ops lkp_info_ops = {
 	.proc_open    = lkp_info_open,
-	.proc_read    = seq_read,
+	.proc_read_iter = seq_read_iter,
 	.proc_lseek   = seq_lseek,
 	.proc_release = single_release,
 };
 
+/*
+ * Read stress test: 1, 2, 4, ... up to every online CPU, one kthread
+ * bound per CPU, each re-reading /proc/lkp_info from offset 0 for
+ * stress_ms in atomic and then in per-CPU mode.  Each thread keeps one
+ * file open: an open/close per read would time the seq_file allocation
+ * rather than the counter, and a kthread's last fput() is deferred to a
+ * workqueue, so millions of them would pile up until the run ends.
+ */
+struct lkp_stress_thread {
+	struct task_struct *task;
+	unsigned long reads;
+	int err;
+};
+
+static struct completion stress_go;
+static bool stress_stop;
+
+static int lkp_stress_thread_fn(void *data)
+{
+	struct lkp_stress_thread *th = data;
+	unsigned long reads = 0;	/* local: a shared array slot would false-share */
+	struct file *file;
+	char buf[256];
+	loff_t pos;
+	ssize_t ret;
+
+	file = filp_open("/proc/lkp_info", O_RDONLY, 0);
+	if (IS_ERR(file))
+		th->err = PTR_ERR(file);
+	wait_for_completion(&stress_go);
+
+	while (!th->err && !READ_ONCE(stress_stop)) {
+		pos = 0;
+		ret = kernel_read(file, buf, sizeof(buf), &pos);
+		if (ret < 0) {
+			th->err = ret;
+			break;
+		}
+		if (!(++reads & 1023))
+			cond_resched();
+	}
+	th->reads = reads;
+	if (!IS_ERR(file))
+		filp_close(file, NULL);
+
+	/* Stay around until lkp_stress_step() reaps us with kthread_stop() */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+/* Runs one step; *rate is reads/sec summed over all threads. */
+static int lkp_stress_step(int nthreads, bool percpu, u64 *rate)
+{
+	struct lkp_stress_thread *th;
+	unsigned long reads = 0;
+	unsigned int cpu;
+	u64 start, wall;
+	int i, err = 0;
+
+	th = kcalloc(nthreads, sizeof(*th), GFP_KERNEL);
+	if (!th)
+		return -ENOMEM;
+
+	lkp_info_set_mode(percpu);
+	WRITE_ONCE(stress_stop, false);
+	init_completion(&stress_go);
+
+	cpu = cpumask_first(cpu_online_mask);
+	for (i = 0; i < nthreads; i++) {
+		th[i].task = kthread_create(lkp_stress_thread_fn, &th[i],
+					    "lkp_info/%u", cpu);
+		if (IS_ERR(th[i].task)) {
+			err = PTR_ERR(th[i].task);
+			th[i].task = NULL;
+			goto out_stop;
+		}
+		kthread_bind(th[i].task, cpu);
+		cpu = cpumask_next(cpu, cpu_online_mask);
+	}
+	for (i = 0; i < nthreads; i++)
+		wake_up_process(th[i].task);
+
+	start = ktime_get_ns();
+	complete_all(&stress_go);
+	/* kthread_stop() from module unload cuts this short */
+	schedule_timeout_interruptible(msecs_to_jiffies(stress_ms));
+	WRITE_ONCE(stress_stop, true);
+	wall = ktime_get_ns() - start;
+
+out_stop:
+	/* Threads that were never woken exit without running the loop */
+	for (i = 0; i < nthreads; i++) {
+		if (!th[i].task)
+			continue;
+		kthread_stop(th[i].task);
+		if (th[i].err)
+			err = th[i].err;
+		reads += th[i].reads;
+	}
+	if (!err)
+		*rate = div64_u64((u64)reads * NSEC_PER_SEC, wall ?: 1);
+	kfree(th);
+	return err;
+}
+
+static int lkp_stress_fn(void *data)
+{
+	bool saved = READ_ONCE(percpu_count);
+	int ncpus = num_online_cpus();
+	u64 atomic_rate, percpu_rate, x100;
+	int n = 1, err = 0;
+
+	pr_info("stress: %u ms per step, reads/sec of /proc/lkp_info\n",
+		stress_ms);
+	pr_info("stress: %7s %14s %14s %8s\n",
+		"threads", "atomic", "percpu", "speedup");
+	while (!kthread_should_stop()) {
+		err = lkp_stress_step(n, false, &atomic_rate);
+		if (!err && !kthread_should_stop())
+			err = lkp_stress_step(n, true, &percpu_rate);
+		if (err || kthread_should_stop())
+			break;
+
+		x100 = div64_u64(percpu_rate * 100, atomic_rate ?: 1);
+		pr_info("stress: %7d %14llu %14llu %5llu.%02llux\n",
+			n, atomic_rate, percpu_rate, x100 / 100, x100 % 100);
+		if (n == ncpus) {
+			pr_info("stress: done\n");
+			break;
+		}
+		n = min(n * 2, ncpus);
+	}
+	lkp_info_set_mode(saved);
+	if (err)
+		pr_warn("stress: failed at %d threads: %d\n", n, err);
+
+	/* Stay around until lkp_info_exit() reaps us with kthread_stop() */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
 static int __init lkp_info_init(void)
 {
 	/* Record load-time jiffies */ 
@@ -97,6 +344,14 @@ static int __init lkp_info_init(void)
 		return -ENOMEM; //If we dont have this file return no memory. The kernel uses negative 
 	// Error codes for some reason?
 
+	/* Runs in the background so insmod does not wait for it */
+	if (stress_ms) {
+		stress_task = kthread_run(lkp_stress_fn, NULL, "lkp_info_stress");
+		if (IS_ERR(stress_task)) {
+			proc_remove(proc_entry);
+			return PTR_ERR(stress_task);
+		}
+	}
 
 	pr_info("module loaded\n");
 	return 0;
@@ -104,6 +359,10 @@ static int __init lkp_info_init(void)
 
 static void __exit lkp_info_exit(void)
 {
+	/* The stress threads read the file, so stop them first */
+	if (stress_task)
+		kthread_stop(stress_task);
+
 	/*Remove the /proc entry */
 
 	proc_remove(proc_entry);
@@ -2,19 +2,91 @@
 # bench.sh - Collect benchmark data across different dataset sizes
 #
 # Usage: sudo ./bench.sh > bench_data.txt
+#        sudo SIZES="$(seq 1000 1000 50000)" TRIALS=5 ALLOC=cache ./bench.sh > bench_data.txt
+#        sudo KEY_DIST=zipf SEED=42 ./bench.sh > bench_zipf.txt
+#        sudo CPU=2 NOPREEMPT=1 SHUFFLE=1 ./bench.sh > bench_quiet.txt
+#
+# The module is loaded once; each size is a "run" command written to
+# /proc/lkp_ds_bench, which executes in the background while we poll.
+# ALLOC selects the entry allocator (kmalloc, cache or pool), KEY_DIST
+# the keys (uniform, sequential, reverse, clustered, zipf or hotset) and
+# SEED makes them reproducible (0 = random, see the "Keys" line).
+# Every row is the mean of TRIALS trials after WARMUP discarded ones;
+# the "Trial statistics" block of each run (on stderr) has the spread.
+# CPU pins the run (-1 = anywhere), NOPREEMPT=1 times lookups with
+# preemption off and SHUFFLE=1 looks keys up in random order instead
+# of insertion order.
 #
 # Output format (one header line + one row per size):
 # N  list_ins  hash_ins  rb_ins  xa_ins  list_lkp  hash_lkp  rb_lkp  xa_lkp
+#    xv_ins  xv_lkp
+#    list_pre  hash_pre  rb_pre  xa_pre  xv_pre  alloc
+#    list_miss  hash_miss  rb_miss  xa_miss  xv_miss
+#    list_mix  hash_mix  rb_mix  xa_mix  xv_mix
+#    list_del  hash_del  rb_del  xa_del  xv_del
+#    mt_ins  bt_ins  mt_lkp  bt_lkp  mt_pre  bt_pre  mt_miss  bt_miss
+#    mt_mix  bt_mix  mt_del  bt_del
+#    list_td  hash_td  rb_td  xa_td  xv_td  mt_td  bt_td
+#    list_mem  hash_mem  rb_mem  xa_mem  xv_mem  mt_mem  bt_mem
+#    list_bpe  hash_bpe  rb_bpe  xa_bpe  xv_bpe  mt_bpe  bt_bpe
+#    list_slack  hash_slack  rb_slack  xa_slack  xv_slack  mt_slack  bt_slack
+# (columns 2-9 keep their original meaning for plot_bench.gp; xv is the
+# value-keyed XArray, mt the maple tree, bt the lib/btree B+tree ("-"
+# without CONFIG_BTREE), *_ins include allocation, *_pre insert
+# pre-allocated entries, *_mix look up HIT_PCT% present keys (xa_miss
+# and xa_mix on a copy with a hole after each entry), *_del delete in
+# random order, *_td destroy the whole structure at once;
+# *_mem are the bytes of a built structure including internal nodes,
+# *_bpe bytes per entry and *_slack the allocator rounding in *_mem)
 
 set -euo pipefail
 
-echo "# N  list_ins  hash_ins  rb_ins  xa_ins  list_lkp  hash_lkp  rb_lkp  xa_lkp"
+SIZES=${SIZES:-"100 1000 5000 10000 50000"}
+TRIALS=${TRIALS:-5}
+WARMUP=${WARMUP:-1}
+CPU=${CPU:--1}
+NOPREEMPT=${NOPREEMPT:-0}
+SHUFFLE=${SHUFFLE:-0}
+ALLOC=${ALLOC:-kmalloc}
+KEY_DIST=${KEY_DIST:-uniform}
+SEED=${SEED:-0}
+HIT_PCT=${HIT_PCT:-50}
+BENCH=/proc/lkp_ds_bench
+
+# Print the first value (or column $3) of the rows in the named section
+# of $BENCH, optionally only those whose label is in the |-separated
+# list $2
+section() {
+    awk -v sec="$1" -v want="${2:-}" -v col="${3:-1}" '
+        /^[^ ]/ { cur = $0; sub(/ \(.*$/, "", cur); next }
+        cur == sec && /:/ {
+            split($0, f, ":"); lbl = f[1]; sub(/^ +/, "", lbl)
+            if (want == "" || index("|" want "|", "|" lbl "|")) {
+                split(f[2], v, " "); print v[col]
+            }
+        }
+    ' $BENCH | tr '\n' ' '
+}
+
+ORIG="Linked list|Hash table|Red-black tree|XArray"
+XV="XArray (value)"
+FIVE="$ORIG|$XV"
+TREES="Maple tree|B+ tree"
+
+echo "# N  list_ins  hash_ins  rb_ins  xa_ins  list_lkp  hash_lkp  rb_lkp  xa_lkp  xv_ins  xv_lkp  list_pre  hash_pre  rb_pre  xa_pre  xv_pre  alloc  list_miss  hash_miss  rb_miss  xa_miss  xv_miss  list_mix  hash_mix  rb_mix  xa_mix  xv_mix  list_del  hash_del  rb_del  xa_del  xv_del  mt_ins  bt_ins  mt_lkp  bt_lkp  mt_pre  bt_pre  mt_miss  bt_miss  mt_mix  bt_mix  mt_del  bt_del  list_td  hash_td  rb_td  xa_td  xv_td  mt_td  bt_td  list_mem  hash_mem  rb_mem  xa_mem  xv_mem  mt_mem  bt_mem  list_bpe  hash_bpe  rb_bpe  xa_bpe  xv_bpe  mt_bpe  bt_bpe  list_slack  hash_slack  rb_slack  xa_slack  xv_slack  mt_slack  bt_slack"
+
+# bench_size=0: no load-time run that would make the first "run" -EBUSY
+sudo insmod lkp_ds.ko int_str="1" bench_size=0
+trap 'sudo rmmod lkp_ds' EXIT
 
-for n in 100 1000 5000 10000 50000; do
-    sudo insmod lkp_ds.ko int_str="1" bench_size=$n
-    vals=$(awk -F':' '/:/{print $2}' /proc/lkp_ds_bench | awk '{print $1}' | tr '\n' ' ')
-    echo "$n $vals"
-    cat /proc/lkp_ds_bench
-    sudo rmmod lkp_ds
-    sleep 1
+for n in $SIZES; do
+    echo "run n=$n trials=$TRIALS warmup=$WARMUP cpu=$CPU nopreempt=$NOPREEMPT shuffle=$SHUFFLE alloc=$ALLOC key_dist=$KEY_DIST seed=$SEED hit_pct=$HIT_PCT" | sudo tee $BENCH > /dev/null
+    while grep -q "run in progress" $BENCH; do
+        sleep 0.1
+    done
+    if grep -q "^Status: failed" $BENCH; then
+        echo "n=$n: $(grep '^Status:' $BENCH)" >&2
+    fi
+    echo "$n $(section Insert "$ORIG")$(section Lookup "$ORIG")$(section Insert "$XV")$(section Lookup "$XV")$(section "Insert pre-allocated" "$FIVE")$(section "Allocate only")$(section "Lookup miss" "$FIVE")$(section "Lookup mixed" "$FIVE")$(section Delete "$FIVE")$(section Insert "$TREES")$(section Lookup "$TREES")$(section "Insert pre-allocated" "$TREES")$(section "Lookup miss" "$TREES")$(section "Lookup mixed" "$TREES")$(section Delete "$TREES")$(section Teardown)$(section Memory "" 1)$(section Memory "" 2)$(section Memory "" 5)"
+    cat $BENCH >&2
 done
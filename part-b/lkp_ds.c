@@ -1,25 +1,67 @@
 /*
  * lkp_ds.c - Kernel Data Structures Module (Exercise 1, Part B)
  *
- * Stores integers in four data structures (linked list, hash table,
- * red-black tree, XArray) and exposes them via /proc/lkp_ds.
- * Includes a scalability benchmark reported via /proc/lkp_ds_bench.
+ * Stores integers in six data structures (linked list, hash table,
+ * red-black tree, XArray, maple tree, lib/btree B+tree) and exposes them
+ * via /proc/lkp_ds, or one at a time via
+ * /proc/lkp_ds_{list,hash,rbtree,xarray,maple,btree}.
+ * Entries can be added, deleted and looked up at runtime, in batches,
+ * through /proc/lkp_ds_ctl, and loaded in bulk through /proc/lkp_ds_load.
+ * /dev/lkp_ds exports a binary snapshot of the values for mmap().
+ * Includes a scalability benchmark reported via /proc/lkp_ds_bench;
+ * writing "run n=... trials=... structs=..." to that file starts a new
+ * run in the background without reloading the module.
  */
 #define pr_fmt(fmt) "lkp: " fmt
 
+#ifdef __KERNEL__
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/slab.h>
+#include <linux/fs.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
 #include <linux/list.h>
-#include <linux/hashtable.h>
+#include <linux/hash.h>
 #include <linux/rbtree.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/xarray.h>
 #include <linux/ktime.h>
 #include <linux/random.h>
 #include <linux/string.h>
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/uaccess.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/completion.h>
+#include <linux/spinlock.h>
+#include <linux/cpumask.h>
+#include <linux/nodemask.h>
+#include <linux/topology.h>
+#include <linux/prandom.h>
+#include <linux/log2.h>
+#include <linux/rculist.h>
+#include <linux/seqlock.h>
+#include <linux/overflow.h>
+#include <linux/math64.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
+#include <linux/perf_event.h>
+#include <linux/maple_tree.h>
+#include <linux/btree.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/kref.h>
+#include <linux/mempool.h>
+#else
+#include "user/lkp_user.h"	/* "make user", see user/lkp_user.h */
+#endif
+
+#include "lkp_ds_snap.h"
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Your Name");
@@ -31,35 +73,434 @@ MODULE_PARM_DESC(int_str, "A comma-separated list of integers");
 
 static int bench_size = 1000;
 module_param(bench_size, int, 0444);
-MODULE_PARM_DESC(bench_size, "Number of entries for the benchmark");
+MODULE_PARM_DESC(bench_size, "Number of entries for the benchmark (at most 4194304)");
+
+static int bench_sample = 16;
+module_param(bench_sample, int, 0444);
+MODULE_PARM_DESC(bench_sample,
+		 "Time every Nth benchmark op for latency histograms (power of two, 0 = off)");
+
+static unsigned long long bench_seed;
+module_param(bench_seed, ullong, 0444);
+MODULE_PARM_DESC(bench_seed, "Seed for benchmark keys (0 = random, reported in /proc/lkp_ds_bench)");
+
+static int hash_bits = 4;
+module_param(hash_bits, int, 0444);
+MODULE_PARM_DESC(hash_bits, "Initial hash table size as a power of two (1-24)");
+
+static unsigned int hash_max_load = 1;
+module_param(hash_max_load, uint, 0444);
+MODULE_PARM_DESC(hash_max_load,
+		 "Average chain length that makes the hash table double (0 = fixed size)");
+
+static bool bulk_load = true;
+module_param(bulk_load, bool, 0644);
+MODULE_PARM_DESC(bulk_load,
+		 "Load int_str and /proc/lkp_ds_load through the sorted bulk path (0 = one store_value() per integer)");
 
 /*
- * Entry struct: embeds nodes for all four data structures.
+ * Entry struct: embeds nodes for the list, hash table and rbtree.
  * Each integer from int_str creates ONE allocation that is inserted
- * into all four structures simultaneously.
+ * into all six structures simultaneously.
  */
 struct my_entry {
 	int value;
+	u32 index;                   /* slot in my_xarray, fills padding */
 	struct list_head list;       /* linked list */
 	struct hlist_node hnode;     /* hash table */
 	struct rb_node node;         /* red-black tree */
-	/* XArray stores a pointer to this entry; no embedded node needed */
+	u32 size;                    /* entries in this rbtree subtree */
+	/* XArray, maple tree and B+tree store a pointer, no embedded node */
+	struct rcu_head rcu;         /* deferred free for lockless readers */
+};
+
+/* ===================================================================
+ * Resizable hash table
+ * =================================================================== */
+
+/*
+ * DEFINE_HASHTABLE fixes the bucket count at compile time, so with 16
+ * buckets every chain grows linearly with N.  lkp_htable doubles its
+ * bucket array once the average chain passes max_load, then moves the
+ * old buckets over a few at a time on later inserts and deletes so that
+ * no single insert pays for a full rehash.  While a migration is in
+ * progress an entry lives in either the old or the new array and
+ * lookups check both.
+ *
+ * Readers may run under rcu_read_lock() alongside one writer (writers
+ * are serialized by the caller).  Bucket arrays are published with
+ * rcu_assign_pointer() and freed with kvfree_rcu(); moving an entry
+ * between arrays can make a lockless lookup miss it, so every
+ * migration step bumps ht->seq and a lookup that missed retries.
+ */
+struct lkp_ht_tbl {
+	unsigned int bits;
+	struct rcu_head rcu;
+	struct hlist_head buckets[];
+};
+
+struct lkp_htable {
+	struct lkp_ht_tbl __rcu *tbl;
+	struct lkp_ht_tbl __rcu *old_tbl; /* non-NULL while migrating */
+	unsigned int migrate_pos;        /* next old bucket to move */
+	unsigned long nr;                /* entries in the table */
+	unsigned int max_load;           /* 0 = never grow */
+	int node;                        /* bucket arrays, NUMA_NO_NODE = any */
+	seqcount_t seq;                  /* odd while entries move */
 };
 
-/* --- Correctness data structures (populated from int_str) --- */
+#define LKP_HT_MAX_BITS		24
+#define LKP_HT_MIGRATE_STEP	4	/* old buckets moved per update */
+
+/* Writer-side accessors; readers use rcu_dereference() instead. */
+static inline struct lkp_ht_tbl *lkp_ht_cur(struct lkp_htable *ht)
+{
+	return rcu_dereference_protected(ht->tbl, 1);
+}
+
+static inline struct lkp_ht_tbl *lkp_ht_old(struct lkp_htable *ht)
+{
+	return rcu_dereference_protected(ht->old_tbl, 1);
+}
+
+static inline struct hlist_head *lkp_ht_bucket(struct lkp_ht_tbl *t, int key)
+{
+	return &t->buckets[hash_32(key, t->bits)];
+}
+
+static struct lkp_ht_tbl *lkp_ht_alloc(unsigned int bits, int node)
+{
+	struct lkp_ht_tbl *t;
+
+	t = kvzalloc_node(struct_size(t, buckets, 1U << bits), GFP_KERNEL, node);
+	if (t)
+		t->bits = bits;
+	return t;
+}
+
+static int lkp_ht_init_node(struct lkp_htable *ht, int bits,
+			    unsigned int max_load, int node)
+{
+	struct lkp_ht_tbl *t;
+
+	if (bits < 1 || bits > LKP_HT_MAX_BITS)
+		return -EINVAL;
+
+	memset(ht, 0, sizeof(*ht));
+	ht->node = node;
+	t = lkp_ht_alloc(bits, node);
+	if (!t)
+		return -ENOMEM;
+	RCU_INIT_POINTER(ht->tbl, t);
+	ht->max_load = max_load;
+	seqcount_init(&ht->seq);
+	return 0;
+}
+
+static int lkp_ht_init(struct lkp_htable *ht, int bits, unsigned int max_load)
+{
+	return lkp_ht_init_node(ht, bits, max_load, NUMA_NO_NODE);
+}
+
+/*
+ * Frees the bucket arrays only; entries are owned by the caller, who
+ * must also make sure no reader can still be walking the table.
+ */
+static void lkp_ht_destroy(struct lkp_htable *ht)
+{
+	kvfree(lkp_ht_old(ht));
+	kvfree(lkp_ht_cur(ht));
+	RCU_INIT_POINTER(ht->old_tbl, NULL);
+	RCU_INIT_POINTER(ht->tbl, NULL);
+}
+
+/*
+ * Empties the table in one pass over the buckets instead of one
+ * lkp_ht_del() per entry; the entries are the caller's to free after
+ * a grace period.  Pending migration is dropped with the old array.
+ */
+static void lkp_ht_clear(struct lkp_htable *ht)
+{
+	struct lkp_ht_tbl *old = lkp_ht_old(ht), *cur = lkp_ht_cur(ht);
+	unsigned int bkt;
+
+	for (bkt = 0; bkt < 1U << cur->bits; bkt++)
+		WRITE_ONCE(cur->buckets[bkt].first, NULL);
+	if (old) {
+		RCU_INIT_POINTER(ht->old_tbl, NULL);
+		kvfree_rcu(old, rcu);
+	}
+	ht->nr = 0;
+}
+
+static void lkp_ht_migrate(struct lkp_htable *ht, unsigned int steps)
+{
+	struct lkp_ht_tbl *old, *cur = lkp_ht_cur(ht);
+	struct my_entry *e;
+	struct hlist_node *tmp;
+	unsigned int chunk;
+
+	/* Small write sections so readers never spin for long. */
+	while ((old = lkp_ht_old(ht)) && steps) {
+		chunk = min_t(unsigned int, steps, LKP_HT_MIGRATE_STEP);
+		steps -= chunk;
+
+		preempt_disable();
+		write_seqcount_begin(&ht->seq);
+		while (chunk--) {
+			hlist_for_each_entry_safe(e, tmp,
+						  &old->buckets[ht->migrate_pos], hnode) {
+				hlist_del_rcu(&e->hnode);
+				hlist_add_head_rcu(&e->hnode,
+						   lkp_ht_bucket(cur, e->value));
+			}
+
+			if (++ht->migrate_pos == 1U << old->bits) {
+				RCU_INIT_POINTER(ht->old_tbl, NULL);
+				kvfree_rcu(old, rcu);
+				break;
+			}
+		}
+		write_seqcount_end(&ht->seq);
+		preempt_enable();
+	}
+}
+
+/* Start migrating to 2^@bits buckets; no migration may be in progress */
+static void lkp_ht_resize(struct lkp_htable *ht, unsigned int bits)
+{
+	struct lkp_ht_tbl *nt, *cur = lkp_ht_cur(ht);
+
+	/* On failure keep the current size; chains just get longer. */
+	nt = lkp_ht_alloc(bits, ht->node);
+	if (!nt)
+		return;
+
+	preempt_disable();
+	write_seqcount_begin(&ht->seq);
+	rcu_assign_pointer(ht->old_tbl, cur);
+	ht->migrate_pos = 0;
+	rcu_assign_pointer(ht->tbl, nt);
+	write_seqcount_end(&ht->seq);
+	preempt_enable();
+}
+
+static void lkp_ht_grow(struct lkp_htable *ht)
+{
+	struct lkp_ht_tbl *cur;
+
+	/* Only one migration at a time: finish the previous one first. */
+	lkp_ht_migrate(ht, UINT_MAX);
+
+	cur = lkp_ht_cur(ht);
+	if (cur->bits < LKP_HT_MAX_BITS)
+		lkp_ht_resize(ht, cur->bits + 1);
+}
+
+/*
+ * Size the table for @nr entries up front, ahead of a bulk insert,
+ * rather than doubling it several times along the way.  Existing
+ * entries are moved over before returning.
+ */
+static void lkp_ht_reserve(struct lkp_htable *ht, unsigned long nr)
+{
+	unsigned int bits;
+
+	if (!ht->max_load)
+		return;
+
+	lkp_ht_migrate(ht, UINT_MAX);
+	for (bits = lkp_ht_cur(ht)->bits; bits < LKP_HT_MAX_BITS; bits++)
+		if (nr <= (unsigned long)ht->max_load << bits)
+			break;
+	if (bits == lkp_ht_cur(ht)->bits)
+		return;
+
+	lkp_ht_resize(ht, bits);
+	lkp_ht_migrate(ht, UINT_MAX);
+}
+
+static void lkp_ht_add(struct lkp_htable *ht, struct my_entry *e)
+{
+	struct lkp_ht_tbl *t;
+
+	lkp_ht_migrate(ht, LKP_HT_MIGRATE_STEP);
+
+	t = lkp_ht_cur(ht);
+	if (ht->max_load && !lkp_ht_old(ht) &&
+	    ht->nr >= (unsigned long)ht->max_load << t->bits) {
+		lkp_ht_grow(ht);
+		t = lkp_ht_cur(ht);
+	}
+
+	hlist_add_head_rcu(&e->hnode, lkp_ht_bucket(t, e->value));
+	ht->nr++;
+}
+
+/* The entry may still be seen by readers until a grace period passes. */
+static void lkp_ht_del(struct lkp_htable *ht, struct my_entry *e)
+{
+	hlist_del_init_rcu(&e->hnode);
+	ht->nr--;
+	lkp_ht_migrate(ht, LKP_HT_MIGRATE_STEP);
+}
+
+static struct my_entry *lkp_ht_find_in(struct lkp_ht_tbl *t, int key)
+{
+	struct my_entry *e;
+
+	hlist_for_each_entry_rcu(e, lkp_ht_bucket(t, key), hnode, true)
+		if (e->value == key)
+			return e;
+	return NULL;
+}
+
+/* Caller holds rcu_read_lock() or is the table's only writer. */
+static struct my_entry *lkp_ht_find(struct lkp_htable *ht, int key)
+{
+	struct lkp_ht_tbl *t;
+	struct my_entry *e;
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&ht->seq);
+		e = lkp_ht_find_in(rcu_dereference_raw(ht->tbl), key);
+
+		/* Not yet migrated? Then it may still sit in the old array. */
+		t = rcu_dereference_raw(ht->old_tbl);
+		if (!e && t)
+			e = lkp_ht_find_in(t, key);
+	} while (!e && read_seqcount_retry(&ht->seq, seq));
+	return e;
+}
+
+/*
+ * Walk the current array and then, during a migration, the old one
+ * (already migrated old buckets are simply empty).  Safe under
+ * rcu_read_lock(); entries that move concurrently may be seen twice
+ * or not at all, which readers detect through ht->seq.
+ */
+#define lkp_ht_for_each_tbl(ht, t)					\
+	for ((t) = rcu_dereference_raw((ht)->tbl); (t);			\
+	     (t) = (t) == rcu_dereference_raw((ht)->tbl) ?		\
+		   rcu_dereference_raw((ht)->old_tbl) : NULL)
+
+#define lkp_ht_for_each(ht, t, bkt, obj)				\
+	lkp_ht_for_each_tbl(ht, t)					\
+		for ((bkt) = 0; (bkt) < 1U << (t)->bits; (bkt)++)	\
+			hlist_for_each_entry_rcu(obj, &(t)->buckets[bkt], hnode, true)
+
+/* Writers only */
+#define lkp_ht_for_each_safe(ht, t, bkt, tmp, obj)			\
+	lkp_ht_for_each_tbl(ht, t)					\
+		for ((bkt) = 0; (bkt) < 1U << (t)->bits; (bkt)++)	\
+			hlist_for_each_entry_safe(obj, tmp, &(t)->buckets[bkt], hnode)
+
+/* Longest chain over both arrays; the load factor is nr / 2^bits. */
+static unsigned int lkp_ht_longest_chain(struct lkp_htable *ht)
+{
+	unsigned int bkt, len, longest = 0;
+	struct lkp_ht_tbl *t;
+	struct my_entry *e;
+
+	lkp_ht_for_each_tbl(ht, t) {
+		for (bkt = 0; bkt < 1U << t->bits; bkt++) {
+			len = 0;
+			hlist_for_each_entry(e, &t->buckets[bkt], hnode)
+				len++;
+			if (len > longest)
+				longest = len;
+		}
+	}
+	return longest;
+}
+
+/*
+ * The maple tree and lib/btree hold one entry per key, so both are keyed
+ * by (value, XArray index): the value, sign-flipped to sort as unsigned,
+ * in the upper half and the unique index below it. The entries of one
+ * value then form a contiguous key range. Maple tree indices are
+ * unsigned long, hence the 64-bit requirement.
+ */
+static_assert(BITS_PER_LONG == 64, "maple tree keys need 64-bit indices");
+
+/* lib/btree is only built when something in the kernel selects it */
+#define LKP_HAVE_BTREE	IS_ENABLED(CONFIG_BTREE)
+
+static inline u64 lkp_key(int value, u32 index)
+{
+	return (u64)((u32)value ^ 0x80000000U) << 32 | index;
+}
+
+/* First entry holding @value, or NULL; mt_find() takes the RCU lock */
+static struct my_entry *lkp_mt_find(struct maple_tree *mt, int value)
+{
+	unsigned long index = lkp_key(value, 0);
+
+	return mt_find(mt, &index, lkp_key(value, U32_MAX));
+}
+
+/*
+ * lib/btree only walks downwards (btree_last(), btree_get_prev()), so
+ * keys are stored inverted: descending stored order is ascending
+ * lkp_key() order and btree_get_prev() yields the next larger key.
+ */
+static inline u64 lkp_bt_key(int value, u32 index)
+{
+	return ~lkp_key(value, index);
+}
+
+/* Entry with the smallest key >= *key, which is updated to match */
+static struct my_entry *lkp_bt_ceil(struct btree_head64 *bt, u64 *key)
+{
+	u64 bound = ~*key + 1;           /* btree_get_prev64() is exclusive */
+	struct my_entry *e;
+
+	if (!LKP_HAVE_BTREE)
+		return NULL;
+	e = bound ? btree_get_prev64(bt, &bound) : btree_last64(bt, &bound);
+	if (e)
+		*key = ~bound;
+	return e;
+}
+
+static struct my_entry *lkp_bt_find(struct btree_head64 *bt, int value)
+{
+	u64 key = lkp_key(value, 0);
+	struct my_entry *e = lkp_bt_ceil(bt, &key);
+
+	return e && e->value == value ? e : NULL;
+}
+
+/*
+ * --- Correctness data structures (populated from int_str) ---
+ *
+ * Lookups and the list/XArray parts of /proc/lkp_ds run under
+ * rcu_read_lock() and never take my_lock; writers serialize on my_lock,
+ * link entries in with the _rcu primitives and free them with
+ * kfree_rcu().  The rbtree cannot be walked safely during a rotation,
+ * so tree writers also bump my_tree_seq and lockless tree readers
+ * retry (or fall back to my_lock) when it changed.  The maple tree is
+ * RCU-safe on its own (MT_FLAGS_USE_RCU); lib/btree is not, so it is
+ * only read under my_lock.
+ */
+static DEFINE_MUTEX(my_lock);
 static LIST_HEAD(my_list);
-static DEFINE_HASHTABLE(my_htable, 4);   /* 2^4 = 16 buckets */
-static struct rb_root my_tree = RB_ROOT;
+static struct lkp_htable my_htable;
+static struct rb_root_cached my_tree = RB_ROOT_CACHED;  /* order-statistic */
+static seqcount_mutex_t my_tree_seq = SEQCNT_MUTEX_ZERO(my_tree_seq, &my_lock);
 static DEFINE_XARRAY(my_xarray);
 static unsigned long xa_next_index;      /* tracks next XArray index */
+static struct maple_tree my_mtree = MTREE_INIT(my_mtree, MT_FLAGS_USE_RCU);
+static struct btree_head64 my_btree;     /* walked under my_lock only */
+static unsigned long my_nr;              /* entries, under my_lock */
+static u64 my_gen;                       /* bumped on every change, under my_lock */
+static struct kmem_cache *my_entry_cache; /* bulk loads, alloc=cache */
 
 static struct proc_dir_entry *proc_ds;
 static struct proc_dir_entry *proc_bench;
-
-/* --- Benchmark results (filled on module load) --- */
-static u64 bench_insert_ns[4];  /* list, hash, rbtree, xarray */
-static u64 bench_lookup_ns[4];
-static int bench_n;
+static struct proc_dir_entry *proc_ctl;
+static struct proc_dir_entry *proc_load;
 
 /* ===================================================================
  * Red-black tree insertion helper (provided)
@@ -85,52 +526,594 @@ static void insert_rbtree(struct rb_root *root, struct my_entry *new)
 	rb_insert_color(&new->node, root);
 }
 
+/*
+ * Same as insert_rbtree() but publishes the new node with
+ * rb_link_node_rcu() for lockless readers.  The caller serializes
+ * writers and brackets the call with a seqcount write section.
+ */
+static void insert_rbtree_rcu(struct rb_root *root, struct my_entry *new)
+{
+	struct rb_node **link = &root->rb_node;
+	struct rb_node *parent = NULL;
+	struct my_entry *entry;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct my_entry, node);
+
+		if (new->value < entry->value)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node_rcu(&new->node, parent, link);
+	rb_insert_color(&new->node, root);
+}
+
+/*
+ * Lockless descent for readers under rcu_read_lock().  rb_insert_color()
+ * and rb_erase() update child pointers with WRITE_ONCE() so this never
+ * loops, but a concurrent rotation can hide the key: a miss is only
+ * trustworthy if the writer's seqcount did not change meanwhile.
+ */
+static struct my_entry *lookup_rbtree_rcu(struct rb_root *root, int key)
+{
+	struct rb_node *node = rcu_dereference_raw(root->rb_node);
+	struct my_entry *e;
+
+	while (node) {
+		e = rb_entry(node, struct my_entry, node);
+		if (key < e->value)
+			node = rcu_dereference_raw(node->rb_left);
+		else if (key > e->value)
+			node = rcu_dereference_raw(node->rb_right);
+		else
+			return e;
+	}
+	return NULL;
+}
 
 /* ===================================================================
- * Correctness: store/display/free int_str values
+ * Order-statistic rbtree: subtree sizes kept by rb_augment callbacks
  * =================================================================== */
 
+static inline u32 lkp_os_size(struct rb_node *node)
+{
+	return node ? rb_entry(node, struct my_entry, node)->size : 0;
+}
+
+static inline bool lkp_os_compute(struct my_entry *e, bool exit)
+{
+	u32 size = 1 + lkp_os_size(e->node.rb_left) +
+		   lkp_os_size(e->node.rb_right);
+
+	if (exit && e->size == size)
+		return true;
+	e->size = size;
+	return false;
+}
+
+RB_DECLARE_CALLBACKS(static, lkp_os_cb, struct my_entry, node, size,
+		     lkp_os_compute);
+
 /*
- * TODO: Implement store_value()
- * Allocate one my_entry, set its value, and insert it into all 4 structures:
- *   - list: list_add_tail(&entry->list, &my_list)
- *   - hash: hash_add(my_htable, &entry->hnode, val)
- *   - rbtree: insert_rbtree(&my_tree, entry)
- *   - xarray: xa_store(&my_xarray, xa_next_index++, entry, GFP_KERNEL)
- * Return 0 on success, -ENOMEM on allocation failure.
+ * Augmented counterpart of insert_rbtree_rcu(): every node on the way
+ * down gains one descendant, rotations fix up the rest through
+ * lkp_os_cb. Also tracks the leftmost node for rb_first_cached().
  */
-static int store_value(int val)
+static void insert_rbtree_os(struct rb_root_cached *root, struct my_entry *new)
+{
+	struct rb_node **link = &root->rb_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct my_entry *entry;
+	bool leftmost = true;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct my_entry, node);
+		entry->size++;
+
+		if (new->value < entry->value) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = false;
+		}
+	}
+
+	new->size = 1;
+	rb_link_node_rcu(&new->node, parent, link);
+	rb_insert_augmented_cached(&new->node, root, leftmost, &lkp_os_cb);
+}
+
+static void erase_rbtree_os(struct rb_root_cached *root, struct my_entry *e)
+{
+	rb_erase_augmented_cached(&e->node, root, &lkp_os_cb);
+}
+
+/* The @k-th smallest entry, counting from 0, or NULL past the end */
+static struct my_entry *select_rbtree_os(struct rb_root_cached *root, u32 k)
+{
+	struct rb_node *node = root->rb_root.rb_node;
+	u32 left;
+
+	while (node) {
+		left = lkp_os_size(node->rb_left);
+		if (k < left) {
+			node = node->rb_left;
+		} else if (k == left) {
+			return rb_entry(node, struct my_entry, node);
+		} else {
+			k -= left + 1;
+			node = node->rb_right;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * select_rbtree_os() for readers under rcu_read_lock(), with the same
+ * caveat as lookup_rbtree_rcu(): the result only counts if my_tree_seq
+ * did not change meanwhile.
+ */
+static struct my_entry *select_rbtree_os_rcu(struct rb_root_cached *root,
+					     u32 k)
+{
+	struct rb_node *node = rcu_dereference_raw(root->rb_root.rb_node);
+	struct rb_node *child;
+	u32 left;
+
+	while (node) {
+		child = rcu_dereference_raw(node->rb_left);
+		left = child ? READ_ONCE(rb_entry(child, struct my_entry,
+						  node)->size) : 0;
+		if (k < left) {
+			node = child;
+		} else if (k == left) {
+			return rb_entry(node, struct my_entry, node);
+		} else {
+			k -= left + 1;
+			node = rcu_dereference_raw(node->rb_right);
+		}
+	}
+	return NULL;
+}
+
+/* Number of entries smaller than @key */
+static u32 rank_rbtree_os(struct rb_root_cached *root, int key)
+{
+	struct rb_node *node = root->rb_root.rb_node;
+	u32 rank = 0;
+
+	while (node) {
+		if (rb_entry(node, struct my_entry, node)->value < key) {
+			rank += lkp_os_size(node->rb_left) + 1;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+	return rank;
+}
+
+/*
+ * O(n) counterpart of inserting @sorted one by one: the middle entry
+ * becomes the root and each half a subtree, recursively.  The result
+ * is perfectly balanced, so colouring the deepest level @red (the only
+ * one that may be partly filled) red and everything above it black
+ * gives every path the same black height.
+ */
+static struct rb_node *lkp_rb_build_sub(struct my_entry **sorted, int lo,
+					int hi, struct rb_node *parent,
+					int depth, int red)
 {
-	//Allocate an entry
 	struct my_entry *e;
+	int mid;
 
-	e = kmalloc(sizeof(*e), GFP_KERNEL);
-	if (!e)
-		return -ENOMEM;
-	//Fill in the value
-	e->value = val;
+	if (lo > hi)
+		return NULL;
+
+	mid = lo + (hi - lo) / 2;
+	e = sorted[mid];
+	e->size = hi - lo + 1;
+	rb_set_parent_color(&e->node, parent,
+			    depth && depth == red ? RB_RED : RB_BLACK);
+	e->node.rb_left = lkp_rb_build_sub(sorted, lo, mid - 1, &e->node,
+					   depth + 1, red);
+	e->node.rb_right = lkp_rb_build_sub(sorted, mid + 1, hi, &e->node,
+					    depth + 1, red);
+	return &e->node;
+}
+
+/*
+ * Build an order-statistic tree from @n entries sorted by value into
+ * the empty @root.  Nothing is reachable until the root is published,
+ * so lockless readers see either the empty or the finished tree.
+ */
+static void lkp_rb_build(struct rb_root_cached *root, struct my_entry **sorted,
+			 int n)
+{
+	struct rb_node *top;
+
+	if (!n)
+		return;
+	top = lkp_rb_build_sub(sorted, 0, n - 1, NULL, 0, ilog2(n));
+	root->rb_leftmost = &sorted[0]->node;
+	rcu_assign_pointer(root->rb_root.rb_node, top);
+}
+
+
+/* ===================================================================
+ * Correctness: store/display/free int_str values
+ * =================================================================== */
+
+/* Link @e into all six structures; caller holds my_lock */
+static int link_entry(struct my_entry *e)
+{
+	void *old;
+	int err;
+
+	if (xa_next_index > U32_MAX)
+		return -ENOSPC;
+	e->index = xa_next_index;
+	old = xa_store(&my_xarray, xa_next_index, e, GFP_KERNEL);
+	if (xa_is_err(old))
+		return xa_err(old);
+
+	/* The indexed structures can fail to allocate, link them first */
+	err = mtree_insert(&my_mtree, lkp_key(e->value, e->index), e,
+			   GFP_KERNEL);
+	if (err)
+		goto err_xa;
+	if (LKP_HAVE_BTREE) {
+		err = btree_insert64(&my_btree, lkp_bt_key(e->value, e->index),
+				     e, GFP_KERNEL);
+		if (err)
+			goto err_mt;
+	}
+	xa_next_index++;
 
 
 	// Use herlper functions directly provided by list.h, they use write_once read_once to ensure correctness.
 	// Importantly when reading the file we need to look for functions that are not internal meaning they dont start with
 	// __Function_name
 	// Kernel Helper for finding the tail (mylist.prev), linking new list_head, and updating pointers	
-	list_add_tail(&e->list, &my_list);
-	xa_store(&my_xarray, xa_next_index++, e, GFP_KERNEL);
-	hash_add(my_htable, &e->hnode, val);
-	
-	RB_CLEAR_NODE(&e->node);
-	insert_rbtree(&my_tree, e);
+	list_add_tail_rcu(&e->list, &my_list);
+	lkp_ht_add(&my_htable, e);
+
+	write_seqcount_begin(&my_tree_seq);
+	insert_rbtree_os(&my_tree, e);
+	write_seqcount_end(&my_tree_seq);
+
+	my_nr++;
+	my_gen++;
 	return 0;
+
+err_mt:
+	mtree_erase(&my_mtree, lkp_key(e->value, e->index));
+err_xa:
+	xa_erase(&my_xarray, e->index);
+	return err;
 }
 
 /*
- * Implementation of parse params
+ * Unlink @e from all six structures and free it after a grace period;
+ * caller holds my_lock. XArray indices are not reused, so erasing leaves
+ * a hole rather than shifting later entries.
+ */
+static void unlink_entry(struct my_entry *e)
+{
+	xa_erase(&my_xarray, e->index);
+	mtree_erase(&my_mtree, lkp_key(e->value, e->index));
+	if (LKP_HAVE_BTREE)
+		btree_remove64(&my_btree, lkp_bt_key(e->value, e->index));
+	list_del_rcu(&e->list);
+	lkp_ht_del(&my_htable, e);
+	write_seqcount_begin(&my_tree_seq);
+	erase_rbtree_os(&my_tree, e);
+	write_seqcount_end(&my_tree_seq);
+	kfree_rcu(e, rcu);
+	my_nr--;
+	my_gen++;
+}
+
+static struct my_entry *alloc_entry(int val)
+{
+	//Allocate an entry
+	struct my_entry *e;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return NULL;
+	//Fill in the value
+	e->value = val;
+	RB_CLEAR_NODE(&e->node);
+	return e;
+}
+
+/*
+ * Allocate one my_entry for @val and link it into all six structures
+ * under my_lock; readers may be walking them concurrently.  Returns 0,
+ * -ENOMEM, or link_entry()'s error.
+ */
+static int store_value(int val)
+{
+	struct my_entry *e;
+	int err;
+
+	e = alloc_entry(val);
+	if (!e)
+		return -ENOMEM;
+
+	mutex_lock(&my_lock);
+	err = link_entry(e);
+	mutex_unlock(&my_lock);
+	if (err)
+		kfree(e);
+	return err;
+}
+
+/*
+ * Entries are freed LKP_FREE_BATCH at a time with kmem_cache_free_bulk().
+ * A NULL cache makes it look up each object's cache, so that also takes
+ * kmalloc() entries and a mix of both.
+ */
+#define LKP_FREE_BATCH	32
+
+struct lkp_free_batch {
+	struct kmem_cache *cache;        /* NULL = look each object up */
+	unsigned int nr;
+	void *objs[LKP_FREE_BATCH];
+};
+
+static void lkp_free_flush(struct lkp_free_batch *fb)
+{
+	if (fb->nr)
+		kmem_cache_free_bulk(fb->cache, fb->nr, fb->objs);
+	fb->nr = 0;
+}
+
+static inline void lkp_free_add(struct lkp_free_batch *fb, void *obj)
+{
+	fb->objs[fb->nr++] = obj;
+	if (fb->nr == LKP_FREE_BATCH)
+		lkp_free_flush(fb);
+}
+
+/*
+ * Frees a whole detached rbtree in postorder: children before their
+ * parent, so no rebalancing and no rb_erase().  Every structure holds
+ * the same entries, so walking the tree frees all of them.
+ */
+static unsigned long lkp_free_tree(struct rb_root *root)
+{
+	struct lkp_free_batch fb = { .cache = NULL };
+	struct my_entry *e, *tmp;
+	unsigned long nr = 0;
+
+	rbtree_postorder_for_each_entry_safe(e, tmp, root, node) {
+		lkp_free_add(&fb, e);
+		if (!(++nr % XA_CHECK_SCHED))
+			cond_resched();
+	}
+	lkp_free_flush(&fb);
+	*root = RB_ROOT;
+	return nr;
+}
+
+/* btree_grim_visitor64() callback: the entries are freed elsewhere */
+static void lkp_btree_noop(void *elem, unsigned long opaque, u64 key,
+			   size_t index)
+{
+}
+
+/*
+ * Unlinks every entry in one step per structure rather than per entry:
+ * the XArray and maple tree drop their nodes wholesale, lib/btree is
+ * reaped by its grim visitor, hash buckets and the list head are reset
+ * and the rbtree is handed back whole for lkp_free_tree().  Readers
+ * that were already walking keep valid entries until the caller's
+ * grace period.  Caller holds my_lock.
+ */
+static struct rb_root detach_all(void)
+{
+	struct rb_root root;
+
+	xa_destroy(&my_xarray);
+	mtree_destroy(&my_mtree);
+	if (LKP_HAVE_BTREE)
+		btree_grim_visitor64(&my_btree, 0, lkp_btree_noop);
+	lkp_ht_clear(&my_htable);
+	INIT_LIST_HEAD_RCU(&my_list);
+
+	write_seqcount_begin(&my_tree_seq);
+	root = my_tree.rb_root;
+	WRITE_ONCE(my_tree.rb_root.rb_node, NULL);
+	my_tree.rb_leftmost = NULL;
+	write_seqcount_end(&my_tree_seq);
+
+	xa_next_index = 0;
+	my_nr = 0;
+	my_gen++;
+	return root;
+}
+
+/* sort() order for bulk loads: by value, equal values by index */
+static int lkp_entry_cmp(const void *a, const void *b)
+{
+	const struct my_entry *x = *(struct my_entry * const *)a;
+	const struct my_entry *y = *(struct my_entry * const *)b;
+
+	if (x->value != y->value)
+		return x->value < y->value ? -1 : 1;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/* Store @ents at consecutive indices from @base in a single XArray walk */
+static int lkp_xa_fill(struct xarray *xa, unsigned long base,
+		       struct my_entry **ents, int n)
+{
+	XA_STATE(xas, xa, base);
+	int i = 0;
+
+	do {
+		xas_lock(&xas);
+		for (; i < n; i++) {
+			xas_store(&xas, ents[i]);
+			if (xas_error(&xas))
+				break;
+			xas_next(&xas);
+			if (!((i + 1) % XA_CHECK_SCHED)) {
+				xas_unlock(&xas);
+				cond_resched();
+				xas_lock(&xas);
+				xas_reset(&xas);
+			}
+		}
+		xas_unlock(&xas);
+	} while (xas_nomem(&xas, GFP_KERNEL));
+
+	return xas_error(&xas);
+}
+
+/*
+ * Bulk counterpart of store_value() for large loads.  All entries come
+ * from one kmem_cache_alloc_bulk() call and are sorted once, then each
+ * structure is filled the cheap way: the XArray in one walk over
+ * consecutive indices, the hash table sized for the final count, the
+ * maple tree and B+tree with ascending keys (appends), and an empty
+ * rbtree built bottom-up in O(n).  A populated rbtree cannot be rebuilt
+ * under lockless readers, so there the sorted entries are inserted one
+ * by one.  The list and XArray keep the order of @vals.
+ */
+static int bulk_store(const int *vals, int n)
+{
+	struct my_entry **ents, **sorted;
+	unsigned long base;
+	int i, err;
+
+	/* input order in the first half, sorted in the second */
+	ents = kvmalloc_array(n, 2 * sizeof(*ents), GFP_KERNEL);
+	if (!ents)
+		return -ENOMEM;
+	sorted = ents + n;
+	if (kmem_cache_alloc_bulk(my_entry_cache, GFP_KERNEL, n,
+				  (void **)ents) != n) {
+		kvfree(ents);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		ents[i]->value = vals[i];
+		ents[i]->index = i;              /* rebased under my_lock */
+		RB_CLEAR_NODE(&ents[i]->node);
+	}
+	memcpy(sorted, ents, n * sizeof(*ents));
+	sort(sorted, n, sizeof(*sorted), lkp_entry_cmp, NULL);
+
+	mutex_lock(&my_lock);
+	base = xa_next_index;
+	if (base + n - 1 > U32_MAX) {
+		err = -ENOSPC;
+		goto err_unlock;
+	}
+	for (i = 0; i < n; i++)
+		ents[i]->index += base;
+
+	/* The indexed structures can fail to allocate, link them first */
+	err = lkp_xa_fill(&my_xarray, base, ents, n);
+	if (err)
+		goto err_xa;
+	for (i = 0; i < n; i++) {
+		err = mtree_insert(&my_mtree,
+				   lkp_key(sorted[i]->value, sorted[i]->index),
+				   sorted[i], GFP_KERNEL);
+		if (err)
+			goto err_mt;
+	}
+	for (i = 0; LKP_HAVE_BTREE && i < n; i++) {
+		err = btree_insert64(&my_btree,
+				     lkp_bt_key(sorted[i]->value, sorted[i]->index),
+				     sorted[i], GFP_KERNEL);
+		if (err)
+			goto err_bt;
+	}
+	xa_next_index += n;
+
+	lkp_ht_reserve(&my_htable, my_htable.nr + n);
+	for (i = 0; i < n; i++) {
+		list_add_tail_rcu(&ents[i]->list, &my_list);
+		lkp_ht_add(&my_htable, ents[i]);
+	}
+
+	write_seqcount_begin(&my_tree_seq);
+	if (RB_EMPTY_ROOT(&my_tree.rb_root)) {
+		lkp_rb_build(&my_tree, sorted, n);
+	} else {
+		for (i = 0; i < n; i++)
+			insert_rbtree_os(&my_tree, sorted[i]);
+	}
+	write_seqcount_end(&my_tree_seq);
+
+	my_nr += n;
+	my_gen++;
+	mutex_unlock(&my_lock);
+	kvfree(ents);
+	return 0;
+
+err_bt:
+	if (LKP_HAVE_BTREE) {
+		while (i--)
+			btree_remove64(&my_btree, lkp_bt_key(sorted[i]->value,
+							     sorted[i]->index));
+	}
+	i = n;
+err_mt:
+	while (i--)
+		mtree_erase(&my_mtree, lkp_key(sorted[i]->value, sorted[i]->index));
+err_xa:
+	/* indices past the failed one were never stored, erasing is a no-op */
+	for (i = 0; i < n; i++)
+		xa_erase(&my_xarray, base + i);
+err_unlock:
+	mutex_unlock(&my_lock);
+	/* lockless readers may have found them in the XArray or maple tree */
+	synchronize_rcu();
+	kmem_cache_free_bulk(my_entry_cache, n, (void **)ents);
+	kvfree(ents);
+	return err;
+}
+
+/* Store @vals the way bulk_load selects and log how long it took */
+static int store_values(const int *vals, int n, const char *from)
+{
+	u64 start = ktime_get_ns();
+	int i, err = 0;
+
+	if (!n)
+		return 0;
+
+	if (bulk_load) {
+		err = bulk_store(vals, n);
+	} else {
+		for (i = 0; i < n && !err; i++)
+			err = store_value(vals[i]);
+	}
+	if (!err)
+		pr_info("%s: stored %d values in %llu us (%s)\n", from, n,
+			div_u64(ktime_get_ns() - start, NSEC_PER_USEC),
+			bulk_load ? "bulk" : "incremental");
+	return err;
+}
+
+/*
+ * Implementation of parse params
  */
 static int parse_params(void)
 {
 	//Track value and error
-	int val, err = 0;
+	int *vals, n = 0, err = 0;
 	char *p, *orig, *params; //*p is the pointer to the char we attempt to convert to an int
 	// *orig is the orignal allocated string we will free later
 	// *params is the pointer we iterate over
@@ -142,406 +1125,5527 @@ static int parse_params(void)
 		return -ENOMEM;
 	orig = params;
 
+	// Parse everything first so the values can be stored as one batch,
+	// every value but the last takes at least a digit and a comma
+	vals = kvmalloc_array(strlen(params) / 2 + 1, sizeof(*vals), GFP_KERNEL);
+	if (!vals) {
+		kfree(orig);
+		return -ENOMEM;
+	}
+
 	while ((p = strsep(&params, ",")) != NULL) {
 		if (!*p)
 			continue;
 
-		err = kstrtoint(p, 0, &val);
+		err = kstrtoint(p, 0, &vals[n]);
+		if (err)
+			break;
+		n++;
+	}
+
+	if (!err)
+		err = store_values(vals, n, "int_str");
+
+	kvfree(vals);
+	kfree(orig);
+	return err;
+
+}
+
+/* ===================================================================
+ * /proc/lkp_ds: streaming dump
+ * =================================================================== */
+
+/*
+ * /proc/lkp_ds prints all six structures, one line each:
+ *
+ *   Linked List: 1, 2, 3, 4, 5,
+ *   Hash Table: 3, 4, 1, 2, 5,
+ *   Red-Black tree: 1, 2, 3, 4, 5,
+ *   XArray: 1, 2, 3, 4, 5,
+ *   Maple tree: 1, 2, 3, 4, 5,
+ *   B+ tree: 1, 2, 3, 4, 5,
+ *
+ * and /proc/lkp_ds_{list,hash,rbtree,xarray,maple,btree} print a single
+ * line (the B+ tree only with CONFIG_BTREE).
+ *
+ * Every prefix, entry and newline is its own seq_file record, so a
+ * read() only formats what fits in the caller's buffer.  Between two
+ * read()s the iterator keeps a resume point rather than a pointer, and
+ * start() finds its way back from it instead of walking from the head:
+ *
+ *   list, xarray: my_xarray index (the list is in insertion order, so
+ *                 the XArray doubles as its index), via xa_find()
+ *   rbtree:       rank, via one select_rbtree_os_rcu() descent
+ *   hash:         bucket array, bucket and position in the chain
+ *   maple, btree: the lkp_key() of the entry, via mt_find() and
+ *                 lkp_bt_ceil()
+ *
+ * Within one read() the list and hash walk on from the previous entry,
+ * and the rbtree descends once per entry, so no section costs more
+ * than O(log n) per record.
+ *
+ * Everything but the B+ tree is read under rcu_read_lock(), like the
+ * other lockless readers: rbtree descents retry when my_tree_seq moved
+ * and hash chains may see an entry twice or miss one while the table
+ * migrates.  lib/btree is not RCU-safe, so each B+ tree step takes
+ * my_lock on its own instead of holding it from start() to stop().
+ * Entries added or removed while a file is read may be missed or shown
+ * twice, as with any proc file that takes more than one read().
+ */
+enum lkp_ds_sect {
+	LKP_DS_LIST,
+	LKP_DS_HASH,
+	LKP_DS_TREE,
+	LKP_DS_XARRAY,
+	LKP_DS_MAPLE,
+	LKP_DS_BTREE,
+	LKP_DS_END,
+};
+
+#define LKP_DS_ALL	((BIT(LKP_DS_END) - 1) & \
+			 ~(LKP_HAVE_BTREE ? 0 : BIT(LKP_DS_BTREE)))
+
+static const struct lkp_ds_sect_info {
+	const char *proc;                /* per-structure file */
+	const char *head;                /* line prefix */
+	bool locked;                     /* my_lock per entry, not RCU */
+} lkp_ds_sects[LKP_DS_END] = {
+	[LKP_DS_LIST]   = { "lkp_ds_list",   "Linked List: ",    false },
+	[LKP_DS_HASH]   = { "lkp_ds_hash",   "Hash Table: ",     false },
+	[LKP_DS_TREE]   = { "lkp_ds_rbtree", "Red-Black tree: ", false },
+	[LKP_DS_XARRAY] = { "lkp_ds_xarray", "XArray: ",         false },
+	[LKP_DS_MAPLE]  = { "lkp_ds_maple",  "Maple tree: ",     false },
+	[LKP_DS_BTREE]  = { "lkp_ds_btree",  "B+ tree: ",        true },
+};
+
+static struct proc_dir_entry *proc_ds_sect[LKP_DS_END];
+
+enum lkp_ds_rec {
+	LKP_DS_HEAD,                     /* section prefix */
+	LKP_DS_ENTRY,                    /* "%d, " */
+	LKP_DS_TAIL,                     /* newline */
+};
+
+/* seq_file private state, one per open file */
+struct lkp_ds_iter {
+	unsigned long sects;             /* BIT(LKP_DS_*) this file prints */
+	enum lkp_ds_sect sect;
+	enum lkp_ds_rec rec;
+	loff_t pos;                      /* seq_file position of rec */
+	struct my_entry *e;              /* only dereferenced under RCU */
+	int value;                       /* e->value, for show() */
+
+	/* resume point of e */
+	unsigned long index;             /* list, xarray */
+	u32 rank;                        /* rbtree */
+	bool old_tbl;                    /* hash */
+	unsigned int bkt, chain;         /* hash */
+	u64 key;                         /* maple, btree: lkp_key() */
+
+	bool rcu;                        /* inside rcu_read_lock() */
+};
+
+static void lkp_ds_iter_unlock(struct lkp_ds_iter *it)
+{
+	if (it->rcu)
+		rcu_read_unlock();
+	it->rcu = false;
+}
+
+/* RCU for the current section, or nothing if it takes my_lock per entry */
+static void lkp_ds_iter_lock(struct lkp_ds_iter *it)
+{
+	bool locked = it->sect < LKP_DS_END && lkp_ds_sects[it->sect].locked;
+
+	if (locked) {
+		lkp_ds_iter_unlock(it);
+	} else if (!it->rcu) {
+		rcu_read_lock();
+		it->rcu = true;
+	}
+}
+
+/* Entry at position it->chain of bucket it->bkt, or the first one after */
+static struct my_entry *lkp_ds_hash_seek(struct lkp_ds_iter *it)
+{
+	struct lkp_ht_tbl *t;
+	struct my_entry *e;
+	unsigned int i;
+
+	/* same order as lkp_ht_for_each(): current array, then old one */
+	for (;;) {
+		t = it->old_tbl ? rcu_dereference(my_htable.old_tbl) :
+				  rcu_dereference(my_htable.tbl);
+		if (!t)
+			return NULL;
+		for (; it->bkt < 1U << t->bits; it->bkt++, it->chain = 0) {
+			i = 0;
+			hlist_for_each_entry_rcu(e, &t->buckets[it->bkt], hnode) {
+				if (i++ == it->chain)
+					return e;
+			}
+		}
+		if (it->old_tbl)
+			return NULL;
+		it->old_tbl = true;
+		it->bkt = 0;
+		it->chain = 0;
+	}
+}
+
+/* The entry after it->e: on along its chain, else the next bucket's first */
+static struct my_entry *lkp_ds_hash_next(struct lkp_ds_iter *it)
+{
+	struct hlist_node *node = rcu_dereference(hlist_next_rcu(&it->e->hnode));
+
+	if (node) {
+		it->chain++;
+		return hlist_entry(node, struct my_entry, hnode);
+	}
+	it->bkt++;
+	it->chain = 0;
+	return lkp_ds_hash_seek(it);
+}
+
+static struct my_entry *lkp_ds_tree_seek(struct lkp_ds_iter *it)
+{
+	struct my_entry *e;
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&my_tree_seq);
+		e = select_rbtree_os_rcu(&my_tree, it->rank);
+	} while (read_seqcount_retry(&my_tree_seq, seq));
+	return e;
+}
+
+/* lib/btree is not RCU-safe: look up and copy the value under my_lock */
+static struct my_entry *lkp_ds_btree_seek(struct lkp_ds_iter *it, u64 key)
+{
+	struct my_entry *e;
+
+	mutex_lock(&my_lock);
+	e = lkp_bt_ceil(&my_btree, &key);
+	if (e) {
+		it->key = lkp_key(e->value, e->index);
+		it->value = e->value;
+	}
+	mutex_unlock(&my_lock);
+	return e;
+}
+
+/*
+ * Point it->e at the entry the resume point names (or the first one
+ * after it if it went away), or with @next at the entry after it->e.
+ */
+static void lkp_ds_iter_seek(struct lkp_ds_iter *it, bool next)
+{
+	struct my_entry *e = it->e;
+	unsigned long index;
+	u64 key;
+
+	switch (it->sect) {
+	case LKP_DS_LIST:
+		if (next)
+			e = list_next_or_null_rcu(&my_list, &e->list,
+						  struct my_entry, list);
+		else
+			e = xa_find(&my_xarray, &it->index, ULONG_MAX, XA_PRESENT);
+		if (e)
+			it->index = e->index;
+		break;
+	case LKP_DS_HASH:
+		e = next ? lkp_ds_hash_next(it) : lkp_ds_hash_seek(it);
+		break;
+	case LKP_DS_TREE:
+		it->rank += next;
+		e = lkp_ds_tree_seek(it);
+		break;
+	case LKP_DS_XARRAY:
+		if (next)
+			e = xa_find_after(&my_xarray, &it->index, ULONG_MAX, XA_PRESENT);
+		else
+			e = xa_find(&my_xarray, &it->index, ULONG_MAX, XA_PRESENT);
+		break;
+	case LKP_DS_MAPLE:
+	case LKP_DS_BTREE:
+		key = it->key + next;
+		if (next && !key) {
+			e = NULL;
+			break;
+		}
+		if (it->sect == LKP_DS_BTREE) {
+			e = lkp_ds_btree_seek(it, key);
+			break;
+		}
+		index = key;
+		e = mt_find(&my_mtree, &index, ULONG_MAX);
+		if (e)
+			it->key = lkp_key(e->value, e->index);
+		break;
+	default:
+		e = NULL;
+		break;
+	}
+	/* the B+ tree's was copied under my_lock */
+	if (e && it->rcu)
+		it->value = e->value;
+	it->e = e;
+}
+
+/* Step to the next record; false once past the last section */
+static bool lkp_ds_iter_advance(struct lkp_ds_iter *it)
+{
+	it->pos++;
+	switch (it->rec) {
+	case LKP_DS_HEAD:
+		it->index = 0;
+		it->rank = 0;
+		it->old_tbl = false;
+		it->bkt = 0;
+		it->chain = 0;
+		it->key = 0;
+		lkp_ds_iter_seek(it, false);
+		break;
+	case LKP_DS_ENTRY:
+		lkp_ds_iter_seek(it, true);
+		break;
+	case LKP_DS_TAIL:
+		it->sect = find_next_bit(&it->sects, LKP_DS_END, it->sect + 1);
+		it->rec = LKP_DS_HEAD;
+		lkp_ds_iter_lock(it);
+		return it->sect < LKP_DS_END;
+	}
+	it->rec = it->e ? LKP_DS_ENTRY : LKP_DS_TAIL;
+	return true;
+}
+
+static void *lkp_ds_seq_start(struct seq_file *m, loff_t *pos)
+{
+	struct lkp_ds_iter *it = m->private;
+
+	if (!*pos || *pos != it->pos) {
+		/* first read, rewind or lseek(): walk forward from the top */
+		it->sects = (unsigned long)pde_data(file_inode(m->file));
+		it->sect = find_first_bit(&it->sects, LKP_DS_END);
+		it->rec = LKP_DS_HEAD;
+		it->pos = 0;
+		lkp_ds_iter_lock(it);
+		while (it->pos < *pos && it->sect < LKP_DS_END)
+			lkp_ds_iter_advance(it);
+	} else {
+		/* carry on where the previous read() stopped */
+		lkp_ds_iter_lock(it);
+		if (it->rec == LKP_DS_ENTRY) {
+			lkp_ds_iter_seek(it, false);
+			if (!it->e)
+				it->rec = LKP_DS_TAIL;
+		}
+	}
+	return it->sect < LKP_DS_END ? it : NULL;
+}
+
+static void *lkp_ds_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct lkp_ds_iter *it = v;
+	bool more = lkp_ds_iter_advance(it);
+
+	*pos = it->pos;
+	return more ? it : NULL;
+}
+
+static void lkp_ds_seq_stop(struct seq_file *m, void *v)
+{
+	lkp_ds_iter_unlock(m->private);
+}
+
+static int lkp_ds_seq_show(struct seq_file *m, void *v)
+{
+	struct lkp_ds_iter *it = v;
+
+	switch (it->rec) {
+	case LKP_DS_HEAD:
+		seq_printf(m, "%s", lkp_ds_sects[it->sect].head);
+		break;
+	case LKP_DS_ENTRY:
+		seq_printf(m, "%d, ", it->value);
+		break;
+	case LKP_DS_TAIL:
+		seq_printf(m, "\n");
+		break;
+	}
+	return 0;
+}
+
+static const struct seq_operations lkp_ds_seq_ops = {
+	.start = lkp_ds_seq_start,
+	.next  = lkp_ds_seq_next,
+	.stop  = lkp_ds_seq_stop,
+	.show  = lkp_ds_seq_show,
+};
+
+/* /proc/lkp_ds for @sects == LKP_DS_ALL, else one per-structure file */
+static struct proc_dir_entry *lkp_ds_proc_create(const char *name,
+						 unsigned long sects)
+{
+	return proc_create_seq_private(name, 0444, NULL, &lkp_ds_seq_ops,
+				       sizeof(struct lkp_ds_iter),
+				       (void *)sects);
+}
+
+/* ===================================================================
+ * Runtime control (/proc/lkp_ds_ctl)
+ * =================================================================== */
+
+/*
+ * Each open of /proc/lkp_ds_ctl is one transaction: write a command, then
+ * read its reply from the same descriptor. A command takes a whole
+ * comma-separated batch, so a single write()/read() pair covers up to
+ * SIMPLE_TRANSACTION_LIMIT bytes of keys:
+ *
+ *   add 5,6,7   -> "added 3"
+ *   del 3,4     -> "deleted 1 of 2"   (one entry per listed key)
+ *   find 9,5,8  -> "1/3 010"          (hits, then one flag per key)
+ *   rank 3,9    -> "2 5"              (entries smaller than each key)
+ *   select 0,7  -> "1 -"              (k-th smallest value, from 0)
+ *   clear       -> "cleared 5"        (every entry, no keys)
+ *
+ * add allocates the batch up front and links it under a single my_lock
+ * hold; del also takes my_lock once, find runs under one RCU read-side
+ * section against the hash table like the other lockless readers.
+ * rank and select descend the order-statistic rbtree under my_lock.
+ */
+enum lkp_ctl_cmd {
+	LKP_CTL_ADD,
+	LKP_CTL_DEL,
+	LKP_CTL_FIND,
+	LKP_CTL_RANK,
+	LKP_CTL_SELECT,
+	LKP_CTL_CLEAR,
+};
+
+static const char * const lkp_ctl_cmds[] = {
+	[LKP_CTL_ADD]    = "add",
+	[LKP_CTL_DEL]    = "del",
+	[LKP_CTL_FIND]   = "find",
+	[LKP_CTL_RANK]   = "rank",
+	[LKP_CTL_SELECT] = "select",
+	[LKP_CTL_CLEAR]  = "clear",
+};
+
+/* Parse "a,b,c" into a freshly allocated array; returns the count */
+static int lkp_ctl_parse(char *p, int **out)
+{
+	int *vals, n = 1, i = 0, err;
+	char *tok;
+
+	for (tok = p; *tok; tok++)
+		n += *tok == ',';
+	vals = kmalloc_array(n, sizeof(*vals), GFP_KERNEL);
+	if (!vals)
+		return -ENOMEM;
+
+	while ((tok = strsep(&p, ",")) != NULL) {
+		tok = strim(tok);
+		if (!*tok)
+			continue;
+		err = kstrtoint(tok, 0, &vals[i]);
+		if (err) {
+			kfree(vals);
+			return err;
+		}
+		i++;
+	}
+	if (!i) {
+		kfree(vals);
+		return -EINVAL;
+	}
+	*out = vals;
+	return i;
+}
+
+static int lkp_ctl_add(const int *vals, int n, char *reply)
+{
+	struct my_entry **ents;
+	int i, done = 0, err = 0;
+
+	ents = kvmalloc_array(n, sizeof(*ents), GFP_KERNEL);
+	if (!ents)
+		return -ENOMEM;
+	for (i = 0; i < n; i++) {
+		ents[i] = alloc_entry(vals[i]);
+		if (!ents[i]) {
+			err = -ENOMEM;
+			goto out;
+		}
+	}
+
+	mutex_lock(&my_lock);
+	for (; done < n; done++) {
+		err = link_entry(ents[done]);
 		if (err)
 			break;
+	}
+	mutex_unlock(&my_lock);
+out:
+	/* Entries past a failure were never linked */
+	while (i-- > done)
+		kfree(ents[i]);
+	kvfree(ents);
+
+	/* A partial batch stays linked, as at load time */
+	if (err && !done)
+		return err;
+	return sprintf(reply, "added %d\n", done);
+}
+
+static int lkp_ctl_del(const int *vals, int n, char *reply)
+{
+	struct my_entry *e;
+	int i, done = 0;
+
+	mutex_lock(&my_lock);
+	for (i = 0; i < n; i++) {
+		e = lkp_ht_find(&my_htable, vals[i]);
+		if (!e)
+			continue;
+		unlink_entry(e);
+		done++;
+	}
+	mutex_unlock(&my_lock);
+	return sprintf(reply, "deleted %d of %d\n", done, n);
+}
+
+static int lkp_ctl_find(const int *vals, int n, char *reply, size_t size)
+{
+	int i, hits = 0, len;
+	char *flags;
+
+	/* Reuse the reply page for the flags, shifted by the header later */
+	if ((size_t)n + 32 > size)
+		return -EFBIG;
+	flags = reply + size - n - 1;
+
+	rcu_read_lock();
+	for (i = 0; i < n; i++) {
+		flags[i] = lkp_ht_find(&my_htable, vals[i]) ? '1' : '0';
+		hits += flags[i] == '1';
+	}
+	rcu_read_unlock();
+	flags[n] = '\0';
+
+	len = scnprintf(reply, size - n - 1, "%d/%d ", hits, n);
+	memmove(reply + len, flags, n);
+	reply[len + n] = '\n';
+	return len + n + 1;
+}
+
+static int lkp_ctl_order(const int *vals, int n, char *reply, size_t size,
+			 bool select)
+{
+	struct my_entry *e;
+	int i, len = 0, err = 0;
+
+	mutex_lock(&my_lock);
+	for (i = 0; i < n; i++) {
+		/* room for "-2147483648 " and the newline */
+		if (size - len < 13) {
+			err = -EFBIG;
+			break;
+		}
+		if (!select) {
+			len += sprintf(reply + len, "%u ",
+				       rank_rbtree_os(&my_tree, vals[i]));
+			continue;
+		}
+		e = vals[i] >= 0 ? select_rbtree_os(&my_tree, vals[i]) : NULL;
+		if (e)
+			len += sprintf(reply + len, "%d ", e->value);
+		else
+			len += sprintf(reply + len, "- ");
+	}
+	mutex_unlock(&my_lock);
+	if (err)
+		return err;
+
+	reply[len - 1] = '\n';
+	return len;
+}
+
+/*
+ * "clear" empties every structure at once.  The entries are unlinked
+ * under my_lock right away; past LKP_REAP_ASYNC of them the grace
+ * period and the frees go to lkp_reap_wq so the writer does not wait.
+ */
+#define LKP_REAP_ASYNC	65536
+
+struct lkp_reap {
+	struct work_struct work;
+	struct rb_root root;
+};
+
+static struct workqueue_struct *lkp_reap_wq;
+
+static void lkp_reap_fn(struct work_struct *work)
+{
+	struct lkp_reap *reap = container_of(work, struct lkp_reap, work);
+	u64 start = ktime_get_ns();
+	unsigned long nr;
+
+	synchronize_rcu();
+	nr = lkp_free_tree(&reap->root);
+	pr_info("clear: freed %lu entries in %llu us\n", nr,
+		div_u64(ktime_get_ns() - start, NSEC_PER_USEC));
+	kfree(reap);
+}
+
+static int lkp_ctl_clear(char *reply)
+{
+	struct lkp_reap *reap;
+	unsigned long nr;
+
+	reap = kmalloc(sizeof(*reap), GFP_KERNEL);
+	if (!reap)
+		return -ENOMEM;
+	INIT_WORK(&reap->work, lkp_reap_fn);
+
+	mutex_lock(&my_lock);
+	nr = my_nr;
+	reap->root = detach_all();
+	mutex_unlock(&my_lock);
+
+	if (nr < LKP_REAP_ASYNC) {
+		lkp_reap_fn(&reap->work);
+		return sprintf(reply, "cleared %lu\n", nr);
+	}
+	queue_work(lkp_reap_wq, &reap->work);
+	return sprintf(reply, "cleared %lu, freeing in the background\n", nr);
+}
+
+static ssize_t lkp_ctl_write(struct file *file, const char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	char *buf, *p, *cmd;
+	int *vals = NULL, n, cmd_id, len;
+
+	buf = simple_transaction_get(file, ubuf, count);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	p = strim(buf);
+	cmd = strsep(&p, " \t");
+	cmd_id = match_string(lkp_ctl_cmds, ARRAY_SIZE(lkp_ctl_cmds), cmd);
+	if (cmd_id == LKP_CTL_CLEAR) {
+		if (p)
+			return -EINVAL;
+		len = lkp_ctl_clear(buf);
+		goto out;
+	}
+	if (cmd_id < 0 || !p)
+		return -EINVAL;
+
+	n = lkp_ctl_parse(p, &vals);
+	if (n < 0)
+		return n;
+
+	/* The keys are parsed out of @buf, so the reply may reuse it */
+	switch (cmd_id) {
+	case LKP_CTL_ADD:
+		len = lkp_ctl_add(vals, n, buf);
+		break;
+	case LKP_CTL_DEL:
+		len = lkp_ctl_del(vals, n, buf);
+		break;
+	case LKP_CTL_FIND:
+		len = lkp_ctl_find(vals, n, buf, SIMPLE_TRANSACTION_LIMIT);
+		break;
+	default:
+		len = lkp_ctl_order(vals, n, buf, SIMPLE_TRANSACTION_LIMIT,
+				    cmd_id == LKP_CTL_SELECT);
+		break;
+	}
+	kfree(vals);
+out:
+	if (len < 0)
+		return len;
+
+	simple_transaction_set(file, len);
+	return count;
+}
+
+static const struct proc_ops lkp_ctl_ops = {
+	.proc_write   = lkp_ctl_write,
+	.proc_read    = simple_transaction_read,
+	.proc_lseek   = default_llseek,
+	.proc_release = simple_transaction_release,
+};
+
+/* ===================================================================
+ * /proc/lkp_ds_load: bulk ingestion
+ * =================================================================== */
+
+/*
+ * int_str is capped by the module parameter size, so larger inputs are
+ * written here instead ("cat values.txt > /proc/lkp_ds_load").  Integers
+ * are separated by commas or whitespace, and a number may be split
+ * across write()s.  Each write() stores the values it completed as one
+ * batch through store_values() and returns its error: proc_ops has no
+ * ->flush, and what ->release returns never reaches close().  After an
+ * error the file takes no more data.  Only a last number with no
+ * separator after it is stored on close, where a failure is logged.
+ */
+struct lkp_load {
+	int *vals;
+	int nr, cap;
+	int err;                         /* sticky, set by a failed write */
+	char tok[16];                    /* number split across write()s */
+	int tok_len;
+};
+
+static int lkp_load_push(struct lkp_load *ld)
+{
+	int *vals, val, err;
+
+	if (!ld->tok_len)
+		return 0;
+	ld->tok[ld->tok_len] = '\0';
+	ld->tok_len = 0;
+	err = kstrtoint(ld->tok, 0, &val);
+	if (err)
+		return err;
+
+	if (ld->nr == ld->cap) {
+		if (ld->cap > INT_MAX / 2)
+			return -EFBIG;
+		vals = kvmalloc_array(max(ld->cap * 2, 1024), sizeof(*vals),
+				      GFP_KERNEL);
+		if (!vals)
+			return -ENOMEM;
+		memcpy(vals, ld->vals, ld->nr * sizeof(*vals));
+		kvfree(ld->vals);
+		ld->vals = vals;
+		ld->cap = max(ld->cap * 2, 1024);
+	}
+	ld->vals[ld->nr++] = val;
+	return 0;
+}
+
+static int lkp_load_open(struct inode *inode, struct file *file)
+{
+	file->private_data = kzalloc(sizeof(struct lkp_load), GFP_KERNEL);
+	return file->private_data ? 0 : -ENOMEM;
+}
+
+static ssize_t lkp_load_write(struct file *file, const char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	struct lkp_load *ld = file->private_data;
+	size_t done, len, i;
+	char buf[256];
+
+	for (done = 0; done < count && !ld->err; done += len) {
+		len = min(count - done, sizeof(buf));
+		if (copy_from_user(buf, ubuf + done, len)) {
+			ld->err = -EFAULT;
+			break;
+		}
+
+		for (i = 0; i < len && !ld->err; i++) {
+			if (buf[i] == ',' || isspace(buf[i]))
+				ld->err = lkp_load_push(ld);
+			else if (ld->tok_len == sizeof(ld->tok) - 1)
+				ld->err = -EINVAL;
+			else
+				ld->tok[ld->tok_len++] = buf[i];
+		}
+		cond_resched();
+	}
+	if (!ld->err)
+		ld->err = store_values(ld->vals, ld->nr, "lkp_ds_load");
+	ld->nr = 0;
+	return ld->err ? ld->err : (ssize_t)count;
+}
+
+static int lkp_load_release(struct inode *inode, struct file *file)
+{
+	struct lkp_load *ld = file->private_data;
+	int err;
+
+	/* errors from write() were returned there */
+	if (!ld->err && ld->tok_len) {
+		err = lkp_load_push(ld);
+		if (!err)
+			err = store_values(ld->vals, ld->nr, "lkp_ds_load");
+		if (err)
+			pr_err("lkp_ds_load: last value not stored (error %d)\n",
+			       err);
+	}
+
+	kvfree(ld->vals);
+	kfree(ld);
+	return 0;
+}
+
+static const struct proc_ops lkp_load_ops = {
+	.proc_open    = lkp_load_open,
+	.proc_write   = lkp_load_write,
+	.proc_lseek   = noop_llseek,
+	.proc_release = lkp_load_release,
+};
+
+/* ===================================================================
+ * /dev/lkp_ds: binary snapshot
+ * =================================================================== */
+
+/*
+ * /proc/lkp_ds formats every value as decimal text once per structure
+ * and the reader parses it back.  /dev/lkp_ds instead hands out a
+ * packed snapshot (layout in lkp_ds_snap.h): the values in rbtree order
+ * and in XArray order as little-endian int32 arrays, mmap()ed straight
+ * from a vmalloc_user() buffer, or read() for tools that cannot map.
+ *
+ * The snapshot is built on open() under my_lock and cached; later opens
+ * reuse it until my_gen says the structures changed.  A snapshot is
+ * never modified once built, so every open file keeps a reference to
+ * its own and mappings outlive a rebuild (the vma pins the file, and
+ * the file pins the snapshot).
+ */
+struct lkp_snap {
+	struct kref ref;
+	u64 gen;
+	size_t size;                     /* header plus arrays */
+	void *buf;                       /* vmalloc_user(), page aligned */
+};
+
+static struct lkp_snap *lkp_snap_cur;    /* latest snapshot, under my_lock */
+
+static void lkp_snap_release(struct kref *ref)
+{
+	struct lkp_snap *snap = container_of(ref, struct lkp_snap, ref);
+
+	vfree(snap->buf);
+	kfree(snap);
+}
+
+/* Caller holds my_lock */
+static struct lkp_snap *lkp_snap_build(void)
+{
+	struct lkp_snap_hdr *hdr;
+	struct lkp_snap *snap;
+	struct my_entry *e;
+	struct rb_node *node;
+	__le32 *sorted, *insert;
+	unsigned long idx, i;
+
+	snap = kzalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return ERR_PTR(-ENOMEM);
+	kref_init(&snap->ref);
+	snap->gen = my_gen;
+	snap->size = size_add(sizeof(*hdr),
+			      array_size(2 * sizeof(__le32), my_nr));
+	snap->buf = vmalloc_user(PAGE_ALIGN(snap->size));
+	if (!snap->buf) {
+		kfree(snap);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	hdr = snap->buf;
+	sorted = snap->buf + sizeof(*hdr);
+	insert = sorted + my_nr;
+
+	i = 0;
+	for (node = rb_first_cached(&my_tree); node; node = rb_next(node)) {
+		sorted[i++] = cpu_to_le32(rb_entry(node, struct my_entry,
+						   node)->value);
+		if (!(i % XA_CHECK_SCHED))
+			cond_resched();
+	}
+	WARN_ON_ONCE(i != my_nr);
+
+	i = 0;
+	xa_for_each(&my_xarray, idx, e) {
+		insert[i++] = cpu_to_le32(e->value);
+		if (!(i % XA_CHECK_SCHED))
+			cond_resched();
+	}
+	WARN_ON_ONCE(i != my_nr);
+
+	hdr->magic = cpu_to_le32(LKP_SNAP_MAGIC);
+	hdr->version = cpu_to_le32(LKP_SNAP_VERSION);
+	hdr->hdr_size = cpu_to_le32(sizeof(*hdr));
+	hdr->nr = cpu_to_le32(my_nr);
+	hdr->gen = cpu_to_le64(snap->gen);
+	hdr->sorted_off = cpu_to_le64((void *)sorted - snap->buf);
+	hdr->insert_off = cpu_to_le64((void *)insert - snap->buf);
+	hdr->size = cpu_to_le64(snap->size);
+	return snap;
+}
+
+static int lkp_snap_open(struct inode *inode, struct file *file)
+{
+	struct lkp_snap *snap;
+
+	mutex_lock(&my_lock);
+	snap = lkp_snap_cur;
+	if (!snap || snap->gen != my_gen) {
+		snap = lkp_snap_build();
+		if (IS_ERR(snap)) {
+			mutex_unlock(&my_lock);
+			return PTR_ERR(snap);
+		}
+		if (lkp_snap_cur)
+			kref_put(&lkp_snap_cur->ref, lkp_snap_release);
+		lkp_snap_cur = snap;
+	}
+	kref_get(&snap->ref);
+	mutex_unlock(&my_lock);
+
+	file->private_data = snap;
+	return 0;
+}
+
+static int lkp_snap_release_file(struct inode *inode, struct file *file)
+{
+	struct lkp_snap *snap = file->private_data;
+
+	kref_put(&snap->ref, lkp_snap_release);
+	return 0;
+}
+
+static ssize_t lkp_snap_read(struct file *file, char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	struct lkp_snap *snap = file->private_data;
+
+	return simple_read_from_buffer(ubuf, count, ppos, snap->buf,
+				       snap->size);
+}
+
+static int lkp_snap_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct lkp_snap *snap = file->private_data;
+
+	/* Shared by every opener of this generation, so never writable */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vm_flags_clear(vma, VM_MAYWRITE);
+	return remap_vmalloc_range(vma, snap->buf, vma->vm_pgoff);
+}
+
+static const struct file_operations lkp_snap_fops = {
+	.owner   = THIS_MODULE,
+	.open    = lkp_snap_open,
+	.read    = lkp_snap_read,
+	.mmap    = lkp_snap_mmap,
+	.llseek  = default_llseek,
+	.release = lkp_snap_release_file,
+};
+
+static struct miscdevice lkp_snap_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name  = "lkp_ds",
+	.fops  = &lkp_snap_fops,
+	.mode  = 0444,
+};
+
+/* ===================================================================
+ * Benchmark (Part B.3)
+ * =================================================================== */
+
+/*
+ * Each structure gets its own build/lookup/teardown routine so a run can
+ * pick any subset of them.  They use SEPARATE data structures so that
+ * benchmark data does not pollute the correctness data from int_str,
+ * and add their per-trial ns/op into the result; run_benchmark()
+ * divides by the trial count at the end.
+ */
+enum bench_id {
+	BENCH_LIST,
+	BENCH_HASH,
+	BENCH_RBTREE,
+	BENCH_XARRAY,                    /* indexed by insertion position */
+	BENCH_XAVAL,                     /* XArray keyed by value */
+	BENCH_MAPLE,                     /* keyed by lkp_key() */
+	BENCH_BTREE,                     /* lib/btree, keyed by lkp_key() */
+	BENCH_NR,
+};
+
+/* The userspace build's maple tree is an rbtree stand-in, not worth timing */
+#ifdef __KERNEL__
+#define LKP_BENCH_MAPLE	1
+#else
+#define LKP_BENCH_MAPLE	0
+#endif
+
+#define BENCH_ALL	((BIT(BENCH_NR) - 1) & \
+			 ~(LKP_HAVE_BTREE ? 0 : BIT(BENCH_BTREE)) & \
+			 ~(LKP_BENCH_MAPLE ? 0 : BIT(BENCH_MAPLE)))
+
+/* Reader/writer schemes compared by the concurrent benchmark */
+enum bench_sync {
+	BENCH_SYNC_RWLOCK,
+	BENCH_SYNC_RCU,
+	BENCH_SYNC_NR,
+};
+
+static const char * const bench_sync_names[BENCH_SYNC_NR] = {
+	[BENCH_SYNC_RWLOCK] = "rwlock",
+	[BENCH_SYNC_RCU]    = "rcu",
+};
+
+/*
+ * Where benchmark entries come from.  kmalloc is what store_value()
+ * uses; "cache" is the dedicated my_entry_cache; "pool" carves entries
+ * out of one big arena allocated per run, so allocation is a pointer
+ * bump and freeing individual entries is a no-op.
+ */
+enum bench_alloc_mode {
+	BENCH_ALLOC_KMALLOC,
+	BENCH_ALLOC_CACHE,
+	BENCH_ALLOC_POOL,
+	BENCH_ALLOC_NR,
+};
+
+static const char * const bench_alloc_names[BENCH_ALLOC_NR] = {
+	[BENCH_ALLOC_KMALLOC] = "kmalloc",
+	[BENCH_ALLOC_CACHE]   = "cache",
+	[BENCH_ALLOC_POOL]    = "pool",
+};
+
+/* Benchmark key sets and lookup patterns */
+enum bench_key_dist {
+	BENCH_KEYS_UNIFORM,              /* random keys below 1000000 */
+	BENCH_KEYS_SEQUENTIAL,           /* 0, 1, 2, ... */
+	BENCH_KEYS_REVERSE,              /* n - 1, n - 2, ... 0 */
+	BENCH_KEYS_CLUSTERED,            /* dense runs scattered over 2^31 */
+	BENCH_KEYS_ZIPF,                 /* uniform keys, Zipfian lookups */
+	BENCH_KEYS_HOTSET,               /* uniform keys, hot-set lookups */
+	BENCH_KEYS_NR,
+};
+
+static const char * const bench_key_dist_names[BENCH_KEYS_NR] = {
+	[BENCH_KEYS_UNIFORM]    = "uniform",
+	[BENCH_KEYS_SEQUENTIAL] = "sequential",
+	[BENCH_KEYS_REVERSE]    = "reverse",
+	[BENCH_KEYS_CLUSTERED]  = "clustered",
+	[BENCH_KEYS_ZIPF]       = "zipf",
+	[BENCH_KEYS_HOTSET]     = "hotset",
+};
+
+/* Range scan widths per run, and the structures that support scans */
+#define BENCH_RANGE_MAX		6
+#define BENCH_RANGE_STRUCTS	(BENCH_ALL & ~BIT(BENCH_XARRAY))
+
+/* Structures with a bulk load path, see bulk_store() */
+#define BENCH_BULK_STRUCTS	(BIT(BENCH_HASH) | BIT(BENCH_RBTREE) | \
+				 BIT(BENCH_XARRAY))
+
+/* One benchmark run as requested at load time or via /proc/lkp_ds_bench */
+struct bench_cfg {
+	int n;
+	int trials;
+	unsigned long structs;           /* BIT(BENCH_*) */
+	int threads;                     /* >0: concurrent mode, max threads */
+	int ops;                         /* concurrent ops per thread */
+	int write_pct;                   /* concurrent inserts, percent */
+	unsigned long sync;              /* BIT(BENCH_SYNC_*) */
+	enum bench_alloc_mode alloc;     /* entry allocator, single-threaded */
+	int sample;                      /* time every Nth op, 0 = off */
+	enum bench_key_dist key_dist;
+	u64 seed;                        /* 0 = pick one at run time */
+	int theta;                       /* zipf skew, hundredths */
+	int hot_ops;                     /* hotset: % of lookups ... */
+	int hot_keys;                    /* ... that hit this % of keys */
+	int cluster;                     /* clustered: keys per run */
+	int hit_pct;                     /* present keys in the mixed phase */
+	bool pmu;                        /* read perf counters per phase */
+	bool split;                      /* also run the split node layout */
+	int ranges[BENCH_RANGE_MAX];     /* range scan widths */
+	int nr_ranges;                   /* 0 = no range scans */
+	int range_q;                     /* range queries per width */
+	int os_q;                        /* rank/select queries, rbtree */
+	int warmup;                      /* discarded trials before the first */
+	int cpu;                         /* run pinned here, -1 = anywhere */
+	bool nopreempt;                  /* lookup phases with preemption off */
+	bool shuffle;                    /* look keys up in random order */
+	bool numa;                       /* local/remote/interleaved memory */
+	int node;                        /* numa=1 memory node, -1 = first */
+	int alloc_node;                  /* entries, set by bench_numa_run() */
+};
+
+/* Per-trial samples kept for the statistics, see bench_cell() */
+#define BENCH_TRIALS_MAX	100
+
+/*
+ * Largest n (and ops per thread): a run holds about 150 bytes per key
+ * between keys, probes and entries, and the list phases are O(n^2).
+ */
+#define BENCH_N_MAX		(1 << 22)
+
+/* Largest n for nopreempt=1, see bench_lookup_begin() */
+#define BENCH_NOPREEMPT_MAX	(1 << 14)
+
+#define BENCH_MT_LEVELS	16	/* 1, 2, 4, ... threads */
+
+struct bench_mt_cell {
+	int threads;
+	u64 ops_per_sec;                 /* aggregate over all threads */
+	u64 mean_ns;                     /* per-thread ns/op, averaged */
+	u64 max_ns;                      /* slowest thread's ns/op */
+};
+
+/* Operations with a latency histogram */
+enum bench_op {
+	BENCH_OP_INSERT,
+	BENCH_OP_LOOKUP,                 /* keys that are present */
+	BENCH_OP_MISS,                   /* keys that are absent */
+	BENCH_OP_MIXED,                  /* hit_pct% present */
+	BENCH_OP_DELETE,
+	BENCH_OP_NR,
+};
+
+static const char * const bench_op_names[BENCH_OP_NR] = {
+	[BENCH_OP_INSERT] = "insert",
+	[BENCH_OP_LOOKUP] = "lookup",
+	[BENCH_OP_MISS]   = "miss",
+	[BENCH_OP_MIXED]  = "mixed",
+	[BENCH_OP_DELETE] = "delete",
+};
+
+/*
+ * Counters read around each timed phase. The hardware events are what
+ * explain a ns/op figure (IPC, cache and TLB misses); the software ones
+ * are always there, so a VM without a PMU still gets task-clock and
+ * page faults. Events that fail to open are simply left out.
+ */
+enum bench_pmu_ev {
+	BENCH_PMU_CYCLES,
+	BENCH_PMU_INSNS,
+	BENCH_PMU_L1D,
+	BENCH_PMU_LLC,
+	BENCH_PMU_DTLB,
+	BENCH_PMU_BRANCH,
+	BENCH_PMU_TASK_CLOCK,
+	BENCH_PMU_FAULTS,
+	BENCH_PMU_NR,
+};
+
+#define BENCH_PMU_HW_MASK	(BIT(BENCH_PMU_TASK_CLOCK) - 1)
+#define BENCH_PMU_CACHE_MISS(c)	((c) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+				 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct {
+	const char *name;
+	u32 type;
+	u64 config;
+} bench_pmu_evs[BENCH_PMU_NR] = {
+	[BENCH_PMU_CYCLES]     = { "cycles", PERF_TYPE_HARDWARE,
+				   PERF_COUNT_HW_CPU_CYCLES },
+	[BENCH_PMU_INSNS]      = { "instr", PERF_TYPE_HARDWARE,
+				   PERF_COUNT_HW_INSTRUCTIONS },
+	[BENCH_PMU_L1D]        = { "L1d-miss", PERF_TYPE_HW_CACHE,
+				   BENCH_PMU_CACHE_MISS(PERF_COUNT_HW_CACHE_L1D) },
+	[BENCH_PMU_LLC]        = { "LLC-miss", PERF_TYPE_HW_CACHE,
+				   BENCH_PMU_CACHE_MISS(PERF_COUNT_HW_CACHE_LL) },
+	[BENCH_PMU_DTLB]       = { "dTLB-miss", PERF_TYPE_HW_CACHE,
+				   BENCH_PMU_CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB) },
+	[BENCH_PMU_BRANCH]     = { "br-miss", PERF_TYPE_HARDWARE,
+				   PERF_COUNT_HW_BRANCH_MISSES },
+	[BENCH_PMU_TASK_CLOCK] = { "task-ns", PERF_TYPE_SOFTWARE,
+				   PERF_COUNT_SW_TASK_CLOCK },
+	[BENCH_PMU_FAULTS]     = { "faults", PERF_TYPE_SOFTWARE,
+				   PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+/*
+ * Log-linear latency histogram: values below BENCH_HIST_SUB ns get a
+ * bucket each, above that every power of two is split into
+ * BENCH_HIST_SUB buckets, so the relative error stays under 12.5%
+ * from a few ns up to seconds.
+ */
+#define BENCH_HIST_SUB_BITS	3
+#define BENCH_HIST_SUB		(1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS	((64 - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB)
+
+struct bench_hist {
+	u64 count;
+	u64 max;
+	u32 buckets[BENCH_HIST_BUCKETS];
+};
+
+/* XArray layouts whose xa_node count is reported */
+enum bench_xa_mem {
+	BENCH_XA_MEM_INDEX,              /* "xarray": indices 0..n-1 */
+	BENCH_XA_MEM_VALUE,              /* "xaval": the run's keys */
+	BENCH_XA_MEM_SPARSE,             /* n random keys below 2^32 */
+	BENCH_XA_MEM_NR,
+};
+
+/* Order-statistic queries, plain rbtree walk vs size-augmented tree */
+enum bench_os_op {
+	BENCH_OS_SELECT,                 /* k-th smallest */
+	BENCH_OS_RANK,                   /* entries below a key */
+	BENCH_OS_MIN,
+	BENCH_OS_NR,
+};
+
+static const char * const bench_os_names[BENCH_OS_NR] = {
+	[BENCH_OS_SELECT] = "Select",
+	[BENCH_OS_RANK]   = "Rank",
+	[BENCH_OS_MIN]    = "Min",
+};
+
+/* Phases with one ns/op figure per structure and trial */
+enum bench_cell {
+	BENCH_CELL_INSERT,
+	BENCH_CELL_INSERT_ONLY,
+	BENCH_CELL_LOOKUP,
+	BENCH_CELL_MISS,
+	BENCH_CELL_MIXED,
+	BENCH_CELL_DELETE,
+	BENCH_CELL_BULK,
+	BENCH_CELL_TEARDOWN,
+	BENCH_CELL_NR,
+};
+
+static const char * const bench_cell_names[BENCH_CELL_NR] = {
+	[BENCH_CELL_INSERT]      = "Insert",
+	[BENCH_CELL_INSERT_ONLY] = "Insert pre-allocated",
+	[BENCH_CELL_LOOKUP]      = "Lookup",
+	[BENCH_CELL_MISS]        = "Lookup miss",
+	[BENCH_CELL_MIXED]       = "Lookup mixed",
+	[BENCH_CELL_DELETE]      = "Delete",
+	[BENCH_CELL_BULK]        = "Bulk load",
+	[BENCH_CELL_TEARDOWN]    = "Teardown",
+};
+
+/* numa=1 variants: where the entries live relative to the running CPU */
+enum bench_numa_var {
+	BENCH_NUMA_LOCAL,
+	BENCH_NUMA_REMOTE,
+	BENCH_NUMA_INTERLEAVE,
+	BENCH_NUMA_NR,
+};
+
+static const char * const bench_numa_names[BENCH_NUMA_NR] = {
+	[BENCH_NUMA_LOCAL]      = "local",
+	[BENCH_NUMA_REMOTE]     = "remote",
+	[BENCH_NUMA_INTERLEAVE] = "interleave",
+};
+
+/*
+ * Footprint of one fully built structure, from what was actually handed
+ * out: entries at their slab object size, plus internal nodes and
+ * bucket arrays.  Slack is allocated minus requested bytes (kmalloc
+ * size classes, kvmalloc page rounding); partially filled slab pages
+ * are not counted.
+ */
+struct bench_mem {
+	u64 entries;                     /* entry objects as allocated */
+	u64 nodes;                       /* internal nodes, bucket arrays */
+	u64 slack;                       /* rounding in both of the above */
+};
+
+struct bench_result {
+	struct bench_cfg cfg;
+	int err;                         /* 0 or -errno of a failed run */
+	u64 insert_ns[BENCH_NR];         /* allocate + insert */
+	u64 insert_only_ns[BENCH_NR];    /* insert of pre-allocated entries */
+	u64 bulk_ns[BENCH_NR];           /* bulk load of the same entries */
+	u64 lookup_ns[BENCH_NR];
+	u64 miss_ns[BENCH_NR];
+	u64 mixed_ns[BENCH_NR];
+	u64 delete_ns[BENCH_NR];         /* search + unlink, random order */
+	u64 teardown_ns[BENCH_NR];       /* destroy the whole structure, per entry */
+	u64 alloc_ns;                    /* allocate only, all structures */
+	int alloc_runs;                  /* samples summed into alloc_ns */
+	struct bench_hist hist[BENCH_NR][BENCH_OP_NR];
+	u64 pmu[BENCH_NR][BENCH_OP_NR][BENCH_PMU_NR];  /* summed over trials */
+	unsigned long pmu_avail;         /* BIT(BENCH_PMU_*) that opened */
+	u64 split_ns[BENCH_NR][BENCH_OP_NR];  /* split layout: insert, lookup, miss */
+	u64 split_pmu[BENCH_NR][BENCH_OP_NR][BENCH_PMU_NR];
+	struct bench_hist split_hist[BENCH_NR][BENCH_OP_NR];
+	unsigned int split_bytes[BENCH_NR];   /* node object size, 0 = none */
+	u64 range_ns[BENCH_NR][BENCH_RANGE_MAX + 1];    /* [0] = next >= lo */
+	u64 range_elems[BENCH_NR][BENCH_RANGE_MAX + 1]; /* keys found, summed */
+	u64 os_ns[BENCH_OS_NR][2];       /* [0] = in-order walk, [1] = augmented */
+	u64 os_insert_ns;                /* augmented insert, pre-allocated */
+	u64 bulk_sort_ns;                /* rbtree bulk_ns: sort() part */
+	u64 bulk_build_ns;               /* rbtree bulk_ns: lkp_rb_build() part */
+	unsigned long xa_nodes[BENCH_XA_MEM_NR];
+	struct bench_mem mem[BENCH_NR];  /* after the pre-allocated insert */
+	unsigned int hash_buckets;       /* hash table shape after insert */
+	unsigned long hash_load;         /* load factor * 100 */
+	unsigned int hash_chain;         /* longest chain */
+	int mt_levels;
+	struct bench_mt_cell mt[BENCH_SYNC_NR][BENCH_NR][BENCH_MT_LEVELS];
+	u32 samples[BENCH_CELL_NR][BENCH_NR][BENCH_TRIALS_MAX];  /* ns/op */
+	int numa_node;                   /* memory node of the numa=1 run */
+	int numa_cpu[BENCH_NUMA_NR];     /* CPU per variant, -1 = not run */
+	u64 numa_ns[BENCH_NUMA_NR][2][BENCH_NR];  /* [0] insert, [1] lookup */
+};
+
+/* The per-structure sums behind @cell */
+static u64 *bench_cell(struct bench_result *res, enum bench_cell cell)
+{
+	switch (cell) {
+	case BENCH_CELL_INSERT:
+		return res->insert_ns;
+	case BENCH_CELL_INSERT_ONLY:
+		return res->insert_only_ns;
+	case BENCH_CELL_LOOKUP:
+		return res->lookup_ns;
+	case BENCH_CELL_MISS:
+		return res->miss_ns;
+	case BENCH_CELL_MIXED:
+		return res->mixed_ns;
+	case BENCH_CELL_DELETE:
+		return res->delete_ns;
+	case BENCH_CELL_TEARDOWN:
+		return res->teardown_ns;
+	default:
+		return res->bulk_ns;
+	}
+}
+
+static unsigned int bench_hist_index(u64 ns)
+{
+	unsigned int shift;
+
+	if (ns < BENCH_HIST_SUB)
+		return ns;
+	shift = ilog2(ns) - BENCH_HIST_SUB_BITS;
+	return (shift + 1) * BENCH_HIST_SUB + (ns >> shift) - BENCH_HIST_SUB;
+}
+
+/* Smallest value that lands in bucket @idx */
+static u64 bench_hist_lower(unsigned int idx)
+{
+	unsigned int shift;
+
+	if (idx < BENCH_HIST_SUB)
+		return idx;
+	shift = idx / BENCH_HIST_SUB - 1;
+	return (u64)(BENCH_HIST_SUB + idx % BENCH_HIST_SUB) << shift;
+}
+
+static inline void bench_hist_add(struct bench_hist *h, u64 ns)
+{
+	h->buckets[bench_hist_index(ns)]++;
+	h->count++;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+/*
+ * Value at or below which @permille tenths of a percent of the samples
+ * fall, reported as the upper end of its bucket (never above max).
+ */
+static u64 bench_hist_pct(const struct bench_hist *h, unsigned int permille)
+{
+	u64 want, seen = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+	want = div_u64(h->count * permille + 999, 1000);
+	for (i = 0; i < BENCH_HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= want)
+			return min(bench_hist_lower(i + 1) - 1, h->max);
+	}
+	return h->max;
+}
+
+/*
+ * One allocator per object type: struct my_entry for the shared layout,
+ * and each split layout node type its own.
+ */
+struct bench_alloc {
+	enum bench_alloc_mode mode;
+	struct kmem_cache *cache;        /* BENCH_ALLOC_CACHE */
+	size_t size;                     /* object size */
+	void *pool;                      /* BENCH_ALLOC_POOL arena */
+	void **pool_nodes;               /* interleaved: one arena per node */
+	int pool_nr_nodes;
+	int pool_next;
+	int pool_nr;
+	int node;                        /* NUMA_NO_NODE, a node or interleave */
+	int next_node;                   /* interleave: last node used */
+};
+
+/* bench_alloc.node: spread entries round-robin over the memory nodes */
+#define BENCH_NODE_INTERLEAVE	(-2)
+
+/* Node for allocations that cannot be interleaved, e.g. bucket arrays */
+static inline int bench_alloc_node(const struct bench_alloc *a)
+{
+	return a->node == BENCH_NODE_INTERLEAVE ? NUMA_NO_NODE : a->node;
+}
+
+/*
+ * Entry i of an interleaved pool comes from arena i % nodes, the same
+ * round-robin bench_entry_alloc() follows for the other modes.
+ */
+static inline void *bench_pool_alloc(struct bench_alloc *a)
+{
+	int i = a->pool_next;
+
+	if (i >= a->pool_nr)
+		return NULL;
+	a->pool_next++;
+	if (!a->pool)
+		return a->pool_nodes[i % a->pool_nr_nodes] +
+		       (size_t)(i / a->pool_nr_nodes) * a->size;
+	return a->pool + (size_t)i * a->size;
+}
+
+static inline void *bench_entry_alloc(struct bench_alloc *a)
+{
+	int node = a->node;
+
+	if (node == BENCH_NODE_INTERLEAVE)
+		node = a->next_node = next_node_in(a->next_node,
+						   node_states[N_MEMORY]);
+
+	switch (a->mode) {
+	case BENCH_ALLOC_CACHE:
+		return kmem_cache_alloc_node(a->cache, GFP_KERNEL, node);
+	case BENCH_ALLOC_POOL:
+		return bench_pool_alloc(a);
+	default:
+		return kmalloc_node(a->size, GFP_KERNEL, node);
+	}
+}
+
+static inline void bench_entry_free(struct bench_alloc *a, void *e)
+{
+	switch (a->mode) {
+	case BENCH_ALLOC_CACHE:
+		kmem_cache_free(a->cache, e);
+		break;
+	case BENCH_ALLOC_POOL:
+		break;                   /* whole arena is reused or freed */
+	default:
+		kfree(e);
+		break;
+	}
+}
+
+/* Batched bench_entry_free(): @fb comes from bench_free_batch() */
+static inline void bench_entry_free_batch(struct bench_alloc *a,
+					  struct lkp_free_batch *fb,
+					  struct my_entry *e)
+{
+	if (a->mode != BENCH_ALLOC_POOL)
+		lkp_free_add(fb, e);
+}
+
+static inline struct lkp_free_batch bench_free_batch(const struct bench_alloc *a)
+{
+	return (struct lkp_free_batch) {
+		.cache = a->mode == BENCH_ALLOC_CACHE ? a->cache : NULL,
+	};
+}
+
+static void bench_alloc_release(struct bench_alloc *a)
+{
+	int k;
+
+	for (k = 0; k < a->pool_nr_nodes; k++)
+		kvfree(a->pool_nodes[k]);
+	kfree(a->pool_nodes);
+	a->pool_nodes = NULL;
+	a->pool_nr_nodes = 0;
+	kvfree(a->pool);
+	a->pool = NULL;
+}
+
+/* Interleaved pool: one arena on each memory node, n / nodes entries each */
+static int bench_pool_interleave(struct bench_alloc *a, int n)
+{
+	int nr = num_node_state(N_MEMORY), per = DIV_ROUND_UP(n, nr);
+	int nid;
+
+	a->pool_nodes = kcalloc(nr, sizeof(*a->pool_nodes), GFP_KERNEL);
+	if (!a->pool_nodes)
+		return -ENOMEM;
+	for_each_node_state(nid, N_MEMORY) {
+		if (a->pool_nr_nodes == nr)
+			break;                   /* a node came online meanwhile */
+		a->pool_nodes[a->pool_nr_nodes] =
+			kvmalloc_node(array_size(per, a->size), GFP_KERNEL, nid);
+		if (!a->pool_nodes[a->pool_nr_nodes])
+			goto fail;
+		a->pool_nr_nodes++;
+	}
+	if (!a->pool_nr_nodes)
+		goto fail;
+	/* a node went away meanwhile: the arenas hold fewer than n */
+	a->pool_nr = min(n, per * a->pool_nr_nodes);
+	return 0;
+
+fail:
+	bench_alloc_release(a);
+	return -ENOMEM;
+}
+
+/* @cache is only used with BENCH_ALLOC_CACHE and must hold @size objects */
+static int bench_alloc_init(struct bench_alloc *a, enum bench_alloc_mode mode,
+			    struct kmem_cache *cache, size_t size, int n,
+			    int node)
+{
+	memset(a, 0, sizeof(*a));
+	a->mode = mode;
+	a->cache = cache;
+	a->size = size;
+	a->node = node;
+	a->next_node = MAX_NUMNODES;     /* next_node_in() wraps to the first */
+	if (mode != BENCH_ALLOC_POOL)
+		return 0;
+
+	if (node == BENCH_NODE_INTERLEAVE)
+		return bench_pool_interleave(a, n);
+	a->pool = kvmalloc_node(array_size(n, size), GFP_KERNEL,
+				bench_alloc_node(a));
+	if (!a->pool)
+		return -ENOMEM;
+	a->pool_nr = n;
+	return 0;
+}
+
+/* All entries have been freed: make the whole arena available again. */
+static inline void bench_alloc_reset(struct bench_alloc *a)
+{
+	a->pool_next = 0;
+}
+
+/* One lookup: the key, or for the XArray the index it is stored at */
+struct bench_probe {
+	u32 key;
+	u32 idx;
+};
+
+/*
+ * The positional XArray keeps keys[i] at index i, so every unused index
+ * is past the last entry and a miss would stop at the top of the tree.
+ * The miss and mixed phases probe an untimed copy with keys[i] at
+ * i * BENCH_XA_STRIDE instead, misses at the odd holes, so they walk
+ * down to a leaf like a hit does.  Their idx is in that copy.
+ */
+#define BENCH_XA_STRIDE		2
+
+struct bench_pmu {
+	struct perf_event *ev[BENCH_PMU_NR];
+	u64 snap[BENCH_PMU_NR];          /* values at phase start */
+};
+
+/* State shared by the per-structure routines of one run */
+struct bench_run {
+	const u32 *keys;
+	int n;
+	int sample;                      /* power of two, 0 = no histograms */
+	struct bench_alloc alloc;
+	struct my_entry **ents;          /* pre-allocated entries */
+	struct bench_probe *hit;         /* n present keys */
+	struct bench_probe *miss;        /* n absent keys */
+	struct bench_probe *mixed;       /* n keys, hit_pct% present */
+	u32 *del_order;                  /* positions in keys[], shuffled */
+	u64 found;                       /* lookup sink */
+	struct bench_pmu pmu;
+	struct bench_hist *hist;         /* res->hist[id] or ->split_hist[id] */
+	u64 (*pmu_acc)[BENCH_PMU_NR];    /* res->pmu[id] of the running struct */
+	struct bench_alloc *node_alloc;  /* split layout nodes */
+	bool nopreempt;                  /* cfg->nopreempt */
+	bool atomic;                     /* inside a preempt-disabled phase */
+	bool stop;                       /* bench_stop seen, cut phases short */
+};
+
+/* Ops between two cond_resched() calls in the timed loops */
+#define BENCH_RESCHED_MASK	1023
+
+/*
+ * Progress of the run in flight, in units of one structure run (one
+ * thread count in concurrent mode).  bench_stop is set by rmmod; the
+ * timed loops notice it within BENCH_RESCHED_MASK ops and skip the rest
+ * of their phase, and the run ends with -ECANCELED at the next unit
+ * boundary.
+ */
+static atomic_t bench_units_done;
+static int bench_units;
+static bool bench_stop;
+
+static int bench_tick(void)
+{
+	atomic_inc(&bench_units_done);
+	return READ_ONCE(bench_stop) ? -ECANCELED : 0;
+}
+
+/*
+ * Per-operation timing for the histograms.  Only every r->sample'th
+ * op pays for the two extra clock reads; the rest return 0 and are
+ * skipped by bench_op_end().  Every timed loop passes through here, so
+ * this is also where long phases (list lookups are O(n) each) give the
+ * CPU up and check for rmmod, outside the sampled window.
+ */
+static inline u64 bench_op_begin(struct bench_run *r, int i)
+{
+	if (!(i & BENCH_RESCHED_MASK)) {
+		if (!r->atomic)
+			cond_resched();
+		if (READ_ONCE(bench_stop))
+			r->stop = true;
+	}
+	if (!r->sample || (i & (r->sample - 1)))
+		return 0;
+	return ktime_get_ns();
+}
+
+static inline void bench_op_end(struct bench_hist *h, u64 t0)
+{
+	if (t0)
+		bench_hist_add(h, ktime_get_ns() - t0);
+}
+
+/*
+ * Counters follow the benchmark task rather than a CPU, so they stay
+ * right when the unbound worker migrates. Returns the events that
+ * opened; without CONFIG_PERF_EVENTS or a PMU that is just the
+ * software ones, or nothing.
+ */
+static unsigned long bench_pmu_open(struct bench_pmu *p)
+{
+	struct perf_event_attr attr;
+	struct perf_event *ev;
+	unsigned long avail = 0;
+	int i;
+
+	for (i = 0; i < BENCH_PMU_NR; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.type = bench_pmu_evs[i].type;
+		attr.config = bench_pmu_evs[i].config;
+		attr.size = sizeof(attr);
+		attr.exclude_hv = 1;
+
+		ev = perf_event_create_kernel_counter(&attr, -1, current,
+						      NULL, NULL);
+		if (IS_ERR(ev)) {
+			p->ev[i] = NULL;
+			continue;
+		}
+		p->ev[i] = ev;
+		avail |= BIT(i);
+	}
+	return avail;
+}
+
+static void bench_pmu_close(struct bench_pmu *p)
+{
+	int i;
+
+	for (i = 0; i < BENCH_PMU_NR; i++) {
+		if (p->ev[i])
+			perf_event_release_kernel(p->ev[i]);
+		p->ev[i] = NULL;
+	}
+}
+
+/* Scaled for multiplexing when more events are open than counters exist */
+static void bench_pmu_read(struct bench_pmu *p, u64 *vals)
+{
+	u64 enabled, running;
+	int i;
+
+	for (i = 0; i < BENCH_PMU_NR; i++) {
+		if (!p->ev[i])
+			continue;
+		vals[i] = perf_event_read_value(p->ev[i], &enabled, &running);
+		if (running && running < enabled)
+			vals[i] = mul_u64_u64_div_u64(vals[i], enabled, running);
+	}
+}
+
+/* Start a timed phase of r->n operations */
+static u64 bench_phase_begin(struct bench_run *r)
+{
+	bench_pmu_read(&r->pmu, r->pmu.snap);
+	return ktime_get_ns();
+}
+
+/* Charge the counters since bench_phase_begin() to @op; @ns is the phase */
+static u64 bench_phase_account(struct bench_run *r, enum bench_op op, u64 ns)
+{
+	u64 vals[BENCH_PMU_NR];
+	int i;
+
+	bench_pmu_read(&r->pmu, vals);
+	for (i = 0; i < BENCH_PMU_NR; i++)
+		if (r->pmu.ev[i])
+			r->pmu_acc[op][i] += vals[i] - r->pmu.snap[i];
+	return ns / r->n;
+}
+
+/* End it: add the counter deltas under @op and return ns/op */
+static u64 bench_phase_end(struct bench_run *r, enum bench_op op, u64 start)
+{
+	return bench_phase_account(r, op, ktime_get_ns() - start);
+}
+
+/*
+ * The lookup phases only read, so with nopreempt=1 they run with
+ * preemption disabled and nothing else is scheduled inside the timed
+ * window.  The counters are read outside it, perf_event_read_value()
+ * may sleep.  A list phase is O(n^2), so bench_parse_opts() caps n at
+ * BENCH_NOPREEMPT_MAX to stay well clear of the soft-lockup and RCU
+ * stall detectors.
+ */
+static u64 bench_lookup_begin(struct bench_run *r)
+{
+	bench_pmu_read(&r->pmu, r->pmu.snap);
+	if (r->nopreempt) {
+		preempt_disable();
+		r->atomic = true;
+	}
+	return ktime_get_ns();
+}
+
+static u64 bench_lookup_end(struct bench_run *r, enum bench_op op, u64 start)
+{
+	u64 ns = ktime_get_ns() - start;
+
+	if (r->atomic) {
+		r->atomic = false;
+		preempt_enable();
+	}
+	return bench_phase_account(r, op, ns);
+}
+
+/*
+ * Allocate-only phase: fill r->ents with n fresh entries so the
+ * following insert phase measures the data structure alone.
+ */
+static int bench_prealloc(struct bench_run *r, struct bench_result *res)
+{
+	u64 start;
+	int i;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n; i++) {
+		r->ents[i] = bench_entry_alloc(&r->alloc);
+		if (!r->ents[i])
+			goto fail;
+	}
+	res->alloc_ns += (ktime_get_ns() - start) / r->n;
+	res->alloc_runs++;
+
+	for (i = 0; i < r->n; i++)
+		r->ents[i]->value = r->keys[i];
+	return 0;
+
+fail:
+	while (i--)
+		bench_entry_free(&r->alloc, r->ents[i]);
+	bench_alloc_reset(&r->alloc);
+	return -ENOMEM;
+}
+
+/*
+ * --- Per-structure teardown: free every entry, leave it empty ---
+ *
+ * The structure is thrown away as a whole, so nothing is unlinked one
+ * entry at a time: list and hash chains are walked once and reset,
+ * the rbtree is freed in postorder without rebalancing, and the XArray
+ * drops its nodes in xa_destroy() rather than per xa_erase().  Entries
+ * go back in batches through kmem_cache_free_bulk().
+ */
+
+static void bench_list_destroy(struct list_head *head, struct bench_alloc *a)
+{
+	struct lkp_free_batch fb = bench_free_batch(a);
+	struct my_entry *e, *tmp;
+
+	list_for_each_entry_safe(e, tmp, head, list)
+		bench_entry_free_batch(a, &fb, e);
+	lkp_free_flush(&fb);
+	INIT_LIST_HEAD(head);
+	bench_alloc_reset(a);
+}
+
+/* Bucket by bucket; also frees the bucket arrays */
+static void bench_hash_destroy(struct lkp_htable *ht, struct bench_alloc *a)
+{
+	struct lkp_free_batch fb = bench_free_batch(a);
+	struct lkp_ht_tbl *t;
+	struct my_entry *e;
+	struct hlist_node *tmp;
+	unsigned int bkt;
+
+	lkp_ht_for_each_safe(ht, t, bkt, tmp, e)
+		bench_entry_free_batch(a, &fb, e);
+	lkp_free_flush(&fb);
+	lkp_ht_destroy(ht);
+	bench_alloc_reset(a);
+}
+
+static void bench_rbtree_destroy(struct rb_root *root, struct bench_alloc *a)
+{
+	struct lkp_free_batch fb = bench_free_batch(a);
+	struct my_entry *e, *tmp;
+
+	rbtree_postorder_for_each_entry_safe(e, tmp, root, node)
+		bench_entry_free_batch(a, &fb, e);
+	lkp_free_flush(&fb);
+	*root = RB_ROOT;
+	bench_alloc_reset(a);
+}
+
+static void bench_xarray_destroy(struct xarray *xa, struct bench_alloc *a)
+{
+	struct lkp_free_batch fb = bench_free_batch(a);
+	unsigned long index;
+	struct my_entry *e;
+
+	xa_for_each(xa, index, e)
+		bench_entry_free_batch(a, &fb, e);
+	lkp_free_flush(&fb);
+	xa_destroy(xa);
+	bench_alloc_reset(a);
+}
+
+/* Internal xa_nodes below @entry; the tree is at most 11 levels deep */
+static unsigned long bench_xa_count_nodes(void *entry)
+{
+	struct xa_node *node;
+	unsigned long nr = 1;
+	unsigned int i;
+
+	if (!xa_is_node(entry))
+		return 0;
+	node = xa_to_node(entry);
+	if (!node->shift)
+		return 1;
+	for (i = 0; i < XA_CHUNK_SIZE; i++)
+		nr += bench_xa_count_nodes(rcu_dereference_raw(node->slots[i]));
+	return nr;
+}
+
+static unsigned long bench_xa_nodes(struct xarray *xa)
+{
+	return bench_xa_count_nodes(rcu_dereference_raw(xa->xa_head));
+}
+
+/*
+ * Maple nodes: the leaves are counted exactly by watching ma_state move
+ * from node to node during a full walk.  Interior nodes are not visible
+ * through the API; they are estimated as if every one were full, so
+ * the total is a lower bound.
+ */
+static unsigned long bench_mt_nodes(struct maple_tree *mt)
+{
+	MA_STATE(mas, mt, 0, 0);
+	struct maple_enode *last = NULL;
+	unsigned long leaves = 0, nr, level;
+	void *entry;
+
+	rcu_read_lock();
+	mas_for_each(&mas, entry, ULONG_MAX) {
+		if (mas.status == ma_active && mas.node != last) {
+			last = mas.node;
+			leaves++;
+		}
+	}
+	rcu_read_unlock();
+
+	for (nr = level = leaves; level > 1; nr += level)
+		level = DIV_ROUND_UP(level, MAPLE_RANGE64_SLOTS);
+	return nr;
+}
+
+/* lib/btree allocates NODESIZE (lib/btree.c) bytes per node */
+#define BENCH_BT_NODE_SIZE	max(L1_CACHE_BYTES, 128)
+
+/* mempool hooks around lib/btree's own node allocator, counting nodes */
+static void *bench_bt_node_alloc(gfp_t gfp, void *nodes)
+{
+	void *node = btree_alloc(gfp, NULL);
+
+	if (node)
+		atomic_long_inc(nodes);
+	return node;
+}
+
+static void bench_bt_node_free(void *node, void *nodes)
+{
+	atomic_long_dec(nodes);
+	btree_free(node, NULL);
+}
+
+/* btree_init64() with a counting mempool; btree_destroy64() frees it */
+static int bench_btree_init_counted(struct btree_head64 *bt,
+				    atomic_long_t *nodes)
+{
+	mempool_t *pool;
+
+	pool = mempool_create(0, bench_bt_node_alloc, bench_bt_node_free,
+			      nodes);
+	if (!pool)
+		return -ENOMEM;
+	btree_init_mempool64(bt, pool);
+	return 0;
+}
+
+/* Bytes behind one hash bucket array, kmalloc()ed or vmalloc()ed */
+static u64 bench_ht_tbl_bytes(struct lkp_ht_tbl *t, u64 *slack)
+{
+	size_t want = struct_size(t, buckets, 1U << t->bits);
+	size_t got = is_vmalloc_addr(t) ? PAGE_ALIGN(want) : ksize(t);
+
+	*slack += got - want;
+	return got;
+}
+
+/*
+ * Records the footprint of a structure holding r->ents; @nodes and
+ * @node_slack are its internal allocations.
+ */
+static void bench_mem_account(struct bench_run *r, struct bench_result *res,
+			      enum bench_id id, u64 nodes, u64 node_slack)
+{
+	struct bench_mem *mem = &res->mem[id];
+	size_t got;
+
+	switch (r->alloc.mode) {
+	case BENCH_ALLOC_CACHE:
+		got = kmem_cache_size(my_entry_cache);
+		break;
+	case BENCH_ALLOC_POOL:
+		got = sizeof(struct my_entry);   /* packed in the arena */
+		break;
+	default:
+		got = ksize(r->ents[0]);
+		break;
+	}
+	mem->entries = (u64)got * r->n;
+	mem->nodes = nodes;
+	mem->slack = (u64)(got - sizeof(struct my_entry)) * r->n + node_slack;
+}
+
+/* Free what bench_prealloc() handed out once it is unlinked again */
+static void bench_ents_free(struct bench_run *r)
+{
+	struct lkp_free_batch fb = bench_free_batch(&r->alloc);
+
+	/* r->ents already is an array of pointers, so free it in one call */
+	if (r->alloc.mode != BENCH_ALLOC_POOL)
+		kmem_cache_free_bulk(fb.cache, r->n, (void **)r->ents);
+	bench_alloc_reset(&r->alloc);
+}
+
+/*
+ * Lookup phases share one loop per structure: @p holds the keys (and
+ * XArray indices) to probe, hits are counted into r->found so the
+ * compiler cannot drop the searches.  Returns ns/op.
+ */
+static inline struct my_entry *bench_list_find(struct list_head *head, int key)
+{
+	struct my_entry *e;
+
+	list_for_each_entry(e, head, list) {
+		if (e->value == key)
+			return e;
+	}
+	return NULL;
+}
+
+static u64 bench_list_probe(struct bench_run *r, struct list_head *head,
+			    const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!bench_list_find(head, p[i].key);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+static u64 bench_hash_probe(struct bench_run *r, struct lkp_htable *ht,
+			    const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!lkp_ht_find(ht, p[i].key);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+static inline struct my_entry *bench_rbtree_find(struct rb_root *root, int target)
+{
+	struct rb_node *node = root->rb_node;
+
+	while (node) {
+		struct my_entry *e = rb_entry(node, struct my_entry, node);
+
+		if (target < e->value)
+			node = node->rb_left;
+		else if (target > e->value)
+			node = node->rb_right;
+		else
+			return e;   // found
+	}
+	return NULL;
+}
+
+static u64 bench_rbtree_probe(struct bench_run *r, struct rb_root *root,
+			      const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!bench_rbtree_find(root, p[i].key);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+static u64 bench_xarray_probe(struct bench_run *r, struct xarray *xa,
+			      const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!xa_load(xa, p[i].idx);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+/* The holed copy of BENCH_XA_STRIDE; only non-NULL matters to a probe */
+static int bench_xa_fill_holed(struct bench_run *r, struct xarray *xa)
+{
+	void *old;
+	int i;
+
+	for (i = 0; i < r->n; i++) {
+		old = xa_store(xa, (unsigned long)i * BENCH_XA_STRIDE,
+			       xa_mk_value(r->keys[i]), GFP_KERNEL);
+		if (xa_is_err(old))
+			return xa_err(old);
+	}
+	return 0;
+}
+
+/*
+ * Range scans: for each of range_q query starts lo (present keys, in
+ * lookup order) count the keys in [lo, lo + width), for every width in
+ * ranges=, plus a "next key >= lo" successor query. The ordered
+ * structures descend once and then walk; the list and hash table have
+ * no order and scan everything, as the baseline.
+ */
+typedef unsigned long (*bench_scan_fn)(void *ds, int lo, int hi, bool first);
+
+static unsigned long bench_list_scan(void *ds, int lo, int hi, bool first)
+{
+	struct list_head *head = ds;
+	unsigned long cnt = 0;
+	struct my_entry *e;
+	int best = INT_MAX;
+
+	list_for_each_entry(e, head, list) {
+		if (e->value < lo || e->value >= hi)
+			continue;
+		cnt++;
+		best = min(best, e->value);
+	}
+	/* next >= lo has to look at every entry to know it is the least */
+	return first ? best != INT_MAX : cnt;
+}
+
+static unsigned long bench_hash_scan(void *ds, int lo, int hi, bool first)
+{
+	struct lkp_htable *ht = ds;
+	unsigned long cnt = 0;
+	struct lkp_ht_tbl *t;
+	struct my_entry *e;
+	unsigned int bkt;
+	int best = INT_MAX;
+
+	lkp_ht_for_each(ht, t, bkt, e) {
+		if (e->value < lo || e->value >= hi)
+			continue;
+		cnt++;
+		best = min(best, e->value);
+	}
+	return first ? best != INT_MAX : cnt;
+}
+
+static unsigned long bench_rbtree_scan(void *ds, int lo, int hi, bool first)
+{
+	struct rb_root *root = ds;
+	struct rb_node *node = root->rb_node, *found = NULL;
+	unsigned long cnt = 0;
+
+	/* lower bound: leftmost entry >= lo */
+	while (node) {
+		if (rb_entry(node, struct my_entry, node)->value >= lo) {
+			found = node;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	if (first)
+		return !!found;
+	for (; found; found = rb_next(found)) {
+		if (rb_entry(found, struct my_entry, node)->value >= hi)
+			break;
+		cnt++;
+	}
+	return cnt;
+}
+
+static unsigned long bench_xaval_scan(void *ds, int lo, int hi, bool first)
+{
+	struct xarray *xa = ds;
+	unsigned long index = (u32)lo, cnt = 0;
+	struct my_entry *head, *e;
+
+	if (first)
+		return !!xa_find(xa, &index, ULONG_MAX, XA_PRESENT);
+	xa_for_each_range(xa, index, head, (u32)lo, (u32)hi - 1) {
+		cnt++;
+		list_for_each_entry(e, &head->list, list)
+			cnt++;
+	}
+	return cnt;
+}
+
+static unsigned long bench_maple_scan(void *ds, int lo, int hi, bool first)
+{
+	MA_STATE(mas, ds, lkp_key(lo, 0), lkp_key(lo, 0));
+	unsigned long cnt = 0;
+	struct my_entry *e;
+
+	/* one walk down, then mas_find() steps along the leaves */
+	rcu_read_lock();
+	if (first) {
+		cnt = !!mas_find(&mas, ULONG_MAX);
+	} else {
+		mas_for_each(&mas, e, lkp_key(hi - 1, U32_MAX))
+			cnt++;
+	}
+	rcu_read_unlock();
+	return cnt;
+}
+
+static unsigned long bench_btree_scan(void *ds, int lo, int hi, bool first)
+{
+	u64 key = lkp_key(lo, 0);
+	unsigned long cnt = 0;
+	struct my_entry *e;
+
+	/* lib/btree has no cursor, every step is another descent */
+	while ((e = lkp_bt_ceil(ds, &key)) && e->value < hi) {
+		cnt++;
+		if (first)
+			break;
+		key++;
+	}
+	return cnt;
+}
+
+static void bench_range_run(struct bench_run *r, struct bench_result *res,
+			    enum bench_id id, void *ds, bench_scan_fn scan)
+{
+	const struct bench_cfg *cfg = &res->cfg;
+	unsigned long elems;
+	u64 start;
+	int q, w, lo, hi;
+
+	/* column 0 is next >= lo, then one per width */
+	for (w = 0; cfg->nr_ranges && w <= cfg->nr_ranges; w++) {
+		elems = 0;
+		start = ktime_get_ns();
+		for (q = 0; q < cfg->range_q; q++) {
+			lo = r->hit[q % r->n].key;
+			hi = w ? min_t(s64, (s64)lo + cfg->ranges[w - 1], INT_MAX) :
+				 INT_MAX;
+			elems += scan(ds, lo, hi, !w);
+		}
+		res->range_ns[id][w] += ktime_get_ns() - start;
+		res->range_elems[id][w] += elems;
+	}
+}
+
+/*
+ * Order statistics: os_q select queries for k = del_order[q] and rank
+ * queries for present keys in lookup order, plus a minimum. On the
+ * plain tree select and rank walk rb_next() from the first node, so
+ * they cost O(k); the augmented tree descends once using the subtree
+ * sizes.
+ */
+static void bench_os_walk(struct bench_run *r, struct bench_result *res,
+			  struct rb_root *root)
+{
+	const struct bench_cfg *cfg = &res->cfg;
+	struct rb_node *node;
+	u64 start, sink = 0;
+	u32 k;
+	int q;
+
+	start = ktime_get_ns();
+	for (q = 0; q < cfg->os_q; q++) {
+		node = rb_first(root);
+		for (k = r->del_order[q % r->n]; node && k; k--)
+			node = rb_next(node);
+		sink += rb_entry(node, struct my_entry, node)->value;
+	}
+	res->os_ns[BENCH_OS_SELECT][0] += ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (q = 0; q < cfg->os_q; q++) {
+		k = 0;
+		for (node = rb_first(root); node; node = rb_next(node)) {
+			if (rb_entry(node, struct my_entry, node)->value >=
+			    (int)r->hit[q % r->n].key)
+				break;
+			k++;
+		}
+		sink += k;
+	}
+	res->os_ns[BENCH_OS_RANK][0] += ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (q = 0; q < cfg->os_q; q++)
+		sink += rb_entry(rb_first(root), struct my_entry, node)->value;
+	res->os_ns[BENCH_OS_MIN][0] += ktime_get_ns() - start;
+	r->found += sink;
+}
+
+/* Same queries on the augmented tree, built from r->ents */
+static void bench_os_augmented(struct bench_run *r, struct bench_result *res)
+{
+	const struct bench_cfg *cfg = &res->cfg;
+	struct rb_root_cached root = RB_ROOT_CACHED;
+	u64 start, sink = 0;
+	int i, q;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n; i++)
+		insert_rbtree_os(&root, r->ents[i]);
+	res->os_insert_ns += (ktime_get_ns() - start) / r->n;
+
+	start = ktime_get_ns();
+	for (q = 0; q < cfg->os_q; q++)
+		sink += select_rbtree_os(&root, r->del_order[q % r->n])->value;
+	res->os_ns[BENCH_OS_SELECT][1] += ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (q = 0; q < cfg->os_q; q++)
+		sink += rank_rbtree_os(&root, r->hit[q % r->n].key);
+	res->os_ns[BENCH_OS_RANK][1] += ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (q = 0; q < cfg->os_q; q++)
+		sink += rb_entry(rb_first_cached(&root), struct my_entry,
+				 node)->value;
+	res->os_ns[BENCH_OS_MIN][1] += ktime_get_ns() - start;
+	r->found += sink;
+
+	for (i = 0; i < r->n; i++)
+		erase_rbtree_os(&root, r->ents[i]);
+}
+
+/*
+ * Bulk load as bulk_store() does it: sort a copy of the entry pointers
+ * and build the augmented tree bottom-up.  Both are timed, separately;
+ * bulk_ns is their sum.
+ */
+static int bench_rbtree_bulk(struct bench_run *r, struct bench_result *res)
+{
+	struct rb_root_cached root = RB_ROOT_CACHED;
+	struct my_entry **sorted;
+	u64 start, mid, end;
+	int i;
+
+	sorted = kvmalloc_array(r->n, sizeof(*sorted), GFP_KERNEL);
+	if (!sorted)
+		return -ENOMEM;
+	for (i = 0; i < r->n; i++) {
+		r->ents[i]->index = i;
+		sorted[i] = r->ents[i];
+	}
+
+	start = ktime_get_ns();
+	sort(sorted, r->n, sizeof(*sorted), lkp_entry_cmp, NULL);
+	mid = ktime_get_ns();
+	lkp_rb_build(&root, sorted, r->n);
+	end = ktime_get_ns();
+	res->bulk_sort_ns += (mid - start) / r->n;
+	res->bulk_build_ns += (end - mid) / r->n;
+	res->bulk_ns[BENCH_RBTREE] += (end - start) / r->n;
+	kvfree(sorted);
+	return 0;
+}
+
+/*
+ * Each structure is built twice: once allocating every entry inside
+ * the timed loop like store_value() does (insert_ns), and once from
+ * r->ents so only the link-in is timed (insert_only_ns).  The second
+ * build then runs the hit, miss and mixed lookup phases and is taken
+ * apart again by deleting every key in r->del_order.
+ */
+static int bench_list(struct bench_run *r, struct bench_result *res)
+{
+	LIST_HEAD(bench_list);
+	struct bench_hist *h = res->hist[BENCH_LIST];
+	struct my_entry *e;
+	u64 start, t0;
+	int i, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		e = bench_entry_alloc(&r->alloc);
+		if (!e) {
+			err = -ENOMEM;
+			goto out;
+		}
+		e->value = r->keys[i];
+		list_add_tail(&e->list, &bench_list);
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_LIST] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_list_destroy(&bench_list, &r->alloc);
+	res->teardown_ns[BENCH_LIST] += (ktime_get_ns() - start) / r->n;
+
+	err = bench_prealloc(r, res);
+	if (err)
+		return err;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n; i++)
+		list_add_tail(&r->ents[i]->list, &bench_list);
+	res->insert_only_ns[BENCH_LIST] += (ktime_get_ns() - start) / r->n;
+	bench_mem_account(r, res, BENCH_LIST, 0, 0);
+
+	res->lookup_ns[BENCH_LIST] +=
+		bench_list_probe(r, &bench_list, r->hit, BENCH_OP_LOOKUP);
+	res->miss_ns[BENCH_LIST] +=
+		bench_list_probe(r, &bench_list, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_LIST] +=
+		bench_list_probe(r, &bench_list, r->mixed, BENCH_OP_MIXED);
+	bench_range_run(r, res, BENCH_LIST, &bench_list, bench_list_scan);
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		e = bench_list_find(&bench_list, r->keys[r->del_order[i]]);
+		if (e)
+			list_del(&e->list);
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_LIST] += bench_phase_end(r, BENCH_OP_DELETE, start);
+	bench_ents_free(r);
+	return 0;
+
+out:
+	bench_list_destroy(&bench_list, &r->alloc);
+	return err;
+}
+
+static int bench_hash(struct bench_run *r, struct bench_result *res)
+{
+	struct lkp_htable bench_htable;
+	struct bench_hist *h = res->hist[BENCH_HASH];
+	struct my_entry *he;
+	u64 start, t0, bytes, slack;
+	int i, err;
+
+	err = lkp_ht_init_node(&bench_htable, hash_bits, hash_max_load,
+			       bench_alloc_node(&r->alloc));
+	if (err)
+		return err;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		he = bench_entry_alloc(&r->alloc);
+		if (!he) {
+			err = -ENOMEM;
+			goto out;
+		}
+		he->value = r->keys[i];
+		lkp_ht_add(&bench_htable, he);
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_HASH] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_hash_destroy(&bench_htable, &r->alloc);
+	res->teardown_ns[BENCH_HASH] += (ktime_get_ns() - start) / r->n;
+
+	err = lkp_ht_init_node(&bench_htable, hash_bits, hash_max_load,
+			       bench_alloc_node(&r->alloc));
+	if (err)
+		return err;
+	err = bench_prealloc(r, res);
+	if (err)
+		goto out;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n; i++)
+		lkp_ht_add(&bench_htable, r->ents[i]);
+	res->insert_only_ns[BENCH_HASH] += (ktime_get_ns() - start) / r->n;
+
+	/* Finish any pending migration so the chain stats see one array. */
+	lkp_ht_migrate(&bench_htable, UINT_MAX);
+	res->hash_buckets = 1U << lkp_ht_cur(&bench_htable)->bits;
+	res->hash_load = bench_htable.nr * 100 / res->hash_buckets;
+	res->hash_chain = lkp_ht_longest_chain(&bench_htable);
+	slack = 0;
+	bytes = bench_ht_tbl_bytes(lkp_ht_cur(&bench_htable), &slack);
+	bench_mem_account(r, res, BENCH_HASH, bytes, slack);
+
+	res->lookup_ns[BENCH_HASH] +=
+		bench_hash_probe(r, &bench_htable, r->hit, BENCH_OP_LOOKUP);
+	res->miss_ns[BENCH_HASH] +=
+		bench_hash_probe(r, &bench_htable, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_HASH] +=
+		bench_hash_probe(r, &bench_htable, r->mixed, BENCH_OP_MIXED);
+	bench_range_run(r, res, BENCH_HASH, &bench_htable, bench_hash_scan);
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		he = lkp_ht_find(&bench_htable, r->keys[r->del_order[i]]);
+		if (he)
+			lkp_ht_del(&bench_htable, he);
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_HASH] += bench_phase_end(r, BENCH_OP_DELETE, start);
+	lkp_ht_destroy(&bench_htable);
+
+	/* Bulk load: the table is sized for n before the first insert */
+	err = lkp_ht_init_node(&bench_htable, hash_bits, hash_max_load,
+			       bench_alloc_node(&r->alloc));
+	if (!err) {
+		start = ktime_get_ns();
+		lkp_ht_reserve(&bench_htable, r->n);
+		for (i = 0; i < r->n; i++)
+			lkp_ht_add(&bench_htable, r->ents[i]);
+		res->bulk_ns[BENCH_HASH] += (ktime_get_ns() - start) / r->n;
+		lkp_ht_destroy(&bench_htable);
+	}
+	bench_ents_free(r);
+	return err;
+
+out:
+	bench_hash_destroy(&bench_htable, &r->alloc);
+	return err;
+}
+
+static int bench_rbtree(struct bench_run *r, struct bench_result *res)
+{
+	struct rb_root bench_tree = RB_ROOT;
+	struct bench_hist *h = res->hist[BENCH_RBTREE];
+	struct my_entry *re;
+	u64 start, t0;
+	int i, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		re = bench_entry_alloc(&r->alloc);
+		if (!re) {
+			err = -ENOMEM;
+			goto out;
+		}
+		re->value = r->keys[i];
+		RB_CLEAR_NODE(&re->node);
+		insert_rbtree(&bench_tree, re);
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_RBTREE] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_rbtree_destroy(&bench_tree, &r->alloc);
+	res->teardown_ns[BENCH_RBTREE] += (ktime_get_ns() - start) / r->n;
+
+	err = bench_prealloc(r, res);
+	if (err)
+		return err;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n; i++) {
+		RB_CLEAR_NODE(&r->ents[i]->node);
+		insert_rbtree(&bench_tree, r->ents[i]);
+	}
+	res->insert_only_ns[BENCH_RBTREE] += (ktime_get_ns() - start) / r->n;
+	bench_mem_account(r, res, BENCH_RBTREE, 0, 0);
+
+	res->lookup_ns[BENCH_RBTREE] +=
+		bench_rbtree_probe(r, &bench_tree, r->hit, BENCH_OP_LOOKUP);
+	res->miss_ns[BENCH_RBTREE] +=
+		bench_rbtree_probe(r, &bench_tree, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_RBTREE] +=
+		bench_rbtree_probe(r, &bench_tree, r->mixed, BENCH_OP_MIXED);
+	bench_range_run(r, res, BENCH_RBTREE, &bench_tree, bench_rbtree_scan);
+	bench_os_walk(r, res, &bench_tree);
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		re = bench_rbtree_find(&bench_tree, r->keys[r->del_order[i]]);
+		if (re)
+			rb_erase(&re->node, &bench_tree);
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_RBTREE] += bench_phase_end(r, BENCH_OP_DELETE, start);
+	bench_os_augmented(r, res);
+	err = bench_rbtree_bulk(r, res);
+	bench_ents_free(r);
+	return err;
+
+out:
+	bench_rbtree_destroy(&bench_tree, &r->alloc);
+	return err;
+}
+
+static int bench_xarray(struct bench_run *r, struct bench_result *res)
+{
+	DEFINE_XARRAY(bench_xarray);
+	DEFINE_XARRAY(bench_holed);
+	unsigned long bench_xa_index = 0;
+	struct bench_hist *h = res->hist[BENCH_XARRAY];
+	struct my_entry *xe;
+	u64 start, t0;
+	int i, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		xe = bench_entry_alloc(&r->alloc);
+		if (!xe) {
+			err = -ENOMEM;
+			goto out;
+		}
+		xe->value = r->keys[i];
+		xa_store(&bench_xarray, bench_xa_index++, xe, GFP_KERNEL);
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_XARRAY] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_xarray_destroy(&bench_xarray, &r->alloc);
+	res->teardown_ns[BENCH_XARRAY] += (ktime_get_ns() - start) / r->n;
+
+	err = bench_prealloc(r, res);
+	if (err)
+		return err;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n; i++)
+		xa_store(&bench_xarray, i, r->ents[i], GFP_KERNEL);
+	res->insert_only_ns[BENCH_XARRAY] += (ktime_get_ns() - start) / r->n;
+	res->xa_nodes[BENCH_XA_MEM_INDEX] = bench_xa_nodes(&bench_xarray);
+	bench_mem_account(r, res, BENCH_XARRAY,
+			  res->xa_nodes[BENCH_XA_MEM_INDEX] *
+			  sizeof(struct xa_node), 0);
+
+	res->lookup_ns[BENCH_XARRAY] +=
+		bench_xarray_probe(r, &bench_xarray, r->hit, BENCH_OP_LOOKUP);
+	err = bench_xa_fill_holed(r, &bench_holed);
+	if (err) {
+		xa_destroy(&bench_holed);
+		xa_destroy(&bench_xarray);
+		bench_ents_free(r);
+		return err;
+	}
+	res->miss_ns[BENCH_XARRAY] +=
+		bench_xarray_probe(r, &bench_holed, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_XARRAY] +=
+		bench_xarray_probe(r, &bench_holed, r->mixed, BENCH_OP_MIXED);
+	xa_destroy(&bench_holed);
+
+	/* Indexed by position, so no search is needed to find the victim */
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		xa_erase(&bench_xarray, r->del_order[i]);
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_XARRAY] += bench_phase_end(r, BENCH_OP_DELETE, start);
+	xa_destroy(&bench_xarray);
+
+	/* Bulk load: one walk over consecutive indices */
+	start = ktime_get_ns();
+	err = lkp_xa_fill(&bench_xarray, 0, r->ents, r->n);
+	res->bulk_ns[BENCH_XARRAY] += (ktime_get_ns() - start) / r->n;
+	xa_destroy(&bench_xarray);
+	bench_ents_free(r);
+	return err;
+
+out:
+	bench_xarray_destroy(&bench_xarray, &r->alloc);
+	return err;
+}
+
+/*
+ * XArray keyed by the value itself, so lookups search like the hash
+ * table and rbtree do instead of indexing by insertion position.  The
+ * first entry with a value owns the slot; duplicates are chained on
+ * its ->list, which no other structure uses within a benchmark build.
+ */
+static int bench_xaval_add(struct xarray *xa, struct my_entry *e)
+{
+	struct my_entry *head;
+	int err;
+
+	INIT_LIST_HEAD(&e->list);
+	err = xa_insert(xa, (u32)e->value, e, GFP_KERNEL);
+	if (err != -EBUSY)
+		return err;
+
+	head = xa_load(xa, (u32)e->value);
+	list_add_tail(&e->list, &head->list);
+	return 0;
+}
+
+/* Unlink one entry holding @key; the slot goes once the chain is empty */
+static void bench_xaval_del(struct xarray *xa, u32 key)
+{
+	struct my_entry *head = xa_load(xa, key);
+
+	if (!head)
+		return;
+	if (list_empty(&head->list))
+		xa_erase(xa, key);
+	else
+		list_del(head->list.next);
+}
+
+static void bench_xaval_destroy(struct xarray *xa, struct bench_alloc *a)
+{
+	struct lkp_free_batch fb = bench_free_batch(a);
+	struct my_entry *head, *e, *tmp;
+	unsigned long index;
+
+	xa_for_each(xa, index, head) {
+		list_for_each_entry_safe(e, tmp, &head->list, list)
+			bench_entry_free_batch(a, &fb, e);
+		bench_entry_free_batch(a, &fb, head);
+	}
+	lkp_free_flush(&fb);
+	xa_destroy(xa);
+	bench_alloc_reset(a);
+}
+
+static u64 bench_xaval_probe(struct bench_run *r, struct xarray *xa,
+			     const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!xa_load(xa, p[i].key);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+static int bench_xaval(struct bench_run *r, struct bench_result *res)
+{
+	DEFINE_XARRAY(bench_xarray);
+	struct bench_hist *h = res->hist[BENCH_XAVAL];
+	struct my_entry *xe;
+	u64 start, t0;
+	int i, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		xe = bench_entry_alloc(&r->alloc);
+		if (!xe) {
+			err = -ENOMEM;
+			goto out;
+		}
+		xe->value = r->keys[i];
+		err = bench_xaval_add(&bench_xarray, xe);
+		if (err) {
+			bench_entry_free(&r->alloc, xe);
+			goto out;
+		}
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_XAVAL] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_xaval_destroy(&bench_xarray, &r->alloc);
+	res->teardown_ns[BENCH_XAVAL] += (ktime_get_ns() - start) / r->n;
+
+	err = bench_prealloc(r, res);
+	if (err)
+		return err;
+
+	start = ktime_get_ns();
+	for (i = 0; i < r->n && !err; i++)
+		err = bench_xaval_add(&bench_xarray, r->ents[i]);
+	res->insert_only_ns[BENCH_XAVAL] += (ktime_get_ns() - start) / r->n;
+	if (err) {
+		/* every entry is in ents[], linked or not */
+		xa_destroy(&bench_xarray);
+		bench_ents_free(r);
+		return err;
+	}
+	res->xa_nodes[BENCH_XA_MEM_VALUE] = bench_xa_nodes(&bench_xarray);
+	bench_mem_account(r, res, BENCH_XAVAL,
+			  res->xa_nodes[BENCH_XA_MEM_VALUE] *
+			  sizeof(struct xa_node), 0);
+
+	res->lookup_ns[BENCH_XAVAL] +=
+		bench_xaval_probe(r, &bench_xarray, r->hit, BENCH_OP_LOOKUP);
+	res->miss_ns[BENCH_XAVAL] +=
+		bench_xaval_probe(r, &bench_xarray, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_XAVAL] +=
+		bench_xaval_probe(r, &bench_xarray, r->mixed, BENCH_OP_MIXED);
+	bench_range_run(r, res, BENCH_XAVAL, &bench_xarray, bench_xaval_scan);
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		bench_xaval_del(&bench_xarray, r->keys[r->del_order[i]]);
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_XAVAL] += bench_phase_end(r, BENCH_OP_DELETE, start);
+	xa_destroy(&bench_xarray);
+	bench_ents_free(r);
+	return 0;
+
+out:
+	bench_xaval_destroy(&bench_xarray, &r->alloc);
+	return err;
+}
+
+/*
+ * Node footprint of n keys spread uniformly below 2^32, the worst case
+ * for a value-keyed XArray.  Value entries need no my_entry.
+ */
+static int bench_xa_sparse(const struct bench_cfg *cfg, struct bench_result *res)
+{
+	DEFINE_XARRAY(sparse);
+	struct rnd_state rnd;
+	void *old;
+	int i, err = 0;
+
+	prandom_seed_state(&rnd, cfg->seed);
+	for (i = 0; i < cfg->n; i++) {
+		old = xa_store(&sparse, prandom_u32_state(&rnd), xa_mk_value(i),
+			       GFP_KERNEL);
+		if (xa_is_err(old)) {
+			err = xa_err(old);
+			break;
+		}
+	}
+	res->xa_nodes[BENCH_XA_MEM_SPARSE] = bench_xa_nodes(&sparse);
+	xa_destroy(&sparse);
+	return err;
+}
+
+/* ===================================================================
+ * Maple tree and B+tree backends
+ * =================================================================== */
+
+/*
+ * Both are keyed by lkp_key(value, position in keys[]), the position
+ * kept in ->index, so duplicates get their own slot and a lookup by
+ * value is a single range search.
+ */
+static void bench_maple_destroy(struct maple_tree *mt, struct bench_alloc *a)
+{
+	struct lkp_free_batch fb = bench_free_batch(a);
+	unsigned long index = 0;
+	struct my_entry *e;
+
+	mt_for_each(mt, e, index, ULONG_MAX)
+		bench_entry_free_batch(a, &fb, e);
+	lkp_free_flush(&fb);
+	mtree_destroy(mt);
+	bench_alloc_reset(a);
+}
+
+struct bench_btree_reap {
+	struct bench_alloc *a;
+	struct lkp_free_batch fb;
+};
+
+static void bench_btree_put(void *elem, unsigned long opaque, u64 key,
+			    size_t index)
+{
+	struct bench_btree_reap *reap = (struct bench_btree_reap *)opaque;
+
+	if (reap)
+		bench_entry_free_batch(reap->a, &reap->fb, elem);
+}
+
+/*
+ * btree_destroy() only frees the root, so the nodes go first; the grim
+ * visitor does that in one pass. A NULL @a leaves the entries alone.
+ */
+static void bench_btree_destroy(struct btree_head64 *bt, struct bench_alloc *a)
+{
+	struct bench_btree_reap reap;
+
+	if (!LKP_HAVE_BTREE)
+		return;
+	if (a) {
+		reap.a = a;
+		reap.fb = bench_free_batch(a);
+	}
+	btree_grim_visitor64(bt, a ? (unsigned long)&reap : 0, bench_btree_put);
+	btree_destroy64(bt);
+	if (a) {
+		lkp_free_flush(&reap.fb);
+		bench_alloc_reset(a);
+	}
+}
+
+static u64 bench_maple_probe(struct bench_run *r, struct maple_tree *mt,
+			     const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!lkp_mt_find(mt, p[i].key);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+static u64 bench_btree_probe(struct bench_run *r, struct btree_head64 *bt,
+			     const struct bench_probe *p, enum bench_op op)
+{
+	u64 start, t0;
+	int i;
+
+	start = bench_lookup_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		r->found += !!lkp_bt_find(bt, p[i].key);
+		bench_op_end(&r->hist[op], t0);
+	}
+	return bench_lookup_end(r, op, start);
+}
+
+static int bench_maple(struct bench_run *r, struct bench_result *res)
+{
+	struct maple_tree bench_mt;
+	struct bench_hist *h = res->hist[BENCH_MAPLE];
+	struct my_entry *me;
+	u64 start, t0;
+	int i, err = 0;
+
+	mt_init(&bench_mt);
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		me = bench_entry_alloc(&r->alloc);
+		if (!me) {
+			err = -ENOMEM;
+			goto out;
+		}
+		me->value = r->keys[i];
+		me->index = i;
+		err = mtree_insert(&bench_mt, lkp_key(me->value, i), me, GFP_KERNEL);
+		if (err) {
+			bench_entry_free(&r->alloc, me);
+			goto out;
+		}
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_MAPLE] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_maple_destroy(&bench_mt, &r->alloc);
+	res->teardown_ns[BENCH_MAPLE] += (ktime_get_ns() - start) / r->n;
+
+	err = bench_prealloc(r, res);
+	if (err)
+		return err;
+
+	mt_init(&bench_mt);
+	start = ktime_get_ns();
+	for (i = 0; i < r->n && !err; i++) {
+		r->ents[i]->index = i;
+		err = mtree_insert(&bench_mt, lkp_key(r->ents[i]->value, i),
+				   r->ents[i], GFP_KERNEL);
+	}
+	res->insert_only_ns[BENCH_MAPLE] += (ktime_get_ns() - start) / r->n;
+	if (err) {
+		/* every entry is in ents[], linked or not */
+		mtree_destroy(&bench_mt);
+		bench_ents_free(r);
+		return err;
+	}
+	bench_mem_account(r, res, BENCH_MAPLE, bench_mt_nodes(&bench_mt) *
+			  sizeof(struct maple_node), 0);
+
+	res->lookup_ns[BENCH_MAPLE] +=
+		bench_maple_probe(r, &bench_mt, r->hit, BENCH_OP_LOOKUP);
+	res->miss_ns[BENCH_MAPLE] +=
+		bench_maple_probe(r, &bench_mt, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_MAPLE] +=
+		bench_maple_probe(r, &bench_mt, r->mixed, BENCH_OP_MIXED);
+	bench_range_run(r, res, BENCH_MAPLE, &bench_mt, bench_maple_scan);
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		me = lkp_mt_find(&bench_mt, r->keys[r->del_order[i]]);
+		if (me)
+			mtree_erase(&bench_mt, lkp_key(me->value, me->index));
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_MAPLE] += bench_phase_end(r, BENCH_OP_DELETE, start);
+	mtree_destroy(&bench_mt);
+	bench_ents_free(r);
+	return 0;
+
+out:
+	bench_maple_destroy(&bench_mt, &r->alloc);
+	return err;
+}
+
+static int bench_btree(struct bench_run *r, struct bench_result *res)
+{
+	struct btree_head64 bench_bt;
+	struct bench_hist *h = res->hist[BENCH_BTREE];
+	atomic_long_t bt_nodes = ATOMIC_LONG_INIT(0);
+	struct my_entry *be;
+	u64 start, t0;
+	int i, err;
+
+	if (!LKP_HAVE_BTREE)
+		return -EOPNOTSUPP;
+
+	/* btree_init64() sets up the node mempool, keep it out of the timing */
+	err = btree_init64(&bench_bt);
+	if (err)
+		return err;
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		be = bench_entry_alloc(&r->alloc);
+		if (!be) {
+			err = -ENOMEM;
+			goto out;
+		}
+		be->value = r->keys[i];
+		be->index = i;
+		err = btree_insert64(&bench_bt, lkp_bt_key(be->value, i), be,
+				     GFP_KERNEL);
+		if (err) {
+			bench_entry_free(&r->alloc, be);
+			goto out;
+		}
+		bench_op_end(&h[BENCH_OP_INSERT], t0);
+	}
+	res->insert_ns[BENCH_BTREE] += bench_phase_end(r, BENCH_OP_INSERT, start);
+	start = ktime_get_ns();
+	bench_btree_destroy(&bench_bt, &r->alloc);
+	res->teardown_ns[BENCH_BTREE] += (ktime_get_ns() - start) / r->n;
+
+	err = bench_prealloc(r, res);
+	if (err)
+		return err;
+
+	err = bench_btree_init_counted(&bench_bt, &bt_nodes);
+	if (err) {
+		bench_ents_free(r);
+		return err;
+	}
+	start = ktime_get_ns();
+	for (i = 0; i < r->n && !err; i++) {
+		r->ents[i]->index = i;
+		err = btree_insert64(&bench_bt, lkp_bt_key(r->ents[i]->value, i),
+				     r->ents[i], GFP_KERNEL);
+	}
+	res->insert_only_ns[BENCH_BTREE] += (ktime_get_ns() - start) / r->n;
+	if (err)
+		goto out_ents;
+	bench_mem_account(r, res, BENCH_BTREE, atomic_long_read(&bt_nodes) *
+			  BENCH_BT_NODE_SIZE, 0);
+
+	res->lookup_ns[BENCH_BTREE] +=
+		bench_btree_probe(r, &bench_bt, r->hit, BENCH_OP_LOOKUP);
+	res->miss_ns[BENCH_BTREE] +=
+		bench_btree_probe(r, &bench_bt, r->miss, BENCH_OP_MISS);
+	res->mixed_ns[BENCH_BTREE] +=
+		bench_btree_probe(r, &bench_bt, r->mixed, BENCH_OP_MIXED);
+	bench_range_run(r, res, BENCH_BTREE, &bench_bt, bench_btree_scan);
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		be = lkp_bt_find(&bench_bt, r->keys[r->del_order[i]]);
+		if (be)
+			btree_remove64(&bench_bt, lkp_bt_key(be->value, be->index));
+		bench_op_end(&h[BENCH_OP_DELETE], t0);
+	}
+	res->delete_ns[BENCH_BTREE] += bench_phase_end(r, BENCH_OP_DELETE, start);
+out_ents:
+	bench_btree_destroy(&bench_bt, NULL);
+	bench_ents_free(r);
+	return err;
+
+out:
+	bench_btree_destroy(&bench_bt, &r->alloc);
+	return err;
+}
+
+/* ===================================================================
+ * Split layout: one compact node type per structure
+ * =================================================================== */
+
+/*
+ * struct my_entry carries the links of all four structures, so walking
+ * any one of them pulls the other three's pointers through the cache.
+ * With split=1 the run repeats insert, lookup and miss on nodes that
+ * hold only the value and their own link.  They come from the alloc=
+ * allocator the shared entries use, with a slab cache per node type for
+ * alloc=cache (no SLAB_HWCACHE_ALIGN, that would pad them back up), and
+ * the loops are timed and sampled the same way.  The XArrays, the maple
+ * tree and the B+tree need no node at all and store value entries
+ * instead.
+ *
+ * The split hash table is a plain bucket array pre-sized to the shape
+ * the resizable table ends at, so its insert skips the incremental
+ * resize; lookups walk identical chains.
+ */
+struct bench_lnode {
+	int value;
+	struct list_head list;
+};
+
+struct bench_hnode {
+	int value;
+	struct hlist_node hnode;
+};
+
+struct bench_rnode {
+	int value;
+	struct rb_node node;
+};
+
+/* Object size as the allocator hands it out */
+static unsigned int bench_obj_bytes(enum bench_alloc_mode mode,
+				    struct kmem_cache *cache, size_t size)
+{
+	switch (mode) {
+	case BENCH_ALLOC_CACHE:
+		return kmem_cache_size(cache);
+	case BENCH_ALLOC_POOL:
+		return size;
+	default:
+		return kmalloc_size_roundup(size);
+	}
+}
+
+static unsigned int bench_entry_bytes(enum bench_alloc_mode mode)
+{
+	return bench_obj_bytes(mode, my_entry_cache, sizeof(struct my_entry));
+}
+
+static int bench_split_list(struct bench_run *r, struct bench_result *res)
+{
+	struct bench_lnode *e, *tmp;
+	LIST_HEAD(head);
+	u64 start, t0;
+	int i, op, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		e = bench_entry_alloc(r->node_alloc);
+		if (!e) {
+			err = -ENOMEM;
+			goto out;
+		}
+		e->value = r->keys[i];
+		list_add_tail(&e->list, &head);
+		bench_op_end(&r->hist[BENCH_OP_INSERT], t0);
+	}
+	res->split_ns[BENCH_LIST][BENCH_OP_INSERT] +=
+		bench_phase_end(r, BENCH_OP_INSERT, start);
+
+	for (op = BENCH_OP_LOOKUP; op <= BENCH_OP_MISS; op++) {
+		const struct bench_probe *p = op == BENCH_OP_LOOKUP ? r->hit : r->miss;
+
+		start = bench_lookup_begin(r);
+		for (i = 0; i < r->n && !r->stop; i++) {
+			t0 = bench_op_begin(r, i);
+			list_for_each_entry(e, &head, list) {
+				if ((u32)e->value == p[i].key) {
+					r->found++;
+					break;
+				}
+			}
+			bench_op_end(&r->hist[op], t0);
+		}
+		res->split_ns[BENCH_LIST][op] += bench_lookup_end(r, op, start);
+	}
+out:
+	list_for_each_entry_safe(e, tmp, &head, list)
+		bench_entry_free(r->node_alloc, e);
+	bench_alloc_reset(r->node_alloc);
+	return err;
+}
+
+static int bench_split_hash(struct bench_run *r, struct bench_result *res)
+{
+	struct hlist_head *buckets;
+	struct hlist_node *tmp;
+	struct bench_hnode *e;
+	unsigned int bits = hash_bits, b;
+	u64 start, t0;
+	int i, op, err = 0;
+
+	while (hash_max_load && ((u64)hash_max_load << bits) < (u64)r->n)
+		bits++;
+	buckets = kvcalloc(1U << bits, sizeof(*buckets), GFP_KERNEL);
+	if (!buckets)
+		return -ENOMEM;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		e = bench_entry_alloc(r->node_alloc);
+		if (!e) {
+			err = -ENOMEM;
+			goto out;
+		}
+		e->value = r->keys[i];
+		hlist_add_head(&e->hnode, &buckets[hash_32(e->value, bits)]);
+		bench_op_end(&r->hist[BENCH_OP_INSERT], t0);
+	}
+	res->split_ns[BENCH_HASH][BENCH_OP_INSERT] +=
+		bench_phase_end(r, BENCH_OP_INSERT, start);
+
+	for (op = BENCH_OP_LOOKUP; op <= BENCH_OP_MISS; op++) {
+		const struct bench_probe *p = op == BENCH_OP_LOOKUP ? r->hit : r->miss;
+
+		start = bench_lookup_begin(r);
+		for (i = 0; i < r->n && !r->stop; i++) {
+			t0 = bench_op_begin(r, i);
+			hlist_for_each_entry(e, &buckets[hash_32(p[i].key, bits)],
+					     hnode) {
+				if ((u32)e->value == p[i].key) {
+					r->found++;
+					break;
+				}
+			}
+			bench_op_end(&r->hist[op], t0);
+		}
+		res->split_ns[BENCH_HASH][op] += bench_lookup_end(r, op, start);
+	}
+out:
+	for (b = 0; b < 1U << bits; b++)
+		hlist_for_each_entry_safe(e, tmp, &buckets[b], hnode)
+			bench_entry_free(r->node_alloc, e);
+	bench_alloc_reset(r->node_alloc);
+	kvfree(buckets);
+	return err;
+}
+
+static int bench_split_rbtree(struct bench_run *r, struct bench_result *res)
+{
+	struct rb_root root = RB_ROOT;
+	struct rb_node **link, *parent, *node;
+	struct bench_rnode *e, *tmp;
+	u64 start, t0;
+	int i, op, key, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		e = bench_entry_alloc(r->node_alloc);
+		if (!e) {
+			err = -ENOMEM;
+			goto out;
+		}
+		e->value = r->keys[i];
+
+		link = &root.rb_node;
+		parent = NULL;
+		while (*link) {
+			parent = *link;
+			if (e->value < rb_entry(parent, struct bench_rnode, node)->value)
+				link = &parent->rb_left;
+			else
+				link = &parent->rb_right;
+		}
+		rb_link_node(&e->node, parent, link);
+		rb_insert_color(&e->node, &root);
+		bench_op_end(&r->hist[BENCH_OP_INSERT], t0);
+	}
+	res->split_ns[BENCH_RBTREE][BENCH_OP_INSERT] +=
+		bench_phase_end(r, BENCH_OP_INSERT, start);
+
+	for (op = BENCH_OP_LOOKUP; op <= BENCH_OP_MISS; op++) {
+		const struct bench_probe *p = op == BENCH_OP_LOOKUP ? r->hit : r->miss;
+
+		start = bench_lookup_begin(r);
+		for (i = 0; i < r->n && !r->stop; i++) {
+			t0 = bench_op_begin(r, i);
+			key = p[i].key;
+			node = root.rb_node;
+			while (node) {
+				e = rb_entry(node, struct bench_rnode, node);
+				if (key < e->value) {
+					node = node->rb_left;
+				} else if (key > e->value) {
+					node = node->rb_right;
+				} else {
+					r->found++;
+					break;
+				}
+			}
+			bench_op_end(&r->hist[op], t0);
+		}
+		res->split_ns[BENCH_RBTREE][op] += bench_lookup_end(r, op, start);
+	}
+out:
+	rbtree_postorder_for_each_entry_safe(e, tmp, &root, node)
+		bench_entry_free(r->node_alloc, e);
+	bench_alloc_reset(r->node_alloc);
+	return err;
+}
+
+/*
+ * Both XArray variants: by index the value itself is the entry, by
+ * value the entry counts duplicates.
+ */
+static int bench_split_xa(struct bench_run *r, struct bench_result *res,
+			  enum bench_id id)
+{
+	DEFINE_XARRAY(xa);
+	DEFINE_XARRAY(holed);
+	struct xarray *probed = &xa;
+	unsigned long idx;
+	void *old;
+	u64 start, t0;
+	int i, op, err = 0;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		if (id == BENCH_XARRAY) {
+			idx = i;
+			old = xa_mk_value(r->keys[i]);
+		} else {
+			idx = r->keys[i];
+			old = xa_load(&xa, idx);
+			old = xa_mk_value(old ? xa_to_value(old) + 1 : 1);
+		}
+		old = xa_store(&xa, idx, old, GFP_KERNEL);
+		if (xa_is_err(old)) {
+			err = xa_err(old);
+			goto out;
+		}
+		bench_op_end(&r->hist[BENCH_OP_INSERT], t0);
+	}
+	res->split_ns[id][BENCH_OP_INSERT] +=
+		bench_phase_end(r, BENCH_OP_INSERT, start);
+
+	for (op = BENCH_OP_LOOKUP; op <= BENCH_OP_MISS; op++) {
+		const struct bench_probe *p = op == BENCH_OP_LOOKUP ? r->hit : r->miss;
+
+		if (op == BENCH_OP_MISS && id == BENCH_XARRAY) {
+			err = bench_xa_fill_holed(r, &holed);
+			if (err)
+				goto out;
+			probed = &holed;
+		}
+		start = bench_lookup_begin(r);
+		for (i = 0; i < r->n && !r->stop; i++) {
+			t0 = bench_op_begin(r, i);
+			r->found += !!xa_load(probed, id == BENCH_XARRAY ?
+					      p[i].idx : p[i].key);
+			bench_op_end(&r->hist[op], t0);
+		}
+		res->split_ns[id][op] += bench_lookup_end(r, op, start);
+	}
+out:
+	xa_destroy(&holed);
+	xa_destroy(&xa);
+	return err;
+}
+
+static int bench_split_xarray(struct bench_run *r, struct bench_result *res)
+{
+	return bench_split_xa(r, res, BENCH_XARRAY);
+}
+
+static int bench_split_xaval(struct bench_run *r, struct bench_result *res)
+{
+	return bench_split_xa(r, res, BENCH_XAVAL);
+}
+
+/*
+ * The maple tree and B+tree key already holds the value, so the stored
+ * entry only has to be non-NULL: a value entry, no node either.
+ */
+static int bench_split_maple(struct bench_run *r, struct bench_result *res)
+{
+	struct maple_tree mt;
+	unsigned long index;
+	u64 start, t0;
+	int i, op, err = 0;
+
+	mt_init(&mt);
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		err = mtree_insert(&mt, lkp_key(r->keys[i], i), xa_mk_value(0),
+				   GFP_KERNEL);
+		if (err)
+			goto out;
+		bench_op_end(&r->hist[BENCH_OP_INSERT], t0);
+	}
+	res->split_ns[BENCH_MAPLE][BENCH_OP_INSERT] +=
+		bench_phase_end(r, BENCH_OP_INSERT, start);
+
+	for (op = BENCH_OP_LOOKUP; op <= BENCH_OP_MISS; op++) {
+		const struct bench_probe *p = op == BENCH_OP_LOOKUP ? r->hit : r->miss;
+
+		start = bench_lookup_begin(r);
+		for (i = 0; i < r->n && !r->stop; i++) {
+			t0 = bench_op_begin(r, i);
+			index = lkp_key(p[i].key, 0);
+			r->found += !!mt_find(&mt, &index,
+					      lkp_key(p[i].key, U32_MAX));
+			bench_op_end(&r->hist[op], t0);
+		}
+		res->split_ns[BENCH_MAPLE][op] += bench_lookup_end(r, op, start);
+	}
+out:
+	mtree_destroy(&mt);
+	return err;
+}
+
+static int bench_split_btree(struct bench_run *r, struct bench_result *res)
+{
+	struct btree_head64 bt;
+	u64 start, t0, key;
+	int i, op, err;
+
+	if (!LKP_HAVE_BTREE)
+		return -EOPNOTSUPP;
+	err = btree_init64(&bt);
+	if (err)
+		return err;
+
+	start = bench_phase_begin(r);
+	for (i = 0; i < r->n && !r->stop; i++) {
+		t0 = bench_op_begin(r, i);
+		err = btree_insert64(&bt, lkp_bt_key(r->keys[i], i),
+				     xa_mk_value(0), GFP_KERNEL);
+		if (err)
+			goto out;
+		bench_op_end(&r->hist[BENCH_OP_INSERT], t0);
+	}
+	res->split_ns[BENCH_BTREE][BENCH_OP_INSERT] +=
+		bench_phase_end(r, BENCH_OP_INSERT, start);
+
+	for (op = BENCH_OP_LOOKUP; op <= BENCH_OP_MISS; op++) {
+		const struct bench_probe *p = op == BENCH_OP_LOOKUP ? r->hit : r->miss;
+
+		start = bench_lookup_begin(r);
+		for (i = 0; i < r->n && !r->stop; i++) {
+			t0 = bench_op_begin(r, i);
+			key = lkp_key(p[i].key, 0);
+			r->found += lkp_bt_ceil(&bt, &key) &&
+				    key >> 32 == lkp_key(p[i].key, 0) >> 32;
+			bench_op_end(&r->hist[op], t0);
+		}
+		res->split_ns[BENCH_BTREE][op] += bench_lookup_end(r, op, start);
+	}
+out:
+	bench_btree_destroy(&bt, NULL);
+	return err;
+}
+
+static const struct bench_struct {
+	const char *name;                /* token for structs= */
+	const char *label;               /* row label in /proc/lkp_ds_bench */
+	int (*run)(struct bench_run *r, struct bench_result *res);
+	int (*split)(struct bench_run *r, struct bench_result *res);
+} bench_structs[BENCH_NR] = {
+	[BENCH_LIST]   = { "list",   "Linked list:",    bench_list,
+			   bench_split_list },
+	[BENCH_HASH]   = { "hash",   "Hash table:",     bench_hash,
+			   bench_split_hash },
+	[BENCH_RBTREE] = { "rbtree", "Red-black tree:", bench_rbtree,
+			   bench_split_rbtree },
+	[BENCH_XARRAY] = { "xarray", "XArray:",         bench_xarray,
+			   bench_split_xarray },
+	[BENCH_XAVAL]  = { "xaval",  "XArray (value):", bench_xaval,
+			   bench_split_xaval },
+	[BENCH_MAPLE]  = { "maple",  "Maple tree:",     bench_maple,
+			   bench_split_maple },
+	[BENCH_BTREE]  = { "btree",  "B+ tree:",        bench_btree,
+			   bench_split_btree },
+};
+
+/* Repeat the selected structures with the compact node types */
+static int bench_split_run(struct bench_run *r, struct bench_result *res)
+{
+	static const size_t size[BENCH_NR] = {
+		[BENCH_LIST]   = sizeof(struct bench_lnode),
+		[BENCH_HASH]   = sizeof(struct bench_hnode),
+		[BENCH_RBTREE] = sizeof(struct bench_rnode),
+	};
+	const struct bench_cfg *cfg = &res->cfg;
+	struct kmem_cache *cache[BENCH_NR] = {};
+	struct bench_alloc alloc[BENCH_NR] = {};
+	int t, id, err = 0;
+
+	if (cfg->alloc == BENCH_ALLOC_CACHE) {
+		cache[BENCH_LIST] = KMEM_CACHE(bench_lnode, 0);
+		cache[BENCH_HASH] = KMEM_CACHE(bench_hnode, 0);
+		cache[BENCH_RBTREE] = KMEM_CACHE(bench_rnode, 0);
+		if (!cache[BENCH_LIST] || !cache[BENCH_HASH] ||
+		    !cache[BENCH_RBTREE]) {
+			err = -ENOMEM;
+			goto out;
+		}
+	}
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!size[id] || !(cfg->structs & BIT(id)))
+			continue;
+		err = bench_alloc_init(&alloc[id], cfg->alloc, cache[id],
+				       size[id], r->n, cfg->alloc_node);
+		if (err)
+			goto out;
+		res->split_bytes[id] = bench_obj_bytes(cfg->alloc, cache[id],
+						       size[id]);
+	}
+
+	for (t = 0; t < cfg->trials; t++) {
+		for (id = 0; id < BENCH_NR; id++) {
+			if (!(cfg->structs & BIT(id)))
+				continue;
+			r->node_alloc = &alloc[id];
+			r->hist = res->split_hist[id];
+			r->pmu_acc = res->split_pmu[id];
+			err = bench_structs[id].split(r, res);
+			if (!err)
+				err = bench_tick();
+			if (err)
+				goto out;
+		}
+	}
+	for (id = 0; id < BENCH_NR; id++)
+		for (t = 0; t < BENCH_OP_NR; t++)
+			res->split_ns[id][t] /= cfg->trials;
+out:
+	/* kmem_cache_destroy() ignores NULL, bench_alloc_release() a zeroed alloc */
+	for (id = 0; id < BENCH_NR; id++) {
+		bench_alloc_release(&alloc[id]);
+		kmem_cache_destroy(cache[id]);
+	}
+	return err;
+}
+
+/* ===================================================================
+ * Concurrent benchmark: one pinned kthread per CPU
+ * =================================================================== */
+
+/*
+ * Every thread runs a mix of inserts and lookups against one shared
+ * instance of the structure under test.  Thread counts double from 1 up
+ * to cfg->threads so the table shows where each structure stops
+ * scaling.  Two synchronization schemes are compared:
+ *
+ *   rwlock: list, hash table and rbtree are guarded by an rwlock
+ *           (lookups share it, inserts take it exclusively).
+ *   rcu:    lookups only take rcu_read_lock(); inserts serialize on a
+ *           spinlock and publish with the _rcu primitives.  rbtree
+ *           lookups are validated against tree_seq.
+ *
+ * The XArray relies on its internal xa_lock for stores in both modes.
+ */
+struct bench_mt_ctx {
+	enum bench_id id;
+	bool rcu;                        /* BENCH_SYNC_RCU */
+	const u32 *keys;                 /* prefilled keys, lookup targets */
+	int n;
+	int ops;                         /* operations per thread */
+	int write_pct;
+
+	struct completion start;
+	struct completion done;
+	atomic_t running;
+
+	rwlock_t lock;                   /* rwlock mode */
+	spinlock_t wlock;                /* rcu mode, writers only */
+	seqcount_spinlock_t tree_seq;    /* rcu mode, rbtree rotations */
+	struct list_head list;
+	struct lkp_htable ht;
+	struct rb_root tree;
+	struct xarray xa;
+	atomic_long_t xa_next;           /* next free XArray index */
+	struct maple_tree mt;
+	struct btree_head64 bt;          /* rwlock mode only */
+	u64 seed;                        /* per-thread op streams derive from it */
+};
+
+struct bench_mt_thread {
+	struct bench_mt_ctx *ctx;
+	struct task_struct *task;
+	int idx;
+	u64 elapsed_ns;
+	int err;
+};
+
+static inline void bench_mt_write_lock(struct bench_mt_ctx *ctx)
+{
+	if (ctx->rcu)
+		spin_lock(&ctx->wlock);
+	else
+		write_lock(&ctx->lock);
+}
+
+static inline void bench_mt_write_unlock(struct bench_mt_ctx *ctx)
+{
+	if (ctx->rcu)
+		spin_unlock(&ctx->wlock);
+	else
+		write_unlock(&ctx->lock);
+}
+
+static inline void bench_mt_read_lock(struct bench_mt_ctx *ctx)
+{
+	if (ctx->rcu)
+		rcu_read_lock();
+	else
+		read_lock(&ctx->lock);
+}
+
+static inline void bench_mt_read_unlock(struct bench_mt_ctx *ctx)
+{
+	if (ctx->rcu)
+		rcu_read_unlock();
+	else
+		read_unlock(&ctx->lock);
+}
+
+/* Inserts use the _rcu primitives in both modes so the writers match. */
+static int bench_mt_insert(struct bench_mt_ctx *ctx, int val)
+{
+	struct my_entry *e;
+	void *old;
+	int err;
+
+	/* Allocate outside the lock; only the link-in is serialized. */
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return -ENOMEM;
+	e->value = val;
+
+	switch (ctx->id) {
+	case BENCH_LIST:
+		bench_mt_write_lock(ctx);
+		list_add_tail_rcu(&e->list, &ctx->list);
+		bench_mt_write_unlock(ctx);
+		break;
+	case BENCH_HASH:
+		bench_mt_write_lock(ctx);
+		lkp_ht_add(&ctx->ht, e);
+		bench_mt_write_unlock(ctx);
+		break;
+	case BENCH_RBTREE:
+		RB_CLEAR_NODE(&e->node);
+		bench_mt_write_lock(ctx);
+		if (ctx->rcu) {
+			write_seqcount_begin(&ctx->tree_seq);
+			insert_rbtree_rcu(&ctx->tree, e);
+			write_seqcount_end(&ctx->tree_seq);
+		} else {
+			insert_rbtree(&ctx->tree, e);
+		}
+		bench_mt_write_unlock(ctx);
+		break;
+	case BENCH_XARRAY:
+		old = xa_store(&ctx->xa, atomic_long_inc_return(&ctx->xa_next) - 1,
+			       e, GFP_KERNEL);
+		if (xa_is_err(old)) {
+			kfree(e);
+			return xa_err(old);
+		}
+		break;
+	case BENCH_XAVAL:
+		/*
+		 * Writers serialize on the XArray lock.  __xa_insert() may
+		 * drop it to allocate, so a racing insert of the same value
+		 * shows up as -EBUSY and we chain onto the winner instead.
+		 */
+		INIT_LIST_HEAD(&e->list);
+		xa_lock(&ctx->xa);
+		for (;;) {
+			struct my_entry *head = xa_load(&ctx->xa, (u32)val);
+
+			if (head) {
+				list_add_tail_rcu(&e->list, &head->list);
+				err = 0;
+				break;
+			}
+			err = __xa_insert(&ctx->xa, (u32)val, e, GFP_KERNEL);
+			if (err != -EBUSY)
+				break;
+		}
+		xa_unlock(&ctx->xa);
+		if (err)
+			kfree(e);
+		return err;
+	case BENCH_MAPLE:
+		/* Like the XArray, the maple tree brings its own write lock */
+		e->index = atomic_long_inc_return(&ctx->xa_next) - 1;
+		err = mtree_insert(&ctx->mt, lkp_key(val, e->index), e, GFP_KERNEL);
+		if (err)
+			kfree(e);
+		return err;
+	case BENCH_BTREE:
+		if (!LKP_HAVE_BTREE) {
+			kfree(e);
+			return -EOPNOTSUPP;
+		}
+		/* No sleeping allocation under the rwlock */
+		e->index = atomic_long_inc_return(&ctx->xa_next) - 1;
+		bench_mt_write_lock(ctx);
+		err = btree_insert64(&ctx->bt, lkp_bt_key(val, e->index), e,
+				     GFP_ATOMIC);
+		bench_mt_write_unlock(ctx);
+		if (err)
+			kfree(e);
+		return err;
+	default:
+		kfree(e);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static void bench_mt_lookup(struct bench_mt_ctx *ctx, int target)
+{
+	struct my_entry *e = NULL;
+	struct rb_node *node;
+	unsigned int seq;
+
+	switch (ctx->id) {
+	case BENCH_LIST:
+		bench_mt_read_lock(ctx);
+		list_for_each_entry_rcu(e, &ctx->list, list, !ctx->rcu) {
+			if (e->value == target)
+				break;
+		}
+		bench_mt_read_unlock(ctx);
+		break;
+	case BENCH_HASH:
+		bench_mt_read_lock(ctx);
+		lkp_ht_find(&ctx->ht, target);
+		bench_mt_read_unlock(ctx);
+		break;
+	case BENCH_RBTREE:
+		if (ctx->rcu) {
+			rcu_read_lock();
+			do {
+				seq = read_seqcount_begin(&ctx->tree_seq);
+				e = lookup_rbtree_rcu(&ctx->tree, target);
+			} while (!e && read_seqcount_retry(&ctx->tree_seq, seq));
+			rcu_read_unlock();
+			break;
+		}
+		read_lock(&ctx->lock);
+		node = ctx->tree.rb_node;
+		while (node) {
+			e = rb_entry(node, struct my_entry, node);
+			if (target < e->value)
+				node = node->rb_left;
+			else if (target > e->value)
+				node = node->rb_right;
+			else
+				break;
+		}
+		read_unlock(&ctx->lock);
+		break;
+	case BENCH_XARRAY:
+		/* Positional like the single-threaded XArray lookup */
+		if (ctx->rcu)
+			rcu_read_lock();
+		e = xa_load(&ctx->xa, (unsigned int)target % ctx->n);
+		if (e)
+			(void)READ_ONCE(e->value);
+		if (ctx->rcu)
+			rcu_read_unlock();
+		break;
+	case BENCH_XAVAL:
+		/* Only the slot owner is read, chains are never walked */
+		if (ctx->rcu)
+			rcu_read_lock();
+		e = xa_load(&ctx->xa, (u32)target);
+		if (e)
+			(void)READ_ONCE(e->value);
+		if (ctx->rcu)
+			rcu_read_unlock();
+		break;
+	case BENCH_MAPLE:
+		/* mt_find() is an RCU reader in both modes */
+		e = lkp_mt_find(&ctx->mt, target);
+		if (e)
+			(void)READ_ONCE(e->value);
+		break;
+	case BENCH_BTREE:
+		read_lock(&ctx->lock);
+		lkp_bt_find(&ctx->bt, target);
+		read_unlock(&ctx->lock);
+		break;
+	default:
+		break;
+	}
+}
+
+static int bench_mt_thread(void *data)
+{
+	struct bench_mt_thread *th = data;
+	struct bench_mt_ctx *ctx = th->ctx;
+	struct rnd_state rnd;
+	u64 start;
+	int i;
+
+	prandom_seed_state(&rnd, ctx->seed + th->idx);
+	wait_for_completion(&ctx->start);
+
+	start = ktime_get_ns();
+	for (i = 0; i < ctx->ops && !th->err; i++) {
+		if (prandom_u32_state(&rnd) % 100 < (u32)ctx->write_pct)
+			th->err = bench_mt_insert(ctx,
+					prandom_u32_state(&rnd) % 1000000);
+		else
+			bench_mt_lookup(ctx,
+					ctx->keys[prandom_u32_state(&rnd) % ctx->n]);
+		if (!(i & BENCH_RESCHED_MASK)) {
+			cond_resched();
+			if (READ_ONCE(bench_stop))
+				th->err = -ECANCELED;
+		}
+	}
+	th->elapsed_ns = ktime_get_ns() - start;
+
+	if (atomic_dec_and_test(&ctx->running))
+		complete(&ctx->done);
+
+	/* Stay around until bench_mt_level() reaps us with kthread_stop() */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+/* Free every entry of the shared structure and reset it. */
+static void bench_mt_teardown(struct bench_mt_ctx *ctx)
+{
+	/* bench_mt_insert() always uses kmalloc */
+	struct bench_alloc a = { .mode = BENCH_ALLOC_KMALLOC };
+
+	switch (ctx->id) {
+	case BENCH_LIST:
+		bench_list_destroy(&ctx->list, &a);
+		break;
+	case BENCH_HASH:
+		bench_hash_destroy(&ctx->ht, &a);
+		break;
+	case BENCH_RBTREE:
+		bench_rbtree_destroy(&ctx->tree, &a);
+		break;
+	case BENCH_XARRAY:
+		bench_xarray_destroy(&ctx->xa, &a);
+		break;
+	case BENCH_XAVAL:
+		bench_xaval_destroy(&ctx->xa, &a);
+		break;
+	case BENCH_MAPLE:
+		bench_maple_destroy(&ctx->mt, &a);
+		break;
+	case BENCH_BTREE:
+		bench_btree_destroy(&ctx->bt, &a);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Builds a fresh shared instance holding ctx->n keys.  The hash table is
+ * sized up front for everything this level will insert and does not
+ * resize, so no bucket array is allocated or freed under the rwlock.
+ */
+static int bench_mt_setup(struct bench_mt_ctx *ctx, int nthreads)
+{
+	unsigned long total;
+	int i, bits, err = 0;
+
+	rwlock_init(&ctx->lock);
+	spin_lock_init(&ctx->wlock);
+	seqcount_spinlock_init(&ctx->tree_seq, &ctx->wlock);
+	INIT_LIST_HEAD(&ctx->list);
+	ctx->tree = RB_ROOT;
+	xa_init(&ctx->xa);
+	atomic_long_set(&ctx->xa_next, 0);
+	mt_init_flags(&ctx->mt, MT_FLAGS_USE_RCU);
+	if (LKP_HAVE_BTREE && ctx->id == BENCH_BTREE) {
+		err = btree_init64(&ctx->bt);
+		if (err)
+			return err;
+	}
+
+	if (ctx->id == BENCH_HASH) {
+		total = ctx->n + (unsigned long)nthreads * ctx->ops *
+			ctx->write_pct / 100;
+		bits = clamp_t(int, order_base_2(total), hash_bits,
+			       LKP_HT_MAX_BITS);
+		err = lkp_ht_init(&ctx->ht, bits, 0);
+		if (err)
+			return err;
+	}
+
+	for (i = 0; i < ctx->n && !err; i++)
+		err = bench_mt_insert(ctx, ctx->keys[i]);
+	if (err)
+		bench_mt_teardown(ctx);
+	return err;
+}
+
+static int bench_mt_level(struct bench_mt_ctx *ctx, int nthreads,
+			  struct bench_mt_cell *cell)
+{
+	struct bench_mt_thread *th;
+	u64 start, wall, ns, sum = 0, worst = 0;
+	unsigned int cpu;
+	int i, err;
+
+	th = kcalloc(nthreads, sizeof(*th), GFP_KERNEL);
+	if (!th)
+		return -ENOMEM;
+
+	err = bench_mt_setup(ctx, nthreads);
+	if (err)
+		goto out_free;
+
+	init_completion(&ctx->start);
+	init_completion(&ctx->done);
+	atomic_set(&ctx->running, nthreads);
+
+	/* Create every thread before waking any, so failure is easy to undo. */
+	cpu = cpumask_first(cpu_online_mask);
+	for (i = 0; i < nthreads; i++) {
+		th[i].ctx = ctx;
+		th[i].idx = i;
+		th[i].task = kthread_create(bench_mt_thread, &th[i],
+					    "lkp_bench/%u", cpu);
+		if (IS_ERR(th[i].task)) {
+			err = PTR_ERR(th[i].task);
+			th[i].task = NULL;
+			goto out_stop;
+		}
+		kthread_bind(th[i].task, cpu);
+		cpu = cpumask_next(cpu, cpu_online_mask);
+	}
+	for (i = 0; i < nthreads; i++)
+		wake_up_process(th[i].task);
+
+	start = ktime_get_ns();
+	complete_all(&ctx->start);
+	wait_for_completion(&ctx->done);
+	wall = ktime_get_ns() - start;
+
+	for (i = 0; i < nthreads; i++) {
+		if (th[i].err)
+			err = th[i].err;
+		ns = th[i].elapsed_ns / ctx->ops;
+		sum += ns;
+		if (ns > worst)
+			worst = ns;
+	}
+	cell->threads = nthreads;
+	cell->ops_per_sec = div64_u64((u64)nthreads * ctx->ops * NSEC_PER_SEC,
+				      wall ?: 1);
+	cell->mean_ns = sum / nthreads;
+	cell->max_ns = worst;
+
+out_stop:
+	/* Threads that were never woken exit without running bench_mt_thread */
+	for (i = 0; i < nthreads; i++)
+		if (th[i].task)
+			kthread_stop(th[i].task);
+	bench_mt_teardown(ctx);
+out_free:
+	kfree(th);
+	return err;
+}
+
+static int bench_mt_run(const struct bench_cfg *cfg, const u32 *keys,
+			struct bench_result *res)
+{
+	struct bench_mt_ctx ctx = {
+		.keys      = keys,
+		.n         = cfg->n,
+		.ops       = cfg->ops ?: cfg->n,
+		.write_pct = cfg->write_pct,
+		.seed      = cfg->seed,
+	};
+	int sync, id, level, nthreads, max_threads, err;
+
+	max_threads = min_t(int, cfg->threads, num_online_cpus());
+
+	for (sync = 0; sync < BENCH_SYNC_NR; sync++) {
+		if (!(cfg->sync & BIT(sync)))
+			continue;
+		ctx.rcu = sync == BENCH_SYNC_RCU;
+
+		for (id = 0; id < BENCH_NR; id++) {
+			if (!(cfg->structs & BIT(id)))
+				continue;
+			/* lib/btree has no lockless readers to compare */
+			if (ctx.rcu && id == BENCH_BTREE)
+				continue;
+			ctx.id = id;
+
+			level = 0;
+			for (nthreads = 1; level < BENCH_MT_LEVELS; nthreads *= 2) {
+				nthreads = min(nthreads, max_threads);
+				err = bench_mt_level(&ctx, nthreads,
+						     &res->mt[sync][id][level++]);
+				if (!err)
+					err = bench_tick();
+				if (err)
+					return err;
+				if (nthreads == max_threads)
+					break;
+			}
+			res->mt_levels = level;
+		}
+	}
+	return 0;
+}
+
+/* ===================================================================
+ * Key generators
+ * =================================================================== */
+
+/*
+ * Everything below draws from one prandom state seeded with cfg->seed,
+ * so the same seed gives the same keys and lookup order on any machine.
+ */
+
+static void bench_shuffle(u32 *a, int n, struct rnd_state *rnd)
+{
+	int i, j;
+
+	for (i = n - 1; i > 0; i--) {
+		j = prandom_u32_state(rnd) % (i + 1);
+		swap(a[i], a[j]);
+	}
+}
+
+static u64 bench_rand_u64(struct rnd_state *rnd)
+{
+	u64 hi = prandom_u32_state(rnd);
+
+	return hi << 32 | prandom_u32_state(rnd);
+}
+
+/* log2(@x) for x >= 1, in 16.16 fixed point */
+static u32 bench_log2_fp16(u32 x)
+{
+	unsigned int ip = ilog2(x);
+	u64 m = (u64)x << (31 - ip);     /* x / 2^ip in [1, 2), 1.31 */
+	u32 frac = 0;
+	int bit;
+
+	/* Squaring the mantissa shifts one more fraction bit into view */
+	for (bit = 15; bit >= 0; bit--) {
+		m = (m * m) >> 31;
+		if (m >= (2ULL << 31)) {
+			m >>= 1;
+			frac |= 1U << bit;
+		}
+	}
+	return ip << 16 | frac;
+}
+
+/* 2^-@e for @e in 16.16 fixed point, result in 0.32 fixed point */
+static u64 bench_exp2_neg_fp16(u64 e)
+{
+	/* 2^-(2^-k) * 2^32 for k = 1..16 */
+	static const u32 half_powers[16] = {
+		3037000500U, 3611622603U, 3938502376U, 4112874773U,
+		4202935003U, 4248701965U, 4271771996U, 4283353945U,
+		4289156690U, 4292061010U, 4293513907U, 4294240540U,
+		4294603903U, 4294785595U, 4294876445U, 4294921870U,
+	};
+	u64 r = 1ULL << 32;
+	int k;
+
+	if ((e >> 16) >= 32)
+		return 0;
+	for (k = 0; k < 16; k++)
+		if (e & (0x8000 >> k))
+			r = (r * half_powers[k]) >> 32;
+	return r >> (e >> 16);
+}
+
+/*
+ * Zipfian lookups: rank k (1-based) is drawn with weight 1/k^theta by
+ * inverting a cumulative table, and ranks are scattered over positions
+ * so the hot keys are not simply the first ones inserted.  No floating
+ * point in the kernel, so the weights are computed as
+ * 2^(-theta * log2(k)) in fixed point.
+ */
+static int bench_gen_zipf(const struct bench_cfg *cfg, u32 *lookup,
+			  const u32 *perm, struct rnd_state *rnd)
+{
+	u64 theta = div_u64((u64)cfg->theta << 16, 100);
+	u64 *cdf, sum = 0, u;
+	int i, lo, hi, n = cfg->n;
+
+	cdf = kvmalloc_array(n, sizeof(*cdf), GFP_KERNEL);
+	if (!cdf)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++) {
+		sum += bench_exp2_neg_fp16((theta * bench_log2_fp16(i + 1)) >> 16) ?: 1;
+		cdf[i] = sum;
+	}
+
+	for (i = 0; i < n; i++) {
+		div64_u64_rem(bench_rand_u64(rnd), sum, &u);
+		/* first rank whose cumulative weight exceeds u */
+		lo = 0;
+		hi = n - 1;
+		while (lo < hi) {
+			int mid = lo + (hi - lo) / 2;
+
+			if (cdf[mid] > u)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		lookup[i] = perm[lo];
+	}
+
+	kvfree(cdf);
+	return 0;
+}
+
+/* hot_ops% of lookups go to a random hot_keys% of the keys */
+static void bench_gen_hotset(const struct bench_cfg *cfg, u32 *lookup,
+			     const u32 *perm, struct rnd_state *rnd)
+{
+	int n = cfg->n;
+	int hot = max(1, (int)div_u64((u64)n * cfg->hot_keys, 100));
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (hot == n || prandom_u32_state(rnd) % 100 < (u32)cfg->hot_ops)
+			lookup[i] = perm[prandom_u32_state(rnd) % hot];
+		else
+			lookup[i] = perm[hot + prandom_u32_state(rnd) % (n - hot)];
+	}
+}
+
+/*
+ * Fill @keys with cfg->n insert keys and @lookup with cfg->n positions
+ * in @keys to look up.  Unless the distribution skews lookups they hit
+ * every key once, in insertion order.
+ */
+static int bench_gen_keys(const struct bench_cfg *cfg, u32 *keys, u32 *lookup,
+			  struct rnd_state *rnd)
+{
+	u32 *perm, base = 0;
+	int i, n = cfg->n, err = 0;
+
+	for (i = 0; i < n; i++) {
+		switch (cfg->key_dist) {
+		case BENCH_KEYS_SEQUENTIAL:
+			keys[i] = i;
+			break;
+		case BENCH_KEYS_REVERSE:
+			keys[i] = n - 1 - i;
+			break;
+		case BENCH_KEYS_CLUSTERED:
+			if (i % cfg->cluster == 0)
+				base = prandom_u32_state(rnd) %
+				       ((u32)INT_MAX - cfg->cluster);
+			keys[i] = base + i % cfg->cluster;
+			break;
+		default:
+			keys[i] = prandom_u32_state(rnd) % 1000000;
+			break;
+		}
+		lookup[i] = i;
+	}
+
+	if (cfg->key_dist != BENCH_KEYS_ZIPF && cfg->key_dist != BENCH_KEYS_HOTSET) {
+		/* Otherwise lookups replay the insertion order */
+		if (cfg->shuffle)
+			bench_shuffle(lookup, n, rnd);
+		return 0;
+	}
+
+	perm = kvmalloc_array(n, sizeof(*perm), GFP_KERNEL);
+	if (!perm)
+		return -ENOMEM;
+	for (i = 0; i < n; i++)
+		perm[i] = i;
+	bench_shuffle(perm, n, rnd);
+
+	if (cfg->key_dist == BENCH_KEYS_ZIPF)
+		err = bench_gen_zipf(cfg, lookup, perm, rnd);
+	else
+		bench_gen_hotset(cfg, lookup, perm, rnd);
+
+	kvfree(perm);
+	return err;
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Build the lookup and delete inputs for one run from the keys and the
+ * lookup positions picked by bench_gen_keys().  Absent keys are drawn
+ * from [0, max key + n] so they land between and around the present
+ * ones; their XArray index n + i is never populated.
+ */
+static int bench_gen_probes(const struct bench_cfg *cfg, struct bench_run *r,
+			    const u32 *lookup, struct rnd_state *rnd)
+{
+	u32 *sorted, cand, span, max_key = 0;
+	int i, n = r->n;
+
+	r->hit = kvmalloc_array(3 * n, sizeof(*r->hit), GFP_KERNEL);
+	r->del_order = kvmalloc_array(n, sizeof(*r->del_order), GFP_KERNEL);
+	sorted = kvmalloc_array(n, sizeof(*sorted), GFP_KERNEL);
+	if (!r->hit || !r->del_order || !sorted) {
+		kvfree(sorted);
+		return -ENOMEM;
+	}
+	r->miss = r->hit + n;
+	r->mixed = r->miss + n;
+
+	memcpy(sorted, r->keys, n * sizeof(*sorted));
+	sort(sorted, n, sizeof(*sorted), bench_cmp_u32, NULL);
+	max_key = sorted[n - 1];
+	span = min_t(u64, (u64)max_key + 1 + n, INT_MAX);
+
+	for (i = 0; i < n; i++) {
+		r->hit[i].key = r->keys[lookup[i]];
+		r->hit[i].idx = lookup[i];
+
+		do {
+			cand = prandom_u32_state(rnd) % span;
+		} while (bsearch(&cand, sorted, n, sizeof(*sorted), bench_cmp_u32));
+		r->miss[i].key = cand;
+		r->miss[i].idx = (n > 1 ? lookup[i] % (n - 1) : 0) *
+				 BENCH_XA_STRIDE + 1;
+
+		if (prandom_u32_state(rnd) % 100 < (u32)cfg->hit_pct) {
+			r->mixed[i] = r->hit[i];
+			r->mixed[i].idx = lookup[i] * BENCH_XA_STRIDE;
+		} else {
+			r->mixed[i] = r->miss[i];
+		}
+
+		r->del_order[i] = i;
+	}
+	bench_shuffle(r->del_order, n, rnd);
+
+	kvfree(sorted);
+	return 0;
+}
+
+static void bench_probes_free(struct bench_run *r)
+{
+	kvfree(r->hit);
+	kvfree(r->del_order);
+}
+
+/* First CPU of @node, or -1 if it has none (memory-only node) */
+static int bench_node_cpu(int node)
+{
+	unsigned int cpu = cpumask_first_and(cpumask_of_node(node),
+					     cpu_online_mask);
+
+	return cpu < nr_cpu_ids ? (int)cpu : -1;
+}
+
+/* numa=1 node the entries go to */
+static int bench_numa_node(const struct bench_cfg *cfg)
+{
+	return cfg->node == NUMA_NO_NODE ? first_memory_node : cfg->node;
+}
+
+/* CPU on the nearest other node that has CPUs, or -1 if there is none */
+static int bench_numa_remote_cpu(int node)
+{
+	int nid, far = NUMA_NO_NODE;
+
+	for_each_node_with_cpus(nid) {
+		if (nid != node && (far == NUMA_NO_NODE ||
+				    node_distance(node, nid) <
+				    node_distance(node, far)))
+			far = nid;
+	}
+	return far == NUMA_NO_NODE ? -1 : bench_node_cpu(far);
+}
+
+/* bench_tick() calls a run of @cfg will make, for the progress figure */
+static int bench_nr_units(const struct bench_cfg *cfg)
+{
+	int structs = hweight_long(cfg->structs);
+	int threads, variants = 1, levels = 1;
+
+	/* bench_numa_run() leaves out the remote variant with one node */
+	if (cfg->numa) {
+		variants = BENCH_NUMA_NR;
+		if (bench_numa_remote_cpu(bench_numa_node(cfg)) < 0)
+			variants--;
+	}
+	if (!cfg->threads)
+		return (cfg->warmup + cfg->trials) * structs * variants +
+		       (cfg->split ? cfg->trials * structs : 0);
+
+	threads = min_t(int, cfg->threads, num_online_cpus());
+	while (levels < BENCH_MT_LEVELS && BIT(levels - 1) < (unsigned long)threads)
+		levels++;
+	/* bench_mt_run() skips lib/btree under RCU */
+	return (hweight_long(cfg->sync) * structs -
+		((cfg->sync & BIT(BENCH_SYNC_RCU)) &&
+		 (cfg->structs & BIT(BENCH_BTREE)))) * levels;
+}
+
+/*
+ * One pass over the selected structures.  Trials below zero are warmup
+ * and go to @warm, which is thrown away; the others also record each
+ * structure's ns/op per cell for the statistics.
+ */
+static int bench_trial(struct bench_run *r, struct bench_result *res,
+		       struct bench_result *warm, int t)
+{
+	struct bench_result *into = t < 0 ? warm : res;
+	u64 before[BENCH_CELL_NR];
+	int id, c, err;
+
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BIT(id)))
+			continue;
+		for (c = 0; c < BENCH_CELL_NR; c++)
+			before[c] = bench_cell(into, c)[id];
+
+		r->hist = into->hist[id];
+		r->pmu_acc = into->pmu[id];
+		err = bench_structs[id].run(r, into);
+		if (!err)
+			err = bench_tick();
+		if (err)
+			return err;
+
+		for (c = 0; t >= 0 && c < BENCH_CELL_NR; c++)
+			res->samples[c][id][t] = min_t(u64, U32_MAX,
+				bench_cell(res, c)[id] - before[c]);
+	}
+	return 0;
+}
+
+/*
+ * Steps:
+ * 1. Generate cfg->n keys and lookup positions (see bench_gen_keys())
+ *    plus absent keys and a delete order (bench_gen_probes())
+ * 2. For each selected structure and each trial, time cfg->n inserts
+ *    (allocation + insert), cfg->n hit, miss and mixed lookups,
+ *    cfg->n deletes and a teardown
+ * 3. Average the per-trial ns/op over cfg->trials
+ *
+ * With cfg->threads set, step 2 is replaced by the concurrent benchmark.
+ */
+static int run_benchmark(const struct bench_cfg *cfg, struct bench_result *res)
+{
+	struct bench_result *warm = NULL;
+	struct bench_run r = {};
+	struct rnd_state rnd;
+	u32 *random, *lookup;
+	int t, id, err = 0;
+
+	memset(res, 0, sizeof(*res));
+	res->cfg = *cfg;
+	/* Report the seed actually used so the run can be repeated */
+	if (!res->cfg.seed)
+		res->cfg.seed = get_random_u64() ?: 1;
+	cfg = &res->cfg;
+
+	// Keys live on the heap, bench_size ints could be far too big for the kernel stack
+	random = kvmalloc_array(cfg->n, sizeof(u32), GFP_KERNEL);
+	lookup = kvmalloc_array(cfg->n, sizeof(u32), GFP_KERNEL);
+	if (!random || !lookup) {
+		err = -ENOMEM;
+		goto out;
+	}
+	prandom_seed_state(&rnd, cfg->seed);
+	err = bench_gen_keys(cfg, random, lookup, &rnd);
+	if (err)
+		goto out;
+
+	if (cfg->threads) {
+		err = bench_mt_run(cfg, random, res);
+		goto out;
+	}
+
+	r.keys = random;
+	r.n = cfg->n;
+	r.sample = cfg->sample;
+	r.nopreempt = cfg->nopreempt;
+	err = bench_gen_probes(cfg, &r, lookup, &rnd);
+	if (err)
+		goto out_probes;
+	r.ents = kvmalloc_array(cfg->n, sizeof(*r.ents), GFP_KERNEL);
+	if (!r.ents) {
+		err = -ENOMEM;
+		goto out_probes;
+	}
+	err = bench_alloc_init(&r.alloc, cfg->alloc, my_entry_cache,
+			       sizeof(struct my_entry), cfg->n, cfg->alloc_node);
+	if (err)
+		goto out_ents;
+	if (cfg->pmu)
+		res->pmu_avail = bench_pmu_open(&r.pmu);
+	if (cfg->warmup) {
+		warm = kvzalloc(sizeof(*warm), GFP_KERNEL);
+		if (!warm) {
+			err = -ENOMEM;
+			goto out_alloc;
+		}
+		warm->cfg = *cfg;
+	}
+
+	for (t = -cfg->warmup; t < cfg->trials; t++) {
+		err = bench_trial(&r, res, warm, t);
+		if (err)
+			goto out_alloc;
+	}
+
+	for (id = 0; id < BENCH_NR; id++) {
+		res->insert_ns[id] /= cfg->trials;
+		res->insert_only_ns[id] /= cfg->trials;
+		res->bulk_ns[id] /= cfg->trials;
+		res->lookup_ns[id] /= cfg->trials;
+		res->miss_ns[id] /= cfg->trials;
+		res->mixed_ns[id] /= cfg->trials;
+		res->delete_ns[id] /= cfg->trials;
+		res->teardown_ns[id] /= cfg->trials;
+	}
+	res->os_insert_ns /= cfg->trials;
+	res->bulk_sort_ns /= cfg->trials;
+	res->bulk_build_ns /= cfg->trials;
+	if (res->alloc_runs)
+		res->alloc_ns /= res->alloc_runs;
+#ifndef __KERNEL__
+	/* same keys and probes through std:: containers, see user/baseline.cc */
+	lkp_user_baseline(cfg->n, cfg->trials, cfg->warmup, cfg->hit_pct,
+			  r.keys, r.hit, r.miss, r.mixed, r.del_order);
+#endif
+	if (cfg->split) {
+		err = bench_split_run(&r, res);
+		if (err)
+			goto out_alloc;
+	}
+	if (cfg->structs & BIT(BENCH_XAVAL))
+		err = bench_xa_sparse(cfg, res);
+
+out_alloc:
+	kvfree(warm);
+	bench_pmu_close(&r.pmu);
+	bench_alloc_release(&r.alloc);
+out_ents:
+	kvfree(r.ents);
+out_probes:
+	bench_probes_free(&r);
+out:
+	kvfree(lookup);
+	kvfree(random);
+	res->err = err;
+	return err;
+}
+
+/*
+ * Runs are started by writing to /proc/lkp_ds_bench, or by loading the
+ * module with bench_size > 0, and executed in a work item so neither
+ * the writer nor insmod blocks.  Only one run may be in flight;
+ * bench_lock protects the published result and the state, and
+ * bench_next is stable while a run is in flight.
+ */
+enum bench_state {
+	BENCH_IDLE,                      /* no run yet */
+	BENCH_RUNNING,
+	BENCH_DONE,
+	BENCH_FAILED,                    /* bench_res.err says why */
+};
+
+static const char * const bench_state_names[] = {
+	[BENCH_IDLE]    = "idle",
+	[BENCH_RUNNING] = "running",
+	[BENCH_DONE]    = "done",
+	[BENCH_FAILED]  = "failed",
+};
+
+static DEFINE_MUTEX(bench_lock);
+static enum bench_state bench_state;
+static struct bench_cfg bench_next;      /* config of the run in flight */
+static struct bench_result bench_res;    /* latest completed run */
+static struct bench_result bench_scratch;
+
+struct bench_pinned {
+	const struct bench_cfg *cfg;
+	struct bench_result *res;
+	int err;
+	struct completion done;
+};
+
+static int bench_pinned_fn(void *data)
+{
+	struct bench_pinned *p = data;
+
+	p->err = run_benchmark(p->cfg, p->res);
+	complete(&p->done);
+
+	/* Stay around until bench_run_pinned() reaps us with kthread_stop() */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+/*
+ * cpu=: run in a kthread bound to that CPU.  Workqueue workers cannot
+ * be rebound, and a work item this long on a per-CPU pool would hold
+ * up everything else queued on that CPU.
+ */
+static int bench_run_pinned(const struct bench_cfg *cfg,
+			    struct bench_result *res)
+{
+	struct bench_pinned p = { .cfg = cfg, .res = res };
+	struct task_struct *task;
+	int err;
+
+	if (!cpu_online(cfg->cpu)) {
+		err = -ENODEV;
+		goto fail;
+	}
+	init_completion(&p.done);
+	task = kthread_create(bench_pinned_fn, &p, "lkp_bench/%d", cfg->cpu);
+	if (IS_ERR(task)) {
+		err = PTR_ERR(task);
+		goto fail;
+	}
+	kthread_bind(task, cfg->cpu);
+	wake_up_process(task);
+	wait_for_completion(&p.done);
+	kthread_stop(task);
+	return p.err;
+
+fail:
+	memset(res, 0, sizeof(*res));
+	res->cfg = *cfg;
+	res->err = err;
+	return err;
+}
+
+/*
+ * numa=1: the same run three times with the entries (and hash bucket
+ * arrays) on one memory node: from a CPU on that node, from a CPU on
+ * the nearest other node that has CPUs, and from the local CPU again
+ * with the entries spread round-robin over all memory nodes.  Nodes
+ * that the XArray, maple tree and lib/btree allocate internally follow
+ * the inserting CPU.  The main tables show the local run; of the other
+ * two only insert and lookup are kept.  They leave out the split
+ * layouts, range scans and counters, but run every other phase of a
+ * trial like the local run does, so all three see the same allocator
+ * and cache state.  With one node the remote variant is left out.
+ */
+static int bench_numa_run(const struct bench_cfg *cfg,
+			  struct bench_result *res)
+{
+	u64 ns[BENCH_NUMA_NR][2][BENCH_NR] = {};
+	int cpu[BENCH_NUMA_NR], v, id, err;
+	int node = bench_numa_node(cfg);
+	struct bench_result *tmp, *out;
+	struct bench_cfg c;
+
+	if (!node_state(node, N_MEMORY)) {
+		err = -EINVAL;
+		goto fail;
+	}
+	cpu[BENCH_NUMA_LOCAL] = bench_node_cpu(node);
+	if (cpu[BENCH_NUMA_LOCAL] < 0) {
+		err = -EINVAL;
+		goto fail;
+	}
+	cpu[BENCH_NUMA_REMOTE] = bench_numa_remote_cpu(node);
+	cpu[BENCH_NUMA_INTERLEAVE] = cpu[BENCH_NUMA_LOCAL];
+
+	tmp = kvzalloc(sizeof(*tmp), GFP_KERNEL);
+	if (!tmp) {
+		err = -ENOMEM;
+		goto fail;
+	}
+
+	/* Local last, straight into @res */
+	for (v = BENCH_NUMA_NR - 1; v >= 0; v--) {
+		if (cpu[v] < 0)
+			continue;
+		c = *cfg;
+		c.cpu = cpu[v];
+		c.alloc_node = v == BENCH_NUMA_INTERLEAVE ?
+			       BENCH_NODE_INTERLEAVE : node;
+		if (v != BENCH_NUMA_LOCAL) {
+			c.split = false;
+			c.nr_ranges = 0;
+			c.pmu = false;
+		}
+		out = v == BENCH_NUMA_LOCAL ? res : tmp;
+		err = bench_run_pinned(&c, out);
+		if (err)
+			break;
+		for (id = 0; id < BENCH_NR; id++) {
+			ns[v][0][id] = out->insert_ns[id];
+			ns[v][1][id] = out->lookup_ns[id];
+		}
+	}
+	kvfree(tmp);
+	if (err)
+		goto fail;
+
+	/* bench_run_pinned() reset @res, restore what the caller asked for */
+	res->cfg.cpu = cfg->cpu;
+	res->numa_node = node;
+	memcpy(res->numa_cpu, cpu, sizeof(cpu));
+	memcpy(res->numa_ns, ns, sizeof(ns));
+	return 0;
+
+fail:
+	memset(res, 0, sizeof(*res));
+	res->cfg = *cfg;
+	res->err = err;
+	return err;
+}
+
+static void bench_work_fn(struct work_struct *work)
+{
+	int err;
+
+	/* Concurrent runs pin their own threads */
+	if (bench_next.numa)
+		err = bench_numa_run(&bench_next, &bench_scratch);
+	else if (bench_next.cpu >= 0 && !bench_next.threads)
+		err = bench_run_pinned(&bench_next, &bench_scratch);
+	else
+		err = run_benchmark(&bench_next, &bench_scratch);
+
+	if (err)
+		pr_warn("benchmark run failed (error %d)\n", err);
+
+	mutex_lock(&bench_lock);
+	bench_res = bench_scratch;
+	bench_state = err ? BENCH_FAILED : BENCH_DONE;
+	mutex_unlock(&bench_lock);
+}
+
+static DECLARE_WORK(bench_work, bench_work_fn);
+
+static int bench_start(const struct bench_cfg *cfg)
+{
+	mutex_lock(&bench_lock);
+	if (bench_state == BENCH_RUNNING) {
+		mutex_unlock(&bench_lock);
+		return -EBUSY;
+	}
+	bench_state = BENCH_RUNNING;
+	bench_next = *cfg;
+	bench_units = bench_nr_units(cfg);
+	atomic_set(&bench_units_done, 0);
+	mutex_unlock(&bench_lock);
+
+	queue_work(system_unbound_wq, &bench_work);
+	return 0;
+}
+
+/* Concurrent mode table; no ':' in it so bench.sh's row parsing is unaffected */
+static void lkp_bench_show_mt(struct seq_file *m, struct bench_result *res)
+{
+	struct bench_mt_cell *c;
+	int sync, id, level;
+
+	seq_printf(m, "Concurrent mixed workload (%d%% inserts, %d prefilled, %d ops/thread)\n",
+		   res->cfg.write_pct, res->cfg.n, res->cfg.ops ?: res->cfg.n);
+	seq_printf(m, "  %-16s %-7s %7s %14s %12s %12s\n", "structure", "sync",
+		   "threads", "ops/sec", "ns/op mean", "ns/op max");
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BIT(id)))
+			continue;
+		for (sync = 0; sync < BENCH_SYNC_NR; sync++) {
+			if (!(res->cfg.sync & BIT(sync)))
+				continue;
+			for (level = 0; level < res->mt_levels; level++) {
+				c = &res->mt[sync][id][level];
+				if (!c->threads)
+					continue;
+				seq_printf(m, "  %-16.*s %-7s %7d %14llu %12llu %12llu\n",
+					   (int)strlen(bench_structs[id].label) - 1,
+					   bench_structs[id].label,
+					   bench_sync_names[sync], c->threads,
+					   c->ops_per_sec, c->mean_ns, c->max_ns);
+			}
+		}
+	}
+}
+
+/* --- /proc/lkp_ds_bench show --- */
+/* Power of two (in ns) that bucket @idx belongs to, for the ASCII chart */
+static unsigned int bench_hist_group(unsigned int idx)
+{
+	if (idx < BENCH_HIST_SUB)
+		return idx ? ilog2(idx) : 0;
+	return idx / BENCH_HIST_SUB + BENCH_HIST_SUB_BITS - 1;
+}
+
+static u64 bench_hist_group_count(const struct bench_hist *h, unsigned int g)
+{
+	unsigned int i;
+	u64 sum = 0;
+
+	for (i = 0; i < BENCH_HIST_BUCKETS; i++)
+		if (bench_hist_group(i) == g)
+			sum += h->buckets[i];
+	return sum;
+}
+
+#define BENCH_HIST_BAR	40	/* width of the longest bar */
+
+static void lkp_bench_show_chart(struct seq_file *m, const struct bench_hist *h)
+{
+	unsigned int g, first = 64, last = 0;
+	u64 cnt, peak = 0;
+
+	for (g = 0; g < 64; g++) {
+		cnt = bench_hist_group_count(h, g);
+		if (!cnt)
+			continue;
+		first = min(first, g);
+		last = g;
+		peak = max(peak, cnt);
+	}
+
+	for (g = first; g <= last && peak; g++) {
+		cnt = bench_hist_group_count(h, g);
+		seq_printf(m, "  %10llu - %-10llu %10llu |%-*.*s|\n",
+			   g ? 1ULL << g : 0, (2ULL << g) - 1, cnt,
+			   BENCH_HIST_BAR,
+			   (int)DIV_ROUND_UP_ULL(cnt * BENCH_HIST_BAR, peak),
+			   "########################################");
+	}
+}
+
+static void lkp_bench_show_hist(struct seq_file *m, struct bench_result *res)
+{
+	static const unsigned int pcts[] = { 500, 900, 990, 999 };
+	const struct bench_hist *h;
+	unsigned int i;
+	int id, op;
+
+	seq_printf(m, "Latency percentiles (ns, every %d op%s sampled)\n",
+		   res->cfg.sample, res->cfg.sample == 1 ? "" : "s");
+	seq_printf(m, "  %-16s %-7s %10s %8s %8s %8s %8s %10s\n", "structure",
+		   "op", "samples", "p50", "p90", "p99", "p99.9", "max");
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BIT(id)))
+			continue;
+		for (op = 0; op < BENCH_OP_NR; op++) {
+			h = &res->hist[id][op];
+			seq_printf(m, "  %-16.*s %-7s %10llu",
+				   (int)strlen(bench_structs[id].label) - 1,
+				   bench_structs[id].label, bench_op_names[op],
+				   h->count);
+			for (i = 0; i < ARRAY_SIZE(pcts); i++)
+				seq_printf(m, " %8llu", bench_hist_pct(h, pcts[i]));
+			seq_printf(m, " %10llu\n", h->max);
+		}
+	}
+
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BIT(id)))
+			continue;
+		for (op = 0; op < BENCH_OP_NR; op++) {
+			seq_printf(m, "\n");
+			seq_printf(m, "Latency histogram, %.*s %s (ns)\n",
+				   (int)strlen(bench_structs[id].label) - 1,
+				   bench_structs[id].label, bench_op_names[op]);
+			lkp_bench_show_chart(m, &res->hist[id][op]);
+		}
+	}
+}
+
+static void lkp_bench_show_keys(struct seq_file *m, const struct bench_cfg *cfg)
+{
+	seq_printf(m, "Keys %s", bench_key_dist_names[cfg->key_dist]);
+	switch (cfg->key_dist) {
+	case BENCH_KEYS_CLUSTERED:
+		seq_printf(m, " (runs of %d)", cfg->cluster);
+		break;
+	case BENCH_KEYS_ZIPF:
+		seq_printf(m, " (theta=%d.%02d)", cfg->theta / 100, cfg->theta % 100);
+		break;
+	case BENCH_KEYS_HOTSET:
+		seq_printf(m, " (%d%% of lookups on %d%% of keys)",
+			   cfg->hot_ops, cfg->hot_keys);
+		break;
+	default:
+		break;
+	}
+	if (cfg->shuffle && cfg->key_dist != BENCH_KEYS_ZIPF &&
+	    cfg->key_dist != BENCH_KEYS_HOTSET)
+		seq_printf(m, ", shuffled lookups");
+	seq_printf(m, ", seed %llu\n", cfg->seed);
+	if (cfg->threads || (!cfg->warmup && cfg->cpu < 0 && !cfg->nopreempt))
+		return;
+	seq_printf(m, "Run after %d warmup trial(s)", cfg->warmup);
+	if (cfg->cpu >= 0)
+		seq_printf(m, ", pinned to CPU %d", cfg->cpu);
+	if (cfg->nopreempt)
+		seq_printf(m, ", lookups with preemption off");
+	seq_printf(m, "\n");
+}
+
+static void lkp_bench_show_xa_mem(struct seq_file *m, struct bench_result *res)
+{
+	static const char * const layout[BENCH_XA_MEM_NR] = {
+		[BENCH_XA_MEM_INDEX]  = "by index",
+		[BENCH_XA_MEM_VALUE]  = "by value",
+		[BENCH_XA_MEM_SPARSE] = "sparse below 2^32",
+	};
+	unsigned long bytes;
+	int i;
 
-		err = store_value(val);
-		if (err)
-			break;
+	seq_printf(m, "XArray footprint (xa_node = %zu bytes)\n",
+		   sizeof(struct xa_node));
+	seq_printf(m, "  %-18s %10s %10s %12s %10s\n", "layout", "keys",
+		   "nodes", "bytes", "bytes/key");
+	for (i = 0; i < BENCH_XA_MEM_NR; i++) {
+		if (!res->xa_nodes[i])
+			continue;
+		bytes = res->xa_nodes[i] * sizeof(struct xa_node);
+		seq_printf(m, "  %-18s %10d %10lu %12lu %10lu\n", layout[i],
+			   res->cfg.n, res->xa_nodes[i], bytes,
+			   bytes / res->cfg.n);
 	}
+}
 
-	kfree(orig);
-	return err;
+/* @total / @ops with two decimals, right-aligned in @width */
+static void lkp_bench_show_ratio(struct seq_file *m, int width, u64 total,
+				 u64 ops)
+{
+	u64 q = ops ? div64_u64(total * 100, ops) : 0;
 
+	seq_printf(m, "%*llu.%02llu", width - 3, q / 100, q % 100);
 }
 
-/* --- /proc/lkp_ds show --- */
-static int lkp_ds_show(struct seq_file *m, void *v)
-{
-	/* TODO: Iterate each structure and print values, comma-separated.
-	 *
-	 * Expected format (one line per structure):
-	 *   Linked list:    1, 2, 3, 4, 5
-	 *   Hash table:     3, 4, 1, 2, 5
-	 *   Red-black tree: 1, 2, 3, 4, 5
-	 *   XArray:         1, 2, 3, 4, 5
-	 *
-	 * Iteration macros:
-	 *   list: list_for_each_entry(entry, &my_list, list)
-	 *   hash: hash_for_each(my_htable, bkt, entry, hnode)
-	 *   rbtree: for (rb = rb_first(&my_tree); rb; rb = rb_next(rb))
-	 *           then rb_entry(rb, struct my_entry, node)
-	 *   xarray: xa_for_each(&my_xarray, index, entry)
-	 *
-	 * Note: hash table output order depends on the kernel's hash function
-	 * and will differ from the example. This is expected.
-	 */
-
-	// Create an iterable entry
-	struct my_entry *e;
-	// First we go over the list
-    seq_printf(m, "Linked List: ");
-
-	list_for_each_entry(e, &my_list, list /** This is the field name in the first struct we passed to get the pointer */ ) {
-		seq_printf(m, "%d, ", e->value);
-	}
-    seq_printf(m, "\n");
+/*
+ * Per-op counter table for each phase, plus IPC next to the instruction
+ * count. Counters are summed over all trials, hence n * trials ops.
+ */
+static void lkp_bench_show_pmu(struct seq_file *m, struct bench_result *res)
+{
+	unsigned long avail = res->pmu_avail;
+	u64 ops = (u64)res->cfg.n * res->cfg.trials;
+	bool ipc = (avail & BIT(BENCH_PMU_CYCLES)) &&
+		   (avail & BIT(BENCH_PMU_INSNS));
+	const u64 *c;
+	int op, id, i;
 
-	// We can use the same entry 
+	if (!(avail & BENCH_PMU_HW_MASK))
+		seq_printf(m, "Counters: no hardware PMU events, software only\n\n");
 
-	int bkt; //This is used to just see which bucket we are on when iterating the has table. Not 
-	//neccesarry for now but could be useful for debugging purposes
+	for (op = 0; op < BENCH_OP_NR; op++) {
+		seq_printf(m, "Counters %s (per op):\n", bench_op_names[op]);
+		seq_printf(m, "  %-16s", "");
+		for_each_set_bit(i, &avail, BENCH_PMU_NR) {
+			seq_printf(m, "%11s", bench_pmu_evs[i].name);
+			if (i == BENCH_PMU_INSNS && ipc)
+				seq_printf(m, "%7s", "IPC");
+		}
+		seq_printf(m, "\n");
 
-	// No we iterate hash
-	seq_printf(m, "Hash Table: ");
-	hash_for_each(my_htable, bkt, e, hnode) {
-		seq_printf(m, "%d, ", e->value);
+		for (id = 0; id < BENCH_NR; id++) {
+			seq_printf(m, "  %-16s", bench_structs[id].label);
+			if (!(res->cfg.structs & BIT(id))) {
+				seq_printf(m, "-\n");
+				continue;
+			}
+			c = res->pmu[id][op];
+			for_each_set_bit(i, &avail, BENCH_PMU_NR) {
+				lkp_bench_show_ratio(m, 11, c[i], ops);
+				if (i == BENCH_PMU_INSNS && ipc)
+					lkp_bench_show_ratio(m, 7, c[BENCH_PMU_INSNS],
+							     c[BENCH_PMU_CYCLES]);
+			}
+			seq_printf(m, "\n");
+		}
+		if (op < BENCH_OP_NR - 1)
+			seq_printf(m, "\n");
 	}
+}
+
+/* @hist is the sampled lookups, NULL when sampling is off */
+static void lkp_bench_show_split_row(struct seq_file *m, const char *label,
+				     const char *layout, unsigned int bytes,
+				     u64 insert, u64 lookup, u64 miss,
+				     const struct bench_hist *hist,
+				     const u64 *pmu, unsigned long avail, u64 ops)
+{
+	seq_printf(m, "  %-16s%-8s%6u%8llu%8llu%8llu", label, layout, bytes,
+		   insert, lookup, miss);
+	if (hist)
+		seq_printf(m, "%8llu", bench_hist_pct(hist, 990));
+	if (avail & BIT(BENCH_PMU_L1D))
+		lkp_bench_show_ratio(m, 10, pmu[BENCH_PMU_L1D], ops);
+	if (avail & BIT(BENCH_PMU_LLC))
+		lkp_bench_show_ratio(m, 10, pmu[BENCH_PMU_LLC], ops);
 	seq_printf(m, "\n");
+}
 
-	struct rb_node *rb; //we need to get the rbnode to move over
-    seq_printf(m, "Red-Black tree: ");
-	for (rb = rb_first(&my_tree); rb; rb = rb_next(rb)) {
-		struct my_entry *entry = rb_entry(rb, struct my_entry, node);
+/* Shared my_entry against the compact per-structure nodes, side by side */
+static void lkp_bench_show_split(struct seq_file *m, struct bench_result *res)
+{
+	unsigned long avail = res->pmu_avail;
+	u64 ops = (u64)res->cfg.n * res->cfg.trials;
+	bool sampled = res->cfg.sample;
+	int id;
 
-		seq_printf(m, "%d, ", entry->value);
-	}
+	seq_printf(m, "Split layout vs shared entry (ns/op, alloc=%s):\n",
+		   bench_alloc_names[res->cfg.alloc]);
+	seq_printf(m, "  %-16s%-8s%6s%8s%8s%8s", "", "layout", "bytes",
+		   "insert", "lookup", "miss");
+	if (sampled)
+		seq_printf(m, "%8s", "p99");
+	if (avail & BIT(BENCH_PMU_L1D))
+		seq_printf(m, "%10s", "L1d/lkp");
+	if (avail & BIT(BENCH_PMU_LLC))
+		seq_printf(m, "%10s", "LLC/lkp");
 	seq_printf(m, "\n");
 
-	//use the same entry again?
-	seq_printf(m, "XArray: ");
-	unsigned long index;
-	xa_for_each(&my_xarray, index, e) {
-		seq_printf(m, "%d, ", e->value);
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BIT(id))) {
+			seq_printf(m, "  %-16s-\n", bench_structs[id].label);
+			continue;
+		}
+		lkp_bench_show_split_row(m, bench_structs[id].label, "shared",
+					 bench_entry_bytes(res->cfg.alloc),
+					 res->insert_ns[id], res->lookup_ns[id],
+					 res->miss_ns[id],
+					 sampled ? &res->hist[id][BENCH_OP_LOOKUP] : NULL,
+					 res->pmu[id][BENCH_OP_LOOKUP], avail, ops);
+		lkp_bench_show_split_row(m, "", "split", res->split_bytes[id],
+					 res->split_ns[id][BENCH_OP_INSERT],
+					 res->split_ns[id][BENCH_OP_LOOKUP],
+					 res->split_ns[id][BENCH_OP_MISS],
+					 sampled ? &res->split_hist[id][BENCH_OP_LOOKUP] :
+						   NULL,
+					 res->split_pmu[id][BENCH_OP_LOOKUP],
+					 avail, ops);
 	}
-	seq_printf(m, "\n");
-	return 0;
 }
 
-static int lkp_ds_open(struct inode *inode, struct file *file)
+/* ns/query, keys/query and ns/key, "next" being the successor query */
+static void lkp_bench_show_range(struct seq_file *m, struct bench_result *res)
 {
-	return single_open(file, lkp_ds_show, NULL);
-}
+	static const char * const title[] = {
+		"ns/query", "keys/query", "ns/key",
+	};
+	const struct bench_cfg *cfg = &res->cfg;
+	u64 queries = (u64)cfg->range_q * cfg->trials;
+	u64 ns, elems;
+	unsigned int t;
+	int id, w;
 
-static const struct proc_ops lkp_ds_ops = {
-	.proc_open    = lkp_ds_open,
-	.proc_read    = seq_read,
-	.proc_lseek   = seq_lseek,
-	.proc_release = single_release,
-};
+	for (t = 0; t < ARRAY_SIZE(title); t++) {
+		if (t)
+			seq_printf(m, "\n");
+		seq_printf(m, "Range scan (%s, %d queries per width):\n",
+			   title[t], cfg->range_q);
+		seq_printf(m, "  %-16s%10s", "width", "next");
+		for (w = 0; w < cfg->nr_ranges; w++)
+			seq_printf(m, "%10d", cfg->ranges[w]);
+		seq_printf(m, "\n");
 
-/* ===================================================================
- * Benchmark (Part B.3)
- * =================================================================== */
+		for (id = 0; id < BENCH_NR; id++) {
+			seq_printf(m, "  %-16s", bench_structs[id].label);
+			if (!(cfg->structs & BENCH_RANGE_STRUCTS & BIT(id))) {
+				seq_printf(m, "%10s\n", "-");
+				continue;
+			}
+			for (w = 0; w <= cfg->nr_ranges; w++) {
+				ns = res->range_ns[id][w];
+				elems = res->range_elems[id][w];
+				if (t == 0)
+					lkp_bench_show_ratio(m, 10, ns, queries);
+				else if (t == 1)
+					lkp_bench_show_ratio(m, 10, elems, queries);
+				else if (elems)
+					lkp_bench_show_ratio(m, 10, ns, elems);
+				else
+					seq_printf(m, "%10s", "-");
+			}
+			seq_printf(m, "\n");
+		}
+	}
+}
 
-/* --- /proc/lkp_ds_bench show --- */
-static int lkp_bench_show(struct seq_file *m, void *v)
+/* Walk vs augmented rbtree; insert compares against the plain tree */
+static void lkp_bench_show_os(struct seq_file *m, struct bench_result *res)
 {
-	seq_printf(m, "LKP Data Structure Benchmark (N=%d)\n", bench_n);
-	seq_printf(m, "=======================================\n");
-	seq_printf(m, "Insert (ns/op):\n");
-	seq_printf(m, "  Linked list:    %llu\n", bench_insert_ns[0]);
-	seq_printf(m, "  Hash table:     %llu\n", bench_insert_ns[1]);
-	seq_printf(m, "  Red-black tree: %llu\n", bench_insert_ns[2]);
-	seq_printf(m, "  XArray:         %llu\n", bench_insert_ns[3]);
+	const struct bench_cfg *cfg = &res->cfg;
+	u64 queries = (u64)cfg->os_q * cfg->trials;
+	u64 plain = res->insert_only_ns[BENCH_RBTREE];
+	int op;
+
+	seq_printf(m, "Order statistics (rbtree, ns/op, %d queries):\n",
+		   cfg->os_q);
+	seq_printf(m, "  %-16s%10s%10s\n", "", "walk", "augmented");
+	for (op = 0; op < BENCH_OS_NR; op++) {
+		seq_printf(m, "  %-16s", bench_os_names[op]);
+		lkp_bench_show_ratio(m, 10, res->os_ns[op][0], queries);
+		lkp_bench_show_ratio(m, 10, res->os_ns[op][1], queries);
+		seq_printf(m, "\n");
+	}
+	seq_printf(m, "  %-16s%10llu%10llu", "Insert pre-alloc",
+		   plain, res->os_insert_ns);
+	if (plain)
+		seq_printf(m, "  (%+lld%%)",
+			   div64_s64(((s64)res->os_insert_ns - plain) * 100,
+				     plain));
 	seq_printf(m, "\n");
-	seq_printf(m, "Lookup (ns/op):\n");
-	seq_printf(m, "  Linked list:    %llu\n", bench_lookup_ns[0]);
-	seq_printf(m, "  Hash table:     %llu\n", bench_lookup_ns[1]);
-	seq_printf(m, "  Red-black tree: %llu\n", bench_lookup_ns[2]);
-	seq_printf(m, "  XArray:         %llu\n", bench_lookup_ns[3]);
-	return 0;
 }
 
-static int lkp_bench_open(struct inode *inode, struct file *file)
+/* Two-sided 95% Student t quantiles * 1000, by degrees of freedom */
+static const u16 bench_t95[] = {
+	12706, 4303, 3182, 2776, 2571, 2447, 2365, 2306, 2262, 2228,
+	2201, 2179, 2160, 2145, 2131, 2120, 2110, 2101, 2093, 2086,
+	2080, 2074, 2069, 2064, 2060, 2056, 2052, 2048, 2045, 2042,
+};
+
+static u32 bench_t95_milli(int df)
 {
-	return single_open(file, lkp_bench_show, NULL);
+	if (df <= (int)ARRAY_SIZE(bench_t95))
+		return bench_t95[df - 1];
+	return df <= 60 ? 2000 : df <= 120 ? 1980 : 1960;
 }
 
-static const struct proc_ops lkp_bench_ops = {
-	.proc_open    = lkp_bench_open,
-	.proc_read    = seq_read,
-	.proc_lseek   = seq_lseek,
-	.proc_release = single_release,
-};
-
 /*
- * TODO: Implement run_benchmark()
- *
- * IMPORTANT: Use SEPARATE data structures for the benchmark so that
- * benchmark data does not pollute the correctness data from int_str.
- * Declare local list/hashtable/rbtree/xarray at the top of this function
- * (or as file-scope statics with bench_ prefix).
- *
- * Steps:
- * 1. Allocate an array of bench_size random ints (use get_random_u32())
- * 2. For each data structure:
- *    a. Time inserting all bench_size entries (kmalloc + insert)
- *    b. Store total_ns / bench_size in bench_insert_ns[]
- * 3. For each data structure, time bench_size random lookups:
- *    - List: traverse to find a value (O(n))
- *    - Hash: hash_for_each_possible with value as key (O(1) avg)
- *    - RB-tree: binary search by value (O(log n))
- *    - XArray: xa_load by index (O(1))
- *    Store total_ns / bench_size in bench_lookup_ns[]
- * 4. Free all benchmark entries and auxiliary arrays
- */
-static int run_benchmark(void)
-{
-	u64 start, elapsed;
-	bench_n = bench_size;
-	//Create bench size randoms;
-	// Here i was originally using a normasl array with [] but thats bad becuase with variables it could be too
-	//big for kernel stack and that could. be very bad
-	u32 *random;
-
-	random = kmalloc_array(bench_n, sizeof(u32), GFP_KERNEL);
-	if (!random)
-		return -ENOMEM;
-	for(int i = 0; i < bench_n; i++ ){
-		u32 val = get_random_u32();
-		int range = 1000000;
-        int key = val % range;  /* limit to desired range */
-		random[i] = key;
-	}
+ * Mean, median, sample standard deviation, minimum and the half-width
+ * of the 95% confidence interval of the mean, over the measured trials
+ * of every cell.  A cell whose samples are all zero was not run.
+ */
+static void lkp_bench_show_stats(struct seq_file *m, struct bench_result *res)
+{
+	int trials = res->cfg.trials;
+	u32 v[BENCH_TRIALS_MAX];
+	u64 sum, mean, var, sd, ci;
+	int c, id, t;
+	s64 d;
 
-	//Time the list
-	LIST_HEAD(bench_list);
+	seq_printf(m, "Trial statistics (ns/op, %d trials, %d warmup):\n",
+		   trials, res->cfg.warmup);
+	seq_printf(m, "  %-16s%8s%8s%8s%8s%8s\n", "", "mean", "median",
+		   "stddev", "min", "+-95%");
+	for (c = 0; c < BENCH_CELL_NR; c++) {
+		seq_printf(m, " %s\n", bench_cell_names[c]);
+		for (id = 0; id < BENCH_NR; id++) {
+			if (!(res->cfg.structs & BIT(id)))
+				continue;
+			sum = 0;
+			for (t = 0; t < trials; t++) {
+				v[t] = res->samples[c][id][t];
+				sum += v[t];
+			}
+			if (!sum)
+				continue;
+			sort(v, trials, sizeof(*v), bench_cmp_u32, NULL);
 
+			mean = div_u64(sum, trials);
+			var = 0;
+			for (t = 0; t < trials; t++) {
+				d = (s64)v[t] - mean;
+				var += d * d;
+			}
+			sd = int_sqrt64(div_u64(var, trials - 1));
+			/* t * sd / sqrt(trials), the root taken in thousandths */
+			ci = div64_u64((u64)bench_t95_milli(trials - 1) * sd,
+				       int_sqrt64((u64)trials * 1000000));
 
-	start = ktime_get_ns();
-	for(int i = 0; i < bench_n; i++ ){
-		struct my_entry *e;
-		e = kmalloc(sizeof(*e), GFP_KERNEL);
-		if (!e)
-			return -ENOMEM;
-		//Fill in the value
-		e->value = random[i];
-		list_add_tail(&e->list, &bench_list);
+			seq_printf(m, "  %-16s%8llu%8u%8llu%8u%8llu\n",
+				   bench_structs[id].label, mean,
+				   trials % 2 ? v[trials / 2] :
+				   (v[trials / 2 - 1] + v[trials / 2]) / 2,
+				   sd, v[0], ci);
+		}
 	}
+}
 
-	elapsed = ktime_get_ns() - start;
-	bench_insert_ns[0] = elapsed / bench_n;
+/* numa=1: insert and lookup per variant, from bench_numa_run() */
+static void lkp_bench_show_numa(struct seq_file *m, struct bench_result *res)
+{
+	static const char * const title[] = { "Insert", "Lookup" };
+	unsigned int i;
+	int v, id;
 
-	DECLARE_HASHTABLE(bench_htable, 4);
+	seq_printf(m, "NUMA (ns/op, entries on node %d", res->numa_node);
+	for (v = 0; v < BENCH_NUMA_NR; v++)
+		if (res->numa_cpu[v] >= 0)
+			seq_printf(m, ", %s CPU %d", bench_numa_names[v],
+				   res->numa_cpu[v]);
+	seq_printf(m, "%s):\n", res->numa_cpu[BENCH_NUMA_REMOTE] < 0 ?
+		   ", single node" : "");
 
-	start = ktime_get_ns();
-	for(int i = 0; i < bench_n; i++ ){
-		struct my_entry *he;
-		he = kmalloc(sizeof(*he), GFP_KERNEL);
-		if (!he)
-			return -ENOMEM;
-		//Fill in the value
-		he->value = random[i];
-		
-		hash_add(bench_htable, &he->hnode, he->value);
+	for (i = 0; i < ARRAY_SIZE(title); i++) {
+		seq_printf(m, " %-17s", title[i]);
+		for (v = 0; v < BENCH_NUMA_NR; v++)
+			seq_printf(m, "%11s", bench_numa_names[v]);
+		seq_printf(m, "\n");
+		for (id = 0; id < BENCH_NR; id++) {
+			if (!(res->cfg.structs & BIT(id)))
+				continue;
+			seq_printf(m, "  %-16s", bench_structs[id].label);
+			for (v = 0; v < BENCH_NUMA_NR; v++) {
+				if (res->numa_cpu[v] < 0)
+					seq_printf(m, "%11s", "-");
+				else
+					seq_printf(m, "%11llu",
+						   res->numa_ns[v][i][id]);
+			}
+			seq_printf(m, "\n");
+		}
 	}
-	elapsed = ktime_get_ns() - start;
-	bench_insert_ns[1] = elapsed / bench_n;
+}
 
-	struct rb_root bench_tree = RB_ROOT;
+static void lkp_bench_show_mem(struct seq_file *m, struct bench_result *res)
+{
+	struct bench_mem *mem;
+	u64 total;
+	int id;
 
-	start = ktime_get_ns();
-	for(int i = 0; i < bench_n; i++ ){
-		struct my_entry *re;
-		re = kmalloc(sizeof(*re), GFP_KERNEL);
-		if (!re)
-			return -ENOMEM;
-		//Fill in the value
-		re->value = random[i];
-		
-		RB_CLEAR_NODE(&re->node);
-		insert_rbtree(&bench_tree, re);
+	seq_printf(m, "Memory (bytes, N=%d, entry=%zu bytes requested):\n",
+		   res->cfg.n, sizeof(struct my_entry));
+	seq_printf(m, "  %-16s%12s%12s%12s%12s%12s\n", "", "total",
+		   "per entry", "entries", "nodes", "slack");
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BIT(id))) {
+			seq_printf(m, "  %-16s%12s%12s%12s%12s%12s\n",
+				   bench_structs[id].label, "-", "-", "-", "-", "-");
+			continue;
+		}
+		mem = &res->mem[id];
+		total = mem->entries + mem->nodes;
+		seq_printf(m, "  %-16s%12llu", bench_structs[id].label, total);
+		lkp_bench_show_ratio(m, 12, total, res->cfg.n);
+		seq_printf(m, "%12llu%12llu%12llu\n", mem->entries, mem->nodes,
+			   mem->slack);
 	}
-	elapsed = ktime_get_ns() - start;
-	bench_insert_ns[2] = elapsed / bench_n;
+	if (res->cfg.structs & BIT(BENCH_MAPLE))
+		seq_printf(m, "  (maple interior nodes estimated, a lower bound)\n");
+}
 
-	DEFINE_XARRAY(bench_xarray);
-	unsigned long bench_xa_index = 0;
+/*
+ * Sorted bulk loads next to one-by-one inserts of the same entries.  The
+ * rbtree bulk load builds the augmented tree, so its incremental column
+ * is the augmented insert (os_insert_ns), not the plain one.
+ */
+static void lkp_bench_show_bulk(struct seq_file *m, struct bench_result *res)
+{
+	u64 incr;
+	int id;
 
-	start = ktime_get_ns();
-	for(int i = 0; i < bench_n; i++ ){
-		struct my_entry *xe;
-		xe = kmalloc(sizeof(*xe), GFP_KERNEL);
-		if (!xe)
-			return -ENOMEM;
-		//Fill in the value
-		xe->value = random[i];
+	seq_printf(m, "Bulk load (ns/op):\n");
+	seq_printf(m, "  %-16s%12s%12s%10s%10s\n", "", "incremental", "bulk",
+		   "sort", "build");
+	for (id = 0; id < BENCH_NR; id++) {
+		if (!(res->cfg.structs & BENCH_BULK_STRUCTS & BIT(id)))
+			continue;
+		incr = id == BENCH_RBTREE ? res->os_insert_ns :
+					    res->insert_only_ns[id];
+		seq_printf(m, "  %-16s%12llu%12llu", bench_structs[id].label,
+			   incr, res->bulk_ns[id]);
+		if (id == BENCH_RBTREE)
+			seq_printf(m, "%10llu%10llu\n", res->bulk_sort_ns,
+				   res->bulk_build_ns);
+		else
+			seq_printf(m, "%10s%10s\n", "-", "-");
+	}
+}
 
+/* One row per structure, "-" for those not in the run */
+static void lkp_bench_show_rows(struct seq_file *m, struct bench_result *res,
+				const char *title, const u64 *ns)
+{
+	int id;
 
-		xa_store(&bench_xarray, bench_xa_index++, xe, GFP_KERNEL);
+	if (title)
+		seq_printf(m, "%s:\n", title);
+	for (id = 0; id < BENCH_NR; id++) {
+		seq_printf(m, "  %-16s", bench_structs[id].label);
+		if (res->cfg.structs & BIT(id))
+			seq_printf(m, "%llu\n", ns[id]);
+		else
+			seq_printf(m, "-\n");
 	}
-	elapsed = ktime_get_ns() - start;
-	bench_insert_ns[3] = elapsed / bench_n;
-
+}
 
+static int lkp_bench_show(struct seq_file *m, void *v)
+{
+	struct bench_result *res = &bench_res;
+	int id;
 
-	start = ktime_get_ns();
-	for(int i = 0; i < bench_n; i++ ){
-		struct my_entry *e;
-		//bool found;
-		int target = random[i];
-		list_for_each_entry(e, &bench_list, list) {
-			if (e->value == target) {
-				//found = true;
-				break;
-			}
-		}
+	mutex_lock(&bench_lock);
+	seq_printf(m, "LKP Data Structure Benchmark (N=%d, trials=%d, alloc=%s)%s\n",
+		   res->cfg.n, res->cfg.trials, bench_alloc_names[res->cfg.alloc],
+		   bench_state == BENCH_RUNNING ? " - run in progress" : "");
+	lkp_bench_show_keys(m, &res->cfg);
+	seq_printf(m, "Status: %s", bench_state_names[bench_state]);
+	if (bench_state == BENCH_RUNNING)
+		seq_printf(m, " (%d%% of N=%d)", bench_units ?
+			   min(99, atomic_read(&bench_units_done) * 100 /
+				   bench_units) : 0,
+			   bench_next.n);
+	else if (bench_state == BENCH_FAILED)
+		seq_printf(m, " (error %d)", res->err);
+	seq_printf(m, "\n");
+	seq_printf(m, "=======================================\n");
 
+	if (res->cfg.threads) {
+		lkp_bench_show_mt(m, res);
+		goto out;
 	}
-	elapsed = ktime_get_ns() - start;
-	bench_lookup_ns[0] = elapsed / bench_n;
-
-
-	start = ktime_get_ns();
-	
-	for (int i = 0; i < bench_n; i++) {
-		struct my_entry *he;
-		int target = random[i];
 
-		hash_for_each_possible(bench_htable, he, hnode, target) {
-			if (he->value == target)
-				break;
+	lkp_bench_show_rows(m, res, "Insert (ns/op)", res->insert_ns);
+	seq_printf(m, "\n");
+	seq_printf(m, "Lookup (ns/op):\n");
+	for (id = 0; id < BENCH_NR; id++) {
+		seq_printf(m, "  %-16s", bench_structs[id].label);
+		if (!(res->cfg.structs & BIT(id))) {
+			seq_printf(m, "-\n");
+			continue;
 		}
+		seq_printf(m, "%llu", res->lookup_ns[id]);
+		if (id == BENCH_HASH)
+			seq_printf(m, "  (buckets=%u load=%lu.%02lu longest chain=%u)",
+				   res->hash_buckets, res->hash_load / 100,
+				   res->hash_load % 100, res->hash_chain);
+		seq_printf(m, "\n");
 	}
-	elapsed = ktime_get_ns() - start;
-	bench_lookup_ns[1] = elapsed / bench_n;
-
-	start = ktime_get_ns();
+	seq_printf(m, "\n");
+	lkp_bench_show_rows(m, res, "Lookup miss (ns/op)", res->miss_ns);
+	seq_printf(m, "\n");
+	seq_printf(m, "Lookup mixed (ns/op, %d%% hits):\n", res->cfg.hit_pct);
+	lkp_bench_show_rows(m, res, NULL, res->mixed_ns);
+	seq_printf(m, "\n");
+	lkp_bench_show_rows(m, res, "Delete (ns/op, random order)", res->delete_ns);
+	seq_printf(m, "\n");
+	lkp_bench_show_rows(m, res, "Teardown (ns/op, whole structure)",
+			    res->teardown_ns);
+	seq_printf(m, "\n");
+	lkp_bench_show_rows(m, res, "Insert pre-allocated (ns/op)",
+			    res->insert_only_ns);
+	seq_printf(m, "\n");
+	seq_printf(m, "Allocate only (ns/op):\n");
+	seq_printf(m, "  %-16s%llu\n", "Entry:", res->alloc_ns);
+	seq_printf(m, "\n");
+	lkp_bench_show_mem(m, res);
+	if (res->cfg.nr_ranges) {
+		seq_printf(m, "\n");
+		lkp_bench_show_range(m, res);
+	}
+	if (res->cfg.structs & BIT(BENCH_RBTREE)) {
+		seq_printf(m, "\n");
+		lkp_bench_show_os(m, res);
+	}
+	if (res->cfg.structs & BENCH_BULK_STRUCTS) {
+		seq_printf(m, "\n");
+		lkp_bench_show_bulk(m, res);
+	}
+	if (res->cfg.trials > 1) {
+		seq_printf(m, "\n");
+		lkp_bench_show_stats(m, res);
+	}
+	if (res->cfg.numa && !res->err) {
+		seq_printf(m, "\n");
+		lkp_bench_show_numa(m, res);
+	}
+	if (res->pmu_avail) {
+		seq_printf(m, "\n");
+		lkp_bench_show_pmu(m, res);
+	}
+	if (res->cfg.split) {
+		seq_printf(m, "\n");
+		lkp_bench_show_split(m, res);
+	}
+	if (res->cfg.structs & (BIT(BENCH_XARRAY) | BIT(BENCH_XAVAL))) {
+		seq_printf(m, "\n");
+		lkp_bench_show_xa_mem(m, res);
+	}
+	if (res->cfg.sample) {
+		seq_printf(m, "\n");
+		lkp_bench_show_hist(m, res);
+	}
+out:
+	mutex_unlock(&bench_lock);
+	return 0;
+}
 
-	for (int i = 0; i < bench_n; i++) {
-		struct rb_node *node = bench_tree.rb_node;
-		int target = random[i];
+static int lkp_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lkp_bench_show, NULL);
+}
 
-		while (node) {
-			struct my_entry *e = rb_entry(node, struct my_entry, node);
+/* "16,256,4096": up to BENCH_RANGE_MAX positive widths */
+static int bench_parse_ranges(char *list, struct bench_cfg *cfg)
+{
+	char *tok;
+	int err;
 
-			if (target < e->value)
-				node = node->rb_left;
-			else if (target > e->value)
-				node = node->rb_right;
-			else
-				break;   // found
-		}
+	cfg->nr_ranges = 0;
+	while ((tok = strsep(&list, ",")) != NULL) {
+		if (!*tok)
+			continue;
+		if (cfg->nr_ranges == BENCH_RANGE_MAX)
+			return -E2BIG;
+		err = kstrtoint(tok, 0, &cfg->ranges[cfg->nr_ranges]);
+		if (err)
+			return err;
+		if (cfg->ranges[cfg->nr_ranges++] <= 0)
+			return -EINVAL;
 	}
+	return 0;
+}
 
-	elapsed = ktime_get_ns() - start;
-	bench_lookup_ns[2] = elapsed / bench_n;
-
+/* structs=hash,rbtree → bitmask of BENCH_* ("all" selects everything) */
+static int bench_parse_structs(char *list, unsigned long *mask)
+{
+	char *name;
+	int id;
 
+	*mask = 0;
+	while ((name = strsep(&list, ",")) != NULL) {
+		if (!*name)
+			continue;
+		if (!strcmp(name, "all")) {
+			*mask |= BENCH_ALL;
+			continue;
+		}
+		for (id = 0; id < BENCH_NR; id++)
+			if (!strcmp(name, bench_structs[id].name))
+				break;
+		if (id == BENCH_NR)
+			return -EINVAL;
+		if (!(BENCH_ALL & BIT(id)))
+			return -EOPNOTSUPP;
+		*mask |= BIT(id);
+	}
+	return *mask ? 0 : -EINVAL;
+}
 
-	start = ktime_get_ns();
+/* sync=rwlock,rcu → bitmask of BENCH_SYNC_* */
+static int bench_parse_sync(char *list, unsigned long *mask)
+{
+	char *name;
+	int sync;
 
-	for (int i = 0; i < bench_n; i++) {
-		xa_load(&bench_xarray, i);
+	*mask = 0;
+	while ((name = strsep(&list, ",")) != NULL) {
+		if (!*name)
+			continue;
+		sync = match_string(bench_sync_names, BENCH_SYNC_NR, name);
+		if (sync < 0)
+			return sync;
+		*mask |= BIT(sync);
 	}
+	return *mask ? 0 : -EINVAL;
+}
 
-	elapsed = ktime_get_ns() - start;
-	bench_lookup_ns[3] = elapsed / bench_n;
+/* "1", "0.9" or "1.25" -> 100, 90, 125 */
+static int bench_parse_hundredths(char *val, int *res)
+{
+	char *frac = strchr(val, '.');
+	int whole, part = 0, err;
 
-	//Must Free All!
-	//Free the list 
-	struct my_entry *list_entry;
-	struct my_entry *list_tmp;
-	list_for_each_entry_safe(list_entry, list_tmp, &bench_list, list) {
-		list_del(&list_entry->list);
-		kfree(list_entry);
+	if (frac) {
+		*frac++ = '\0';
+		if (!*frac || strlen(frac) > 2)
+			return -EINVAL;
+		err = kstrtoint(frac, 10, &part);
+		if (err || part < 0)
+			return -EINVAL;
+		if (strlen(frac) == 1)
+			part *= 10;
 	}
+	err = kstrtoint(val, 10, &whole);
+	if (err || whole < 0 || whole > 10)
+		return -EINVAL;
+	*res = whole * 100 + part;
+	return 0;
+}
 
-	//Free the hashtable
-	struct my_entry *he;
-	struct hlist_node *tmp_hnode;
-	int bkt;
+/* Load-time settings, overridden by the options of a "run" command */
+static void bench_cfg_defaults(struct bench_cfg *cfg)
+{
+	*cfg = (struct bench_cfg) {
+		.n         = bench_size,
+		.trials    = 1,
+		.structs   = BENCH_ALL,
+		.write_pct = 10,
+		.sync      = BIT(BENCH_SYNC_RWLOCK),
+		.sample    = bench_sample,
+		.seed      = bench_seed,
+		.theta     = 99,
+		.hot_ops   = 90,
+		.hot_keys  = 10,
+		.cluster   = 64,
+		.hit_pct   = 50,
+		.pmu       = true,
+		.range_q   = 256,
+		.os_q      = 256,
+		.cpu       = -1,
+		.node      = NUMA_NO_NODE,
+		.alloc_node = NUMA_NO_NODE,
+	};
+}
 
-	hash_for_each_safe(bench_htable, bkt, tmp_hnode, he, hnode) {
-		hash_del(&he->hnode);
-		kfree(he);
-	}
+/* Parses the key=value options following "run" */
+static int bench_parse_opts(char *opts, struct bench_cfg *cfg)
+{
+	char *tok, *val;
+	int err;
 
-	//Free the rb tree
-	struct rb_node *node;
-	for (node = rb_first(&bench_tree); node; ) {
-		struct my_entry *re = rb_entry(node, struct my_entry, node);
-		node = rb_next(node);
-		rb_erase(&re->node, &bench_tree);
-		kfree(re);
-	}
+	while ((tok = strsep(&opts, " \t\n")) != NULL) {
+		if (!*tok)
+			continue;
 
-	unsigned long index_delete;
-	struct my_entry *xe;
+		val = strchr(tok, '=');
+		if (!val)
+			return -EINVAL;
+		*val++ = '\0';
 
-	xa_for_each(&bench_xarray, index_delete, xe) {
-		xa_erase(&bench_xarray, index_delete);
-		kfree(xe);
+		if (!strcmp(tok, "n"))
+			err = kstrtoint(val, 0, &cfg->n);
+		else if (!strcmp(tok, "trials"))
+			err = kstrtoint(val, 0, &cfg->trials);
+		else if (!strcmp(tok, "structs"))
+			err = bench_parse_structs(val, &cfg->structs);
+		else if (!strcmp(tok, "threads"))
+			err = kstrtoint(val, 0, &cfg->threads);
+		else if (!strcmp(tok, "ops"))
+			err = kstrtoint(val, 0, &cfg->ops);
+		else if (!strcmp(tok, "write_pct"))
+			err = kstrtoint(val, 0, &cfg->write_pct);
+		else if (!strcmp(tok, "sync"))
+			err = bench_parse_sync(val, &cfg->sync);
+		else if (!strcmp(tok, "sample"))
+			err = kstrtoint(val, 0, &cfg->sample);
+		else if (!strcmp(tok, "alloc")) {
+			err = match_string(bench_alloc_names, BENCH_ALLOC_NR, val);
+			if (err >= 0) {
+				cfg->alloc = err;
+				err = 0;
+			}
+		} else if (!strcmp(tok, "key_dist")) {
+			err = match_string(bench_key_dist_names, BENCH_KEYS_NR, val);
+			if (err >= 0) {
+				cfg->key_dist = err;
+				err = 0;
+			}
+		} else if (!strcmp(tok, "seed"))
+			err = kstrtou64(val, 0, &cfg->seed);
+		else if (!strcmp(tok, "theta"))
+			err = bench_parse_hundredths(val, &cfg->theta);
+		else if (!strcmp(tok, "hot_ops"))
+			err = kstrtoint(val, 0, &cfg->hot_ops);
+		else if (!strcmp(tok, "hot_keys"))
+			err = kstrtoint(val, 0, &cfg->hot_keys);
+		else if (!strcmp(tok, "cluster"))
+			err = kstrtoint(val, 0, &cfg->cluster);
+		else if (!strcmp(tok, "hit_pct"))
+			err = kstrtoint(val, 0, &cfg->hit_pct);
+		else if (!strcmp(tok, "pmu"))
+			err = kstrtobool(val, &cfg->pmu);
+		else if (!strcmp(tok, "split"))
+			err = kstrtobool(val, &cfg->split);
+		else if (!strcmp(tok, "ranges"))
+			err = bench_parse_ranges(val, cfg);
+		else if (!strcmp(tok, "range_q"))
+			err = kstrtoint(val, 0, &cfg->range_q);
+		else if (!strcmp(tok, "os_q"))
+			err = kstrtoint(val, 0, &cfg->os_q);
+		else if (!strcmp(tok, "warmup"))
+			err = kstrtoint(val, 0, &cfg->warmup);
+		else if (!strcmp(tok, "cpu"))
+			err = kstrtoint(val, 0, &cfg->cpu);
+		else if (!strcmp(tok, "nopreempt"))
+			err = kstrtobool(val, &cfg->nopreempt);
+		else if (!strcmp(tok, "shuffle"))
+			err = kstrtobool(val, &cfg->shuffle);
+		else if (!strcmp(tok, "numa"))
+			err = kstrtobool(val, &cfg->numa);
+		else if (!strcmp(tok, "node"))
+			err = kstrtoint(val, 0, &cfg->node);
+		else
+			err = -EINVAL;
+		if (err)
+			return err;
 	}
-	xa_destroy(&bench_xarray);
 
+	if (cfg->n <= 0 || cfg->n > BENCH_N_MAX ||
+	    (cfg->nopreempt && cfg->n > BENCH_NOPREEMPT_MAX) ||
+	    cfg->trials <= 0 || cfg->trials > BENCH_TRIALS_MAX ||
+	    cfg->warmup < 0 || cfg->warmup > BENCH_TRIALS_MAX ||
+	    cfg->cpu < -1 || cfg->cpu >= (int)nr_cpu_ids || cfg->threads < 0 ||
+	    cfg->node < -1 || cfg->node >= MAX_NUMNODES ||
+	    (cfg->numa && cfg->threads) ||
+	    cfg->ops < 0 || cfg->ops > BENCH_N_MAX ||
+	    cfg->write_pct < 0 || cfg->write_pct > 100)
+		return -EINVAL;
+	/* sampling uses a mask, keep it a power of two */
+	if (cfg->sample < 0 || (cfg->sample && !is_power_of_2(cfg->sample)))
+		return -EINVAL;
+	/* theta 0 degenerates to uniform lookups */
+	if (cfg->theta > 1000 ||
+	    cfg->hot_ops < 0 || cfg->hot_ops > 100 ||
+	    cfg->hot_keys <= 0 || cfg->hot_keys > 100 ||
+	    cfg->cluster <= 0 || cfg->cluster > 1000000 ||
+	    cfg->hit_pct < 0 || cfg->hit_pct > 100 || cfg->range_q <= 0 ||
+	    cfg->os_q <= 0)
+		return -EINVAL;
+	return 0;
+}
 
+/*
+ * Accepts "run [n=N] [trials=T] [structs=list,hash,rbtree,xarray]
+ * [threads=MAX [ops=OPS] [write_pct=P] [sync=rwlock,rcu]]".  Unset
+ * options default to bench_size, one trial and all structures;
+ * threads= switches to the concurrent benchmark with OPS (default N)
+ * operations per thread of which P percent (default 10) are inserts,
+ * once per listed synchronization scheme (default rwlock).  A
+ * reader-heavy comparison is e.g. "write_pct=5 sync=rwlock,rcu".
+ * Returns -EBUSY while a previous run is still in flight.
+ */
+static ssize_t lkp_bench_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	struct bench_cfg cfg;
+	char *buf, *p, *cmd;
+	int err;
 
+	if (count > PAGE_SIZE)
+		return -EINVAL;
 
-	kfree(random);
+	buf = memdup_user_nul(ubuf, count);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
 
+	p = strim(buf);
+	cmd = strsep(&p, " \t");
+	if (strcmp(cmd, "run")) {
+		err = -EINVAL;
+		goto out;
+	}
 
-	return 0;
+	bench_cfg_defaults(&cfg);
+	err = bench_parse_opts(p, &cfg);
+	if (!err)
+		err = bench_start(&cfg);
+out:
+	kfree(buf);
+	return err ? err : (ssize_t)count;
 }
 
+static const struct proc_ops lkp_bench_ops = {
+	.proc_open    = lkp_bench_open,
+	.proc_read    = seq_read,
+	.proc_write   = lkp_bench_write,
+	.proc_lseek   = seq_lseek,
+	.proc_release = single_release,
+};
+
 /* ===================================================================
  * Cleanup helpers
  * =================================================================== */
 
 /*
- * TODO: Implement free_all()
- *
- * Since each my_entry is inserted into ALL four structures, you must
- * remove it from each structure but only call kfree() ONCE per entry.
- *
- * Recommended approach: iterate one structure (e.g., linked list) with
- * the _safe variant, remove from list, hash, rbtree, and xarray, then
- * kfree the entry. Alternatively, iterate xarray with xa_for_each(),
- * and for each entry: list_del, hash_del, rb_erase, xa_erase, kfree.
+ * Frees every entry at unload.  Erasing one entry at a time would cost
+ * a full rb_erase() rebalance, an xa_erase() and a kfree_rcu() callback
+ * each, which made rmmod slow with millions of entries.  Instead every
+ * structure is emptied in one step (detach_all()), one grace period
+ * covers all the entries, and the rbtree is freed in postorder with
+ * kmem_cache_free_bulk().
  */
 static void free_all(void)
 {
-	/*Going to use a similar structure iterating over the list and deleting each entry one by one*/
-
-	//Create a position entry
-	struct my_entry *e;
-	struct my_entry *tmp; //This becomes the next node we are going to, so we load e
-	// save e->next to tmp and then load that after we free e so its safe
+	u64 start = ktime_get_ns();
+	struct rb_root root;
+	unsigned long nr;
 
-	/**
-	 * We need to use
-	 * list_for_each_entry_safe - iterate over list of given type safe against removal of list entry
-	 * @pos:	the type * to use as a loop cursor.
-	 * @n:		another type * to use as temporary storage
-	 * @head:	the head for your list.
-	 * @member:	the name of the list_head within the struct.
-	 */
-	// IMPORTANT this only returns nodes that are not sentinel head node. This is good beaxcuse the ssentinel
-	// is not wrapped in an entry
-
-
-	xa_destroy(&my_xarray);
-	list_for_each_entry_safe(e, tmp, &my_list, list) {
-		// delete from each structure and then free
-
-		/**
-		 * list_del - deletes entry from list.
-		 * @entry: the element to delete from the list.
-		 * Note: list_empty() on entry does not return true after this, the entry is
-		 * in an undefined state.
-		 */
-		list_del(&e->list);
-		hash_del(&e->hnode);
-		rb_erase(&e->node, &my_tree);
-		kfree(e);
+	mutex_lock(&my_lock);
+	root = detach_all();
+	mutex_unlock(&my_lock);
 
-	}
+	synchronize_rcu();
+	nr = lkp_free_tree(&root);
+	if (nr)
+		pr_info("free_all: freed %lu entries in %llu us\n", nr,
+			div_u64(ktime_get_ns() - start, NSEC_PER_USEC));
 }
 
 /* ===================================================================
@@ -550,46 +6654,158 @@ static void free_all(void)
 
 static int __init lkp_ds_init(void)
 {
-	int err;
+	struct bench_cfg cfg;
+	int i, err;
 
 	if (!int_str) {
 		pr_err("missing 'int_str' parameter\n");
 		return -EINVAL;
 	}
 
+	if (bench_size > BENCH_N_MAX) {
+		pr_err("bench_size=%d is above %d\n", bench_size, BENCH_N_MAX);
+		return -EINVAL;
+	}
+
+	if (bench_sample < 0 || (bench_sample && !is_power_of_2(bench_sample))) {
+		pr_err("invalid bench_sample=%d\n", bench_sample);
+		return -EINVAL;
+	}
+
+	err = lkp_ht_init(&my_htable, hash_bits, hash_max_load);
+	if (err) {
+		pr_err("invalid hash_bits=%d\n", hash_bits);
+		return err;
+	}
+
+	if (LKP_HAVE_BTREE) {
+		err = btree_init64(&my_btree);
+		if (err) {
+			lkp_ht_destroy(&my_htable);
+			return err;
+		}
+	}
+
+	/* Bulk loads allocate from the cache, so create it before parsing */
+	my_entry_cache = KMEM_CACHE(my_entry, 0);
+	if (!my_entry_cache) {
+		err = -ENOMEM;
+		goto err_btree;
+	}
+
+	lkp_reap_wq = alloc_workqueue("lkp_reap", WQ_UNBOUND, 0);
+	if (!lkp_reap_wq) {
+		err = -ENOMEM;
+		goto err_cache;
+	}
+
 	err = parse_params();
 	if (err) {
 		pr_err("failed to parse int_str\n");
-		return err;
+		goto err_free;
 	}
 
-	proc_ds = proc_create("lkp_ds", 0444, NULL, &lkp_ds_ops);
+	proc_ds = lkp_ds_proc_create("lkp_ds", LKP_DS_ALL);
 	if (!proc_ds) {
 		pr_err("failed to create /proc/lkp_ds\n");
-		free_all();
-		return -ENOMEM;
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	for (i = 0; i < LKP_DS_END; i++) {
+		if (!(LKP_DS_ALL & BIT(i)))
+			continue;
+		proc_ds_sect[i] = lkp_ds_proc_create(lkp_ds_sects[i].proc, BIT(i));
+		if (!proc_ds_sect[i]) {
+			pr_err("failed to create /proc/%s\n", lkp_ds_sects[i].proc);
+			err = -ENOMEM;
+			goto err_proc_sect;
+		}
 	}
 
-	proc_bench = proc_create("lkp_ds_bench", 0444, NULL, &lkp_bench_ops);
+	proc_bench = proc_create("lkp_ds_bench", 0644, NULL, &lkp_bench_ops);
 	if (!proc_bench) {
 		pr_err("failed to create /proc/lkp_ds_bench\n");
-		proc_remove(proc_ds);
-		free_all();
-		return -ENOMEM;
+		err = -ENOMEM;
+		goto err_proc_sect;
+	}
+
+	proc_ctl = proc_create("lkp_ds_ctl", 0644, NULL, &lkp_ctl_ops);
+	if (!proc_ctl) {
+		pr_err("failed to create /proc/lkp_ds_ctl\n");
+		err = -ENOMEM;
+		goto err_proc_bench;
+	}
+
+	proc_load = proc_create("lkp_ds_load", 0200, NULL, &lkp_load_ops);
+	if (!proc_load) {
+		pr_err("failed to create /proc/lkp_ds_load\n");
+		err = -ENOMEM;
+		goto err_proc_ctl;
+	}
+
+	err = misc_register(&lkp_snap_dev);
+	if (err) {
+		pr_err("failed to register /dev/lkp_ds\n");
+		goto err_proc_load;
 	}
 
-	run_benchmark();
+	/* The load-time run goes to the background, poll /proc/lkp_ds_bench */
+	bench_cfg_defaults(&cfg);
+	if (bench_size > 0)
+		bench_start(&cfg);
 
 	pr_info("module loaded (int_str=%s, bench_size=%d)\n",
 		int_str, bench_size);
 	return 0;
+
+err_proc_load:
+	proc_remove(proc_load);
+err_proc_ctl:
+	proc_remove(proc_ctl);
+err_proc_bench:
+	proc_remove(proc_bench);
+err_proc_sect:
+	while (i--)
+		proc_remove(proc_ds_sect[i]);
+	proc_remove(proc_ds);
+err_free:
+	free_all();
+	destroy_workqueue(lkp_reap_wq);
+err_cache:
+	/* waits for the kfree_rcu() of entries from the cache */
+	kmem_cache_destroy(my_entry_cache);
+err_btree:
+	if (LKP_HAVE_BTREE)
+		btree_destroy64(&my_btree);
+	lkp_ht_destroy(&my_htable);
+	return err;
 }
 
 static void __exit lkp_ds_exit(void)
 {
+	int i;
+
+	/* .owner keeps us loaded while a snapshot is open or mapped */
+	misc_deregister(&lkp_snap_dev);
+	if (lkp_snap_cur)
+		kref_put(&lkp_snap_cur->ref, lkp_snap_release);
+	proc_remove(proc_load);
+	proc_remove(proc_ctl);
 	proc_remove(proc_bench);
+	for (i = 0; i < LKP_DS_END; i++)
+		proc_remove(proc_ds_sect[i]);
 	proc_remove(proc_ds);
+	/* A run in flight stops at its next structure */
+	WRITE_ONCE(bench_stop, true);
+	cancel_work_sync(&bench_work);
 	free_all();
+	/* finishes any "clear" still freeing in the background */
+	destroy_workqueue(lkp_reap_wq);
+	kmem_cache_destroy(my_entry_cache);
+	if (LKP_HAVE_BTREE)
+		btree_destroy64(&my_btree);
+	lkp_ht_destroy(&my_htable);
 	pr_info("module unloaded\n");
 }
 
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * lkp_ds_read.c - Userspace reader for the /dev/lkp_ds snapshot
+ *
+ * Usage: ./lkp_ds_read                 header summary
+ *        ./lkp_ds_read sorted          values in rbtree order, one per line
+ *        ./lkp_ds_read insert          values in insertion order
+ *        ./lkp_ds_read bench [iters]   export throughput, mmap vs /proc text
+ *
+ * The bench mode exports both orders "iters" times each way: mmap() of
+ * /dev/lkp_ds, and read() plus strtol() of /proc/lkp_ds_rbtree and
+ * /proc/lkp_ds_xarray.  Both sum every value so neither path can skip
+ * work, and the sums must match unless lkp_ds changed mid-run.
+ */
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lkp_ds_snap.h"
+
+#define SNAP_DEV	"/dev/lkp_ds"
+
+struct snap {
+	void *map;
+	size_t len;
+	uint32_t nr;
+	uint64_t gen;
+	const int32_t *sorted, *insert;
+};
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int snap_open(struct snap *s)
+{
+	struct lkp_snap_hdr hdr;
+	int fd, err = 0;
+
+	fd = open(SNAP_DEV, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	/* the mapping size is in the header, so read that first */
+	if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+		err = -EIO;
+		goto out;
+	}
+	if (le32toh(hdr.magic) != LKP_SNAP_MAGIC ||
+	    le32toh(hdr.version) != LKP_SNAP_VERSION) {
+		err = -EPROTO;
+		goto out;
+	}
+
+	s->len = le64toh(hdr.size);
+	s->nr = le32toh(hdr.nr);
+	s->gen = le64toh(hdr.gen);
+	s->map = mmap(NULL, s->len, PROT_READ, MAP_SHARED, fd, 0);
+	if (s->map == MAP_FAILED) {
+		err = -errno;
+		goto out;
+	}
+	/* values are stored little-endian; le32toh() below is a no-op on x86 */
+	s->sorted = (const int32_t *)((char *)s->map + le64toh(hdr.sorted_off));
+	s->insert = (const int32_t *)((char *)s->map + le64toh(hdr.insert_off));
+out:
+	/* the mapping keeps the snapshot alive on its own */
+	close(fd);
+	return err;
+}
+
+static void snap_close(struct snap *s)
+{
+	munmap(s->map, s->len);
+}
+
+static int64_t sum_le32(const int32_t *v, uint32_t nr)
+{
+	int64_t sum = 0;
+	uint32_t i;
+
+	for (i = 0; i < nr; i++)
+		sum += (int32_t)le32toh((uint32_t)v[i]);
+	return sum;
+}
+
+/*
+ * Reads a /proc/lkp_ds_<struct> line ("Red-Black tree: 1, 2, 3,") and
+ * sums its values.  Returns the number of values, or -errno.
+ */
+static long text_sum(const char *path, char **buf, size_t *cap,
+		     size_t *bytes, int64_t *sum)
+{
+	size_t len = 0;
+	ssize_t ret;
+	long nr = 0;
+	char *p, *end;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	for (;;) {
+		if (*cap - len < 65536) {
+			*cap = *cap ? *cap * 2 : 1 << 20;
+			*buf = realloc(*buf, *cap);
+			if (!*buf) {
+				close(fd);
+				return -ENOMEM;
+			}
+		}
+		ret = read(fd, *buf + len, *cap - len - 1);
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+	close(fd);
+	if (ret < 0)
+		return -errno;
+	(*buf)[len] = '\0';
+	*bytes += len;
+
+	p = strchr(*buf, ':');
+	if (!p)
+		return -EPROTO;
+	for (p++;; p = end + 1) {
+		long v = strtol(p, &end, 10);
+
+		if (end == p)
+			break;
+		*sum += v;
+		nr++;
+		if (*end != ',')
+			break;
+	}
+	return nr;
+}
+
+static int bench(int iters)
+{
+	int64_t mm_sum = 0, txt_sum = 0;
+	size_t cap = 0, txt_bytes = 0;
+	double t0, first, mm, txt;
+	char *buf = NULL;
+	uint32_t nr = 0;
+	struct snap s;
+	long ret;
+	int i, err;
+
+	/* the first open after a change pays for building the snapshot */
+	t0 = now_sec();
+	err = snap_open(&s);
+	if (err)
+		goto fail;
+	first = now_sec() - t0;
+	snap_close(&s);
+
+	t0 = now_sec();
+	for (i = 0; i < iters; i++) {
+		err = snap_open(&s);
+		if (err)
+			goto fail;
+		nr = s.nr;
+		mm_sum += sum_le32(s.sorted, s.nr) + sum_le32(s.insert, s.nr);
+		snap_close(&s);
+	}
+	mm = (now_sec() - t0) / iters;
+
+	t0 = now_sec();
+	for (i = 0; i < iters; i++) {
+		ret = text_sum("/proc/lkp_ds_rbtree", &buf, &cap, &txt_bytes,
+			       &txt_sum);
+		if (ret >= 0)
+			ret = text_sum("/proc/lkp_ds_xarray", &buf, &cap,
+				       &txt_bytes, &txt_sum);
+		if (ret < 0) {
+			err = ret;
+			goto fail;
+		}
+	}
+	txt = (now_sec() - t0) / iters;
+	free(buf);
+
+	printf("values per export: %u x 2 orders, %d iterations\n", nr, iters);
+	printf("%-16s %12s %14s %12s\n", "path", "us/export",
+	       "Mvalues/s", "MB/s");
+	printf("%-16s %12.1f %14s %12s\n", "mmap (build)", first * 1e6,
+	       "-", "-");
+	printf("%-16s %12.1f %14.1f %12.1f\n", "mmap", mm * 1e6,
+	       2.0 * nr / mm / 1e6, 8.0 * nr / mm / 1e6);
+	printf("%-16s %12.1f %14.1f %12.1f\n", "proc text", txt * 1e6,
+	       2.0 * nr / txt / 1e6, (double)txt_bytes / iters / txt / 1e6);
+	printf("speedup: %.1fx\n", txt / mm);
+	if (mm_sum != txt_sum)
+		fprintf(stderr, "warning: sums differ, lkp_ds changed during the run\n");
+	return 0;
+
+fail:
+	free(buf);
+	fprintf(stderr, "bench: %s\n", strerror(-err));
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	const int32_t *v;
+	struct snap s;
+	uint32_t i;
+	int err;
+
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		return bench(argc > 2 ? atoi(argv[2]) ?: 1 : 100);
+
+	err = snap_open(&s);
+	if (err) {
+		fprintf(stderr, "%s: %s\n", SNAP_DEV, strerror(-err));
+		return 1;
+	}
+
+	if (argc == 1) {
+		printf("version %u, generation %llu, %u values, %zu bytes\n",
+		       LKP_SNAP_VERSION, (unsigned long long)s.gen, s.nr, s.len);
+	} else if (!strcmp(argv[1], "sorted") || !strcmp(argv[1], "insert")) {
+		v = argv[1][0] == 's' ? s.sorted : s.insert;
+		for (i = 0; i < s.nr; i++)
+			printf("%d\n", (int32_t)le32toh((uint32_t)v[i]));
+	} else {
+		fprintf(stderr, "usage: %s [sorted|insert|bench [iters]]\n",
+			argv[0]);
+		snap_close(&s);
+		return 1;
+	}
+	snap_close(&s);
+	return 0;
+}
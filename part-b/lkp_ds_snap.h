@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * lkp_ds_snap.h - Layout of the /dev/lkp_ds snapshot
+ *
+ * Shared by lkp_ds.c and the userspace reader lkp_ds_read.c.  A
+ * snapshot is one read-only buffer, mmap()ed or read() from offset 0:
+ *
+ *   struct lkp_snap_hdr
+ *   __le32 sorted[nr]      values in rbtree (ascending) order
+ *   __le32 insert[nr]      values in XArray (insertion) order
+ *
+ * Every field is little-endian.  Readers must check magic and version
+ * and take the array positions from the header rather than assuming
+ * them, so later versions can append fields or arrays.
+ */
+#ifndef LKP_DS_SNAP_H
+#define LKP_DS_SNAP_H
+
+#include <linux/types.h>
+
+#define LKP_SNAP_MAGIC		0x53504b4c	/* "LKPS" */
+#define LKP_SNAP_VERSION	1
+
+struct lkp_snap_hdr {
+	__le32 magic;
+	__le32 version;
+	__le32 hdr_size;		/* sizeof(struct lkp_snap_hdr) */
+	__le32 nr;			/* values in each array */
+	__le64 gen;			/* lkp_ds change count at snapshot time */
+	__le64 sorted_off;		/* byte offsets from the header */
+	__le64 insert_off;
+	__le64 size;			/* header plus arrays, without page padding */
+};
+
+#endif /* LKP_DS_SNAP_H */
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * baseline.cc - std:: container baselines for lkp_ds_user
+ *
+ * run_benchmark() hands over its keys, probes and delete order after
+ * the module's own trials, and the same phases are timed here through
+ * std::unordered_multimap (the hash table's counterpart) and
+ * std::multimap (the rbtree's; libstdc++ implements it as one).  Keys
+ * may repeat, hence the multi- variants; each maps to its position in
+ * keys[] so a delete removes the same element the module's does.
+ * Printed after the report in its format, one row per container.
+ */
+#include <map>
+#include <unordered_map>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+extern "C" {
+
+/* Must match struct bench_probe in lkp_ds.c */
+struct bench_probe {
+	u32 key;
+	u32 idx;
+};
+
+void lkp_user_baseline(int n, int trials, int warmup, int hit_pct,
+		       const u32 *keys, const struct bench_probe *hit,
+		       const struct bench_probe *miss,
+		       const struct bench_probe *mixed,
+		       const u32 *del_order);
+void lkp_user_baseline_show(FILE *out);
+
+}
+
+namespace {
+
+enum { BL_UNORDERED, BL_ORDERED, BL_NR };
+
+const char *const bl_labels[BL_NR] = {
+	"unordered_map:",
+	"map:",
+};
+
+struct bl_result {
+	bool valid;
+	int n, trials, hit_pct;
+	u64 insert_ns[BL_NR];
+	u64 lookup_ns[BL_NR];
+	u64 miss_ns[BL_NR];
+	u64 mixed_ns[BL_NR];
+	u64 delete_ns[BL_NR];
+	u64 teardown_ns[BL_NR];
+};
+
+bl_result bl_res;
+volatile u64 bl_sink;
+
+u64 bl_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+template <typename Map>
+u64 bl_lookup(const Map &map, const struct bench_probe *probe, int n)
+{
+	u64 found = 0;
+
+	for (int i = 0; i < n; i++)
+		found += map.find(probe[i].key) != map.end();
+	return found;
+}
+
+/* One trial: the phases of bench_trial(), in the same order */
+template <typename Map>
+void bl_trial(int id, bool timed, int n, const u32 *keys,
+	      const struct bench_probe *hit, const struct bench_probe *miss,
+	      const struct bench_probe *mixed, const u32 *del_order)
+{
+	bl_result *res = &bl_res;
+	u64 start, sink = 0;
+	Map map;
+	int i;
+
+	start = bl_now();
+	for (i = 0; i < n; i++)
+		map.emplace(keys[i], (u32)i);
+	if (timed)
+		res->insert_ns[id] += (bl_now() - start) / n;
+
+	start = bl_now();
+	sink += bl_lookup(map, hit, n);
+	if (timed)
+		res->lookup_ns[id] += (bl_now() - start) / n;
+
+	start = bl_now();
+	sink += bl_lookup(map, miss, n);
+	if (timed)
+		res->miss_ns[id] += (bl_now() - start) / n;
+
+	start = bl_now();
+	sink += bl_lookup(map, mixed, n);
+	if (timed)
+		res->mixed_ns[id] += (bl_now() - start) / n;
+
+	/* The element inserted from keys[pos], not just any with that key */
+	start = bl_now();
+	for (i = 0; i < n; i++) {
+		u32 pos = del_order[i];
+		auto range = map.equal_range(keys[pos]);
+
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == pos) {
+				map.erase(it);
+				break;
+			}
+		}
+	}
+	if (timed)
+		res->delete_ns[id] += (bl_now() - start) / n;
+	sink += map.size();
+
+	/* Teardown: refill, then destroy everything at once */
+	for (i = 0; i < n; i++)
+		map.emplace(keys[i], (u32)i);
+	start = bl_now();
+	map.clear();
+	if (timed)
+		res->teardown_ns[id] += (bl_now() - start) / n;
+
+	bl_sink += sink;
+}
+
+void bl_show_rows(FILE *out, const char *title, const u64 *ns)
+{
+	if (title)
+		fprintf(out, "%s:\n", title);
+	for (int id = 0; id < BL_NR; id++)
+		fprintf(out, "  %-16s%llu\n", bl_labels[id],
+			(unsigned long long)ns[id]);
+}
+
+} /* namespace */
+
+void lkp_user_baseline(int n, int trials, int warmup, int hit_pct,
+		       const u32 *keys, const struct bench_probe *hit,
+		       const struct bench_probe *miss,
+		       const struct bench_probe *mixed,
+		       const u32 *del_order)
+{
+	bl_result *res = &bl_res;
+
+	*res = bl_result();
+	if (n <= 0 || trials <= 0)
+		return;
+	res->n = n;
+	res->trials = trials;
+	res->hit_pct = hit_pct;
+
+	for (int t = -warmup; t < trials; t++) {
+		bl_trial<std::unordered_multimap<u32, u32>>(BL_UNORDERED, t >= 0,
+				n, keys, hit, miss, mixed, del_order);
+		bl_trial<std::multimap<u32, u32>>(BL_ORDERED, t >= 0,
+				n, keys, hit, miss, mixed, del_order);
+	}
+
+	for (int id = 0; id < BL_NR; id++) {
+		res->insert_ns[id] /= trials;
+		res->lookup_ns[id] /= trials;
+		res->miss_ns[id] /= trials;
+		res->mixed_ns[id] /= trials;
+		res->delete_ns[id] /= trials;
+		res->teardown_ns[id] /= trials;
+	}
+	res->valid = true;
+}
+
+void lkp_user_baseline_show(FILE *out)
+{
+	const bl_result *res = &bl_res;
+	char title[64];
+
+	if (!res->valid)
+		return;
+
+	fprintf(out, "\nstd container baselines, same keys and probes (N=%d, trials=%d)\n",
+		res->n, res->trials);
+	fprintf(out, "=======================================\n");
+	bl_show_rows(out, "Insert (ns/op)", res->insert_ns);
+	fprintf(out, "\n");
+	bl_show_rows(out, "Lookup (ns/op)", res->lookup_ns);
+	fprintf(out, "\n");
+	bl_show_rows(out, "Lookup miss (ns/op)", res->miss_ns);
+	fprintf(out, "\n");
+	snprintf(title, sizeof(title), "Lookup mixed (ns/op, %d%% hits)",
+		 res->hit_pct);
+	bl_show_rows(out, title, res->mixed_ns);
+	fprintf(out, "\n");
+	bl_show_rows(out, "Delete (ns/op, random order)", res->delete_ns);
+	fprintf(out, "\n");
+	bl_show_rows(out, "Teardown (ns/op, whole structure)", res->teardown_ns);
+}
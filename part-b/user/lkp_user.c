@@ -0,0 +1,1353 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * lkp_user.c - Userspace runtime and main() for lkp_ds_user
+ *
+ * Usage: lkp_ds_user [param=value ...] [run option ...]
+ *
+ * Module parameters (int_str, bench_size, bench_seed, ...) are set by
+ * name, as on the insmod command line.  Any other name=value is a run
+ * option, passed as "run <options>" to /proc/lkp_ds_bench, so
+ *
+ *	lkp_ds_user n=100000 trials=5 structs=hash,rbtree
+ *
+ * runs the same workload as writing that line to the module's file.
+ * Without run options the load-time run (bench_size) is reported.
+ * The report goes to stdout, followed by the std:: container baselines
+ * unless baseline=0 is given; kernel log lines go to stderr.
+ */
+#define _GNU_SOURCE
+#include "lkp_user.h"
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <sys/ioctl.h>
+#include <sys/random.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* lkp_ds.c: module_init()/module_exit() */
+int lkp_user_module_init(void);
+void lkp_user_module_exit(void);
+
+/* baseline.cc */
+void lkp_user_baseline_show(FILE *out);
+
+static bool lkp_user_baselines = true;
+
+/* ===================================================================
+ * Completions
+ * =================================================================== */
+
+void init_completion(struct completion *x)
+{
+	x->done = 0;
+	pthread_mutex_init(&x->lock, NULL);
+	pthread_cond_init(&x->wait, NULL);
+}
+
+void reinit_completion(struct completion *x)
+{
+	x->done = 0;
+}
+
+void complete(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	if (x->done != UINT_MAX)
+		x->done++;
+	pthread_cond_signal(&x->wait);
+	pthread_mutex_unlock(&x->lock);
+}
+
+void complete_all(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	x->done = UINT_MAX;
+	pthread_cond_broadcast(&x->wait);
+	pthread_mutex_unlock(&x->lock);
+}
+
+void wait_for_completion(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	while (!x->done)
+		pthread_cond_wait(&x->wait, &x->lock);
+	if (x->done != UINT_MAX)
+		x->done--;
+	pthread_mutex_unlock(&x->lock);
+}
+
+/* ===================================================================
+ * RCU
+ * =================================================================== */
+
+/* Callbacks queued before a grace period is forced from call_rcu() */
+#define LKP_RCU_BATCH		16384
+
+__thread struct lkp_rcu_reader lkp_rcu_me;
+unsigned long lkp_rcu_gp = 1;
+
+static pthread_mutex_t lkp_rcu_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct lkp_rcu_reader *lkp_rcu_readers;
+
+static pthread_mutex_t lkp_rcu_cb_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rcu_head *lkp_rcu_cbs;
+static unsigned long lkp_rcu_nr_cbs;
+
+void lkp_rcu_register(void)
+{
+	pthread_mutex_lock(&lkp_rcu_lock);
+	lkp_rcu_me.next = lkp_rcu_readers;
+	lkp_rcu_readers = &lkp_rcu_me;
+	lkp_rcu_me.registered = true;
+	pthread_mutex_unlock(&lkp_rcu_lock);
+}
+
+void lkp_rcu_unregister(void)
+{
+	struct lkp_rcu_reader **p;
+
+	if (!lkp_rcu_me.registered)
+		return;
+	pthread_mutex_lock(&lkp_rcu_lock);
+	for (p = &lkp_rcu_readers; *p; p = &(*p)->next) {
+		if (*p == &lkp_rcu_me) {
+			*p = lkp_rcu_me.next;
+			break;
+		}
+	}
+	lkp_rcu_me.registered = false;
+	pthread_mutex_unlock(&lkp_rcu_lock);
+}
+
+/* Wait until every reader that started before now has left */
+static void lkp_rcu_wait(void)
+{
+	struct lkp_rcu_reader *r;
+	unsigned long gp, ctr;
+	unsigned int spins;
+
+	smp_mb();
+	pthread_mutex_lock(&lkp_rcu_lock);
+	gp = __atomic_add_fetch(&lkp_rcu_gp, 1, __ATOMIC_SEQ_CST);
+	for (r = lkp_rcu_readers; r; r = r->next) {
+		if (r == &lkp_rcu_me)
+			continue;
+		spins = 0;
+		for (;;) {
+			ctr = __atomic_load_n(&r->ctr, __ATOMIC_ACQUIRE);
+			if (!ctr || ctr >= gp)
+				break;
+			if (++spins & 255)
+				cpu_relax();
+			else
+				sched_yield();
+		}
+	}
+	pthread_mutex_unlock(&lkp_rcu_lock);
+	smp_mb();
+}
+
+static void lkp_rcu_invoke(struct rcu_head *head)
+{
+	unsigned long offset = (unsigned long)head->func;
+
+	if (offset < 4096)
+		free((char *)head - offset);
+	else
+		head->func(head);
+}
+
+void synchronize_rcu(void)
+{
+	struct rcu_head *head, *next;
+
+	pthread_mutex_lock(&lkp_rcu_cb_lock);
+	head = lkp_rcu_cbs;
+	lkp_rcu_cbs = NULL;
+	lkp_rcu_nr_cbs = 0;
+	pthread_mutex_unlock(&lkp_rcu_cb_lock);
+
+	lkp_rcu_wait();
+
+	for (; head; head = next) {
+		next = head->next;
+		lkp_rcu_invoke(head);
+	}
+}
+
+void rcu_barrier(void)
+{
+	synchronize_rcu();
+}
+
+static void lkp_rcu_queue(struct rcu_head *head)
+{
+	bool flush;
+
+	pthread_mutex_lock(&lkp_rcu_cb_lock);
+	head->next = lkp_rcu_cbs;
+	lkp_rcu_cbs = head;
+	flush = ++lkp_rcu_nr_cbs >= LKP_RCU_BATCH && !lkp_rcu_me.nesting;
+	pthread_mutex_unlock(&lkp_rcu_cb_lock);
+
+	if (flush)
+		synchronize_rcu();
+}
+
+void call_rcu(struct rcu_head *head, rcu_callback_t func)
+{
+	head->func = func;
+	lkp_rcu_queue(head);
+}
+
+void __lkp_kvfree_rcu(struct rcu_head *head, unsigned long offset)
+{
+	head->func = (rcu_callback_t)offset;
+	lkp_rcu_queue(head);
+}
+
+/* ===================================================================
+ * Tasks
+ * =================================================================== */
+
+__thread struct task_struct *lkp_current;
+
+unsigned int nr_cpu_ids;
+struct cpumask __cpu_online_mask;
+nodemask_t node_states[NR_NODE_STATES];
+
+static struct task_struct lkp_main_task = {
+	.comm = "lkp_ds_user",
+	.cpu = -1,
+	.started = true,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wait = PTHREAD_COND_INITIALIZER,
+};
+
+/* Online CPUs are the ones we may run on */
+static void lkp_user_cpus_init(void)
+{
+	cpu_set_t set;
+	int cpu, last = 0;
+
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set))
+		CPU_SET(0, &set);
+	for (cpu = 0; cpu < NR_CPUS && cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &set))
+			continue;
+		__cpu_online_mask.bits[cpu / BITS_PER_LONG] |= BIT(cpu % BITS_PER_LONG);
+		last = cpu;
+	}
+	nr_cpu_ids = last + 1;
+
+	node_states[N_POSSIBLE].bits[0] = 1;
+	node_states[N_ONLINE].bits[0] = 1;
+	node_states[N_MEMORY].bits[0] = 1;
+	node_states[N_CPU].bits[0] = 1;
+}
+
+void schedule(void)
+{
+	struct task_struct *p = current;
+
+	pthread_mutex_lock(&p->lock);
+	while (!p->woken && READ_ONCE(p->state) != TASK_RUNNING)
+		pthread_cond_wait(&p->wait, &p->lock);
+	p->woken = false;
+	pthread_mutex_unlock(&p->lock);
+	sched_yield();
+}
+
+int wake_up_process(struct task_struct *p)
+{
+	pthread_mutex_lock(&p->lock);
+	p->woken = true;
+	p->started = true;
+	WRITE_ONCE(p->state, TASK_RUNNING);
+	pthread_cond_signal(&p->wait);
+	pthread_mutex_unlock(&p->lock);
+	return 1;
+}
+
+/* A new kthread sleeps until its first wake_up_process() */
+static void *lkp_kthread(void *arg)
+{
+	struct task_struct *p = arg;
+
+	lkp_current = p;
+	pthread_mutex_lock(&p->lock);
+	while (!p->started && !p->should_stop)
+		pthread_cond_wait(&p->wait, &p->lock);
+	p->woken = false;
+	pthread_mutex_unlock(&p->lock);
+
+	p->ret = p->should_stop ? -EINTR : p->threadfn(p->data);
+	lkp_rcu_unregister();
+	return NULL;
+}
+
+struct task_struct *kthread_create_on_node(int (*threadfn)(void *data),
+					   void *data, int node,
+					   const char namefmt[], ...)
+{
+	struct task_struct *p = calloc(1, sizeof(*p));
+	va_list args;
+
+	if (!p)
+		return ERR_PTR(-ENOMEM);
+	p->threadfn = threadfn;
+	p->data = data;
+	p->cpu = -1;
+	p->state = TASK_UNINTERRUPTIBLE;
+	va_start(args, namefmt);
+	vsnprintf(p->comm, sizeof(p->comm), namefmt, args);
+	va_end(args);
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->wait, NULL);
+
+	if (pthread_create(&p->thread, NULL, lkp_kthread, p)) {
+		free(p);
+		return ERR_PTR(-EAGAIN);
+	}
+	pthread_setname_np(p->thread, p->comm);
+	return p;
+}
+
+void kthread_bind(struct task_struct *k, unsigned int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (!pthread_setaffinity_np(k->thread, sizeof(set), &set))
+		k->cpu = cpu;
+}
+
+bool kthread_should_stop(void)
+{
+	return current && READ_ONCE(current->should_stop);
+}
+
+int kthread_stop(struct task_struct *k)
+{
+	int ret;
+
+	pthread_mutex_lock(&k->lock);
+	WRITE_ONCE(k->should_stop, true);
+	pthread_mutex_unlock(&k->lock);
+	wake_up_process(k);
+	pthread_join(k->thread, NULL);
+
+	ret = k->ret;
+	pthread_mutex_destroy(&k->lock);
+	pthread_cond_destroy(&k->wait);
+	free(k);
+	return ret;
+}
+
+/* ===================================================================
+ * Randomness
+ * =================================================================== */
+
+u32 prandom_u32_state(struct rnd_state *state)
+{
+#define TAUSWORTHE(s, a, b, c, d) ((s & c) << d) ^ (((s << a) ^ s) >> b)
+	state->s1 = TAUSWORTHE(state->s1,  6U, 13U, 4294967294U, 18U);
+	state->s2 = TAUSWORTHE(state->s2,  2U, 27U, 4294967288U,  2U);
+	state->s3 = TAUSWORTHE(state->s3, 13U, 21U, 4294967280U,  7U);
+	state->s4 = TAUSWORTHE(state->s4,  3U, 12U, 4294967168U, 13U);
+
+	return (state->s1 ^ state->s2 ^ state->s3 ^ state->s4);
+#undef TAUSWORTHE
+}
+
+u64 get_random_u64(void)
+{
+	u64 v;
+
+	if (getrandom(&v, sizeof(v), 0) != sizeof(v))
+		v = ktime_get_ns() ^ ((u64)getpid() << 32);
+	return v;
+}
+
+/* ===================================================================
+ * Memory
+ * =================================================================== */
+
+void *kmalloc(size_t size, gfp_t flags)
+{
+	if (flags & __GFP_ZERO)
+		return calloc(1, size);
+	return malloc(size);
+}
+
+void kfree(const void *objp)
+{
+	free((void *)objp);
+}
+
+size_t ksize(const void *objp)
+{
+	return objp ? malloc_usable_size((void *)objp) : 0;
+}
+
+/* What malloc() really hands out for @size, like the kmalloc bucket */
+size_t kmalloc_size_roundup(size_t size)
+{
+	void *p = malloc(size ?: 1);
+	size_t real;
+
+	if (!p)
+		return size;
+	real = malloc_usable_size(p);
+	free(p);
+	return real;
+}
+
+char *kstrdup(const char *s, gfp_t gfp)
+{
+	return s ? strdup(s) : NULL;
+}
+
+void *vmalloc_user(unsigned long size)
+{
+	return calloc(1, size);
+}
+
+struct kmem_cache *kmem_cache_create(const char *name, unsigned int size,
+				     unsigned int align, unsigned int flags,
+				     void (*ctor)(void *))
+{
+	struct kmem_cache *s = calloc(1, sizeof(*s));
+
+	if (!s)
+		return NULL;
+	if (flags & SLAB_HWCACHE_ALIGN)
+		align = max_t(unsigned int, align, L1_CACHE_BYTES);
+	s->name = name;
+	s->object_size = size;
+	s->align = max_t(unsigned int, align, sizeof(void *));
+	s->size = kmalloc_size_roundup(ALIGN(size, s->align));
+	s->ctor = ctor;
+	return s;
+}
+
+void kmem_cache_destroy(struct kmem_cache *s)
+{
+	if (!s)
+		return;
+	/* as in the kernel, objects still in kfree_rcu() must go first */
+	rcu_barrier();
+	free(s);
+}
+
+void *kmem_cache_alloc(struct kmem_cache *s, gfp_t flags)
+{
+	void *p;
+
+	if (s->align > sizeof(void *) * 2)
+		p = aligned_alloc(s->align, ALIGN(s->object_size, s->align));
+	else
+		p = malloc(s->object_size);
+	if (!p)
+		return NULL;
+	if (flags & __GFP_ZERO)
+		memset(p, 0, s->object_size);
+	else if (s->ctor)
+		s->ctor(p);
+	return p;
+}
+
+void kmem_cache_free(struct kmem_cache *s, void *objp)
+{
+	free(objp);
+}
+
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t nr,
+			  void **p)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++) {
+		p[i] = kmem_cache_alloc(s, flags);
+		if (!p[i]) {
+			kmem_cache_free_bulk(s, i, p);
+			return 0;
+		}
+	}
+	return nr;
+}
+
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t nr, void **p)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		free(p[i]);
+}
+
+mempool_t *mempool_create(int min_nr, mempool_alloc_t *alloc_fn,
+			  mempool_free_t *free_fn, void *pool_data)
+{
+	mempool_t *pool = calloc(1, sizeof(*pool));
+
+	if (!pool)
+		return NULL;
+	pool->alloc = alloc_fn;
+	pool->free = free_fn;
+	pool->pool_data = pool_data;
+	return pool;
+}
+
+void mempool_destroy(mempool_t *pool)
+{
+	free(pool);
+}
+
+/* ===================================================================
+ * Strings and library routines
+ * =================================================================== */
+
+/* Whole string, one trailing newline allowed, no sign for unsigned */
+static int lkp_strtoull(const char *s, unsigned int base,
+			unsigned long long *res)
+{
+	unsigned long long v;
+	char *end;
+
+	if (!s || !isalnum((unsigned char)*s))
+		return -EINVAL;
+	errno = 0;
+	v = strtoull(s, &end, base);
+	if (errno == ERANGE)
+		return -ERANGE;
+	if (end == s || (*end && !(*end == '\n' && !end[1])))
+		return -EINVAL;
+	*res = v;
+	return 0;
+}
+
+static int lkp_strtoll(const char *s, unsigned int base, long long *res)
+{
+	unsigned long long v;
+	int err;
+
+	if (s && *s == '-') {
+		err = lkp_strtoull(s + 1, base, &v);
+		if (err)
+			return err;
+		if (v > (unsigned long long)LLONG_MAX + 1)
+			return -ERANGE;
+		*res = -(long long)v;
+		return 0;
+	}
+	if (s && *s == '+')
+		s++;
+	err = lkp_strtoull(s, base, &v);
+	if (err)
+		return err;
+	if (v > LLONG_MAX)
+		return -ERANGE;
+	*res = v;
+	return 0;
+}
+
+int kstrtoint(const char *s, unsigned int base, int *res)
+{
+	long long v;
+	int err = lkp_strtoll(s, base, &v);
+
+	if (err)
+		return err;
+	if (v != (int)v)
+		return -ERANGE;
+	*res = v;
+	return 0;
+}
+
+int kstrtouint(const char *s, unsigned int base, unsigned int *res)
+{
+	unsigned long long v;
+	int err;
+
+	if (s && *s == '+')
+		s++;
+	err = lkp_strtoull(s, base, &v);
+	if (err)
+		return err;
+	if (v != (unsigned int)v)
+		return -ERANGE;
+	*res = v;
+	return 0;
+}
+
+int kstrtoull(const char *s, unsigned int base, unsigned long long *res)
+{
+	if (s && *s == '+')
+		s++;
+	return lkp_strtoull(s, base, res);
+}
+
+int kstrtou64(const char *s, unsigned int base, u64 *res)
+{
+	unsigned long long v;
+	int err = kstrtoull(s, base, &v);
+
+	if (!err)
+		*res = v;
+	return err;
+}
+
+int kstrtobool(const char *s, bool *res)
+{
+	if (!s)
+		return -EINVAL;
+
+	switch (s[0]) {
+	case 'y':
+	case 'Y':
+	case 't':
+	case 'T':
+	case '1':
+		*res = true;
+		return 0;
+	case 'n':
+	case 'N':
+	case 'f':
+	case 'F':
+	case '0':
+		*res = false;
+		return 0;
+	case 'o':
+	case 'O':
+		switch (s[1]) {
+		case 'n':
+		case 'N':
+			*res = true;
+			return 0;
+		case 'f':
+		case 'F':
+			*res = false;
+			return 0;
+		}
+		break;
+	}
+	return -EINVAL;
+}
+
+char *strim(char *s)
+{
+	size_t size = strlen(s);
+	char *end;
+
+	if (!size)
+		return s;
+	end = s + size - 1;
+	while (end >= s && isspace((unsigned char)*end))
+		end--;
+	*(end + 1) = '\0';
+	while (isspace((unsigned char)*s))
+		s++;
+	return s;
+}
+
+int match_string(const char * const *array, size_t n, const char *string)
+{
+	size_t index;
+
+	for (index = 0; index < n; index++) {
+		if (!array[index])
+			break;
+		if (!strcmp(array[index], string))
+			return index;
+	}
+	return -EINVAL;
+}
+
+int scnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+	va_list args;
+	int i;
+
+	if (!size)
+		return 0;
+	va_start(args, fmt);
+	i = vsnprintf(buf, size, fmt, args);
+	va_end(args);
+	if (i < 0)
+		return 0;
+	return (size_t)i < size ? i : (int)(size - 1);
+}
+
+static void lkp_sort_swap(void *a, void *b, size_t size)
+{
+	char *x = a, *y = b, t;
+
+	while (size--) {
+		t = *x;
+		*x++ = *y;
+		*y++ = t;
+	}
+}
+
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp)(const void *, const void *),
+	  void (*swap_func)(void *, void *, int))
+{
+	char *b = base;
+	size_t i, r, c, n = num * size;
+
+	if (num < 2)
+		return;
+
+	/* heapify */
+	for (i = (num / 2 - 1) * size; ; i -= size) {
+		for (r = i; r * 2 + size < n; r = c) {
+			c = r * 2 + size;
+			if (c < n - size && cmp(b + c, b + c + size) < 0)
+				c += size;
+			if (cmp(b + r, b + c) >= 0)
+				break;
+			if (swap_func)
+				swap_func(b + r, b + c, size);
+			else
+				lkp_sort_swap(b + r, b + c, size);
+		}
+		if (!i)
+			break;
+	}
+
+	/* sort */
+	for (i = n - size; i > 0; i -= size) {
+		if (swap_func)
+			swap_func(b, b + i, size);
+		else
+			lkp_sort_swap(b, b + i, size);
+		for (r = 0; r * 2 + size < i; r = c) {
+			c = r * 2 + size;
+			if (c < i - size && cmp(b + c, b + c + size) < 0)
+				c += size;
+			if (cmp(b + r, b + c) >= 0)
+				break;
+			if (swap_func)
+				swap_func(b + r, b + c, size);
+			else
+				lkp_sort_swap(b + r, b + c, size);
+		}
+	}
+}
+
+/* ===================================================================
+ * procfs and seq_file
+ * =================================================================== */
+
+struct proc_dir_entry {
+	char name[64];
+	const struct proc_ops *proc_ops;
+	const struct seq_operations *seq_ops;	/* proc_create_seq_private() */
+	unsigned int state_size;
+	void *data;
+	struct proc_dir_entry *next;
+};
+
+static struct proc_dir_entry *lkp_proc_entries;
+
+static struct proc_dir_entry *lkp_proc_add(const char *name, void *data)
+{
+	struct proc_dir_entry *de = calloc(1, sizeof(*de));
+
+	if (!de)
+		return NULL;
+	snprintf(de->name, sizeof(de->name), "%s", name);
+	de->data = data;
+	de->next = lkp_proc_entries;
+	lkp_proc_entries = de;
+	return de;
+}
+
+struct proc_dir_entry *proc_create_data(const char *name, umode_t mode,
+					struct proc_dir_entry *parent,
+					const struct proc_ops *proc_ops,
+					void *data)
+{
+	struct proc_dir_entry *de = lkp_proc_add(name, data);
+
+	if (de)
+		de->proc_ops = proc_ops;
+	return de;
+}
+
+struct proc_dir_entry *proc_create(const char *name, umode_t mode,
+				   struct proc_dir_entry *parent,
+				   const struct proc_ops *proc_ops)
+{
+	return proc_create_data(name, mode, parent, proc_ops, NULL);
+}
+
+struct proc_dir_entry *proc_create_seq_private(const char *name, umode_t mode,
+					       struct proc_dir_entry *parent,
+					       const struct seq_operations *ops,
+					       unsigned int state_size,
+					       void *data)
+{
+	struct proc_dir_entry *de = lkp_proc_add(name, data);
+
+	if (de) {
+		de->seq_ops = ops;
+		de->state_size = state_size;
+	}
+	return de;
+}
+
+void proc_remove(struct proc_dir_entry *de)
+{
+	struct proc_dir_entry **p;
+
+	if (!de)
+		return;
+	for (p = &lkp_proc_entries; *p; p = &(*p)->next) {
+		if (*p == de) {
+			*p = de->next;
+			break;
+		}
+	}
+	free(de);
+}
+
+void *pde_data(const struct inode *inode)
+{
+	return inode->pde->data;
+}
+
+int seq_open(struct file *file, const struct seq_operations *op)
+{
+	struct seq_file *m = calloc(1, sizeof(*m));
+
+	if (!m)
+		return -ENOMEM;
+	m->op = op;
+	m->file = file;
+	file->private_data = m;
+	return 0;
+}
+
+void *__seq_open_private(struct file *file, const struct seq_operations *ops,
+			 int psize)
+{
+	void *private = calloc(1, psize);
+
+	if (!private)
+		return NULL;
+	if (seq_open(file, ops)) {
+		free(private);
+		return NULL;
+	}
+	((struct seq_file *)file->private_data)->private = private;
+	return private;
+}
+
+int seq_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	free(m->buf);
+	free(m);
+	return 0;
+}
+
+int seq_release_private(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	free(m->private);
+	return seq_release(inode, file);
+}
+
+static bool lkp_seq_grow(struct seq_file *m, size_t len)
+{
+	size_t size = m->size ?: PAGE_SIZE;
+	char *buf;
+
+	while (size - m->count <= len)
+		size *= 2;
+	if (size == m->size)
+		return true;
+	buf = realloc(m->buf, size);
+	if (!buf)
+		return false;
+	m->buf = buf;
+	m->size = size;
+	return true;
+}
+
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+	if (len < 0 || !lkp_seq_grow(m, len))
+		return;
+
+	va_start(args, fmt);
+	vsnprintf(m->buf + m->count, m->size - m->count, fmt, args);
+	va_end(args);
+	m->count += len;
+}
+
+void seq_puts(struct seq_file *m, const char *s)
+{
+	seq_printf(m, "%s", s);
+}
+
+void seq_putc(struct seq_file *m, char c)
+{
+	seq_printf(m, "%c", c);
+}
+
+/*
+ * The buffer grows instead of overflowing, so the whole file is
+ * produced by one start/show/next/stop walk on the first read.
+ */
+ssize_t seq_read(struct file *file, char __user *buf, size_t size,
+		 loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	loff_t pos = 0;
+	size_t n;
+	void *p;
+
+	if (!m->filled) {
+		p = m->op->start(m, &pos);
+		while (p && !IS_ERR(p)) {
+			if (m->op->show(m, p) < 0)
+				break;
+			p = m->op->next(m, p, &pos);
+		}
+		m->op->stop(m, p);
+		m->filled = true;
+	}
+
+	if (*ppos >= (loff_t)m->count)
+		return 0;
+	n = min_t(size_t, size, m->count - *ppos);
+	memcpy(buf, m->buf + *ppos, n);
+	*ppos += n;
+	return n;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence)
+{
+	return default_llseek(file, offset, whence);
+}
+
+static void *single_start(struct seq_file *p, loff_t *pos)
+{
+	return *pos ? NULL : (void *)1;
+}
+
+static void *single_next(struct seq_file *p, void *v, loff_t *pos)
+{
+	++*pos;
+	return NULL;
+}
+
+static void single_stop(struct seq_file *p, void *v)
+{
+}
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data)
+{
+	struct seq_operations *op = calloc(1, sizeof(*op));
+	int res;
+
+	if (!op)
+		return -ENOMEM;
+	op->start = single_start;
+	op->next = single_next;
+	op->stop = single_stop;
+	op->show = show;
+	res = seq_open(file, op);
+	if (res) {
+		free(op);
+		return res;
+	}
+	((struct seq_file *)file->private_data)->private = data;
+	return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+	const struct seq_operations *op =
+		((struct seq_file *)file->private_data)->op;
+	int res = seq_release(inode, file);
+
+	free((void *)op);
+	return res;
+}
+
+loff_t noop_llseek(struct file *file, loff_t offset, int whence)
+{
+	return file->f_pos;
+}
+
+loff_t default_llseek(struct file *file, loff_t offset, int whence)
+{
+	if (whence == SEEK_CUR)
+		offset += file->f_pos;
+	else if (whence != SEEK_SET)
+		return -EINVAL;
+	if (offset < 0)
+		return -EINVAL;
+	file->f_pos = offset;
+	return offset;
+}
+
+ssize_t simple_read_from_buffer(void __user *to, size_t count, loff_t *ppos,
+				const void *from, size_t available)
+{
+	loff_t pos = *ppos;
+
+	if (pos < 0)
+		return -EINVAL;
+	if ((size_t)pos >= available || !count)
+		return 0;
+	if (count > available - pos)
+		count = available - pos;
+	memcpy(to, (const char *)from + pos, count);
+	*ppos = pos + count;
+	return count;
+}
+
+void *memdup_user_nul(const void __user *src, size_t len)
+{
+	char *p = malloc(len + 1);
+
+	if (!p)
+		return ERR_PTR(-ENOMEM);
+	memcpy(p, src, len);
+	p[len] = '\0';
+	return p;
+}
+
+char *simple_transaction_get(struct file *file, const char __user *buf,
+			     size_t size)
+{
+	struct simple_transaction_argresp *ar;
+
+	if (size > SIMPLE_TRANSACTION_LIMIT - 1)
+		return ERR_PTR(-EFBIG);
+	if (file->private_data)
+		return ERR_PTR(-EBUSY);
+	ar = calloc(1, PAGE_SIZE);
+	if (!ar)
+		return ERR_PTR(-ENOMEM);
+	memcpy(ar->data, buf, size);
+	file->private_data = ar;
+	return ar->data;
+}
+
+void simple_transaction_set(struct file *file, size_t n)
+{
+	struct simple_transaction_argresp *ar = file->private_data;
+
+	BUG_ON(n > SIMPLE_TRANSACTION_LIMIT);
+	ar->size = n;
+}
+
+ssize_t simple_transaction_read(struct file *file, char __user *buf,
+				size_t size, loff_t *pos)
+{
+	struct simple_transaction_argresp *ar = file->private_data;
+
+	if (!ar)
+		return 0;
+	return simple_read_from_buffer(buf, size, pos, ar->data, ar->size);
+}
+
+int simple_transaction_release(struct inode *inode, struct file *file)
+{
+	free(file->private_data);
+	return 0;
+}
+
+/* open() of a registered file, with the proc_create_seq_private() glue */
+static int lkp_proc_open(const char *name, struct file *file,
+			 struct inode *inode)
+{
+	struct proc_dir_entry *de;
+
+	for (de = lkp_proc_entries; de; de = de->next)
+		if (!strcmp(de->name, name))
+			break;
+	if (!de)
+		return -ENOENT;
+
+	memset(file, 0, sizeof(*file));
+	inode->pde = de;
+	file->f_inode = inode;
+	if (de->seq_ops)
+		return __seq_open_private(file, de->seq_ops, de->state_size) ?
+		       0 : -ENOMEM;
+	return de->proc_ops->proc_open ? de->proc_ops->proc_open(inode, file) : 0;
+}
+
+static void lkp_proc_release(struct file *file, struct inode *inode)
+{
+	const struct proc_ops *ops = inode->pde->proc_ops;
+
+	if (inode->pde->seq_ops)
+		seq_release_private(inode, file);
+	else if (ops->proc_release)
+		ops->proc_release(inode, file);
+}
+
+/* echo "@buf" > /proc/@name */
+static int lkp_proc_write(const char *name, const char *buf)
+{
+	struct inode inode;
+	struct file file;
+	ssize_t ret;
+	int err;
+
+	err = lkp_proc_open(name, &file, &inode);
+	if (err)
+		return err;
+	ret = inode.pde->seq_ops || !inode.pde->proc_ops->proc_write ? -EIO :
+	      inode.pde->proc_ops->proc_write(&file, buf, strlen(buf),
+					      &file.f_pos);
+	lkp_proc_release(&file, &inode);
+	return ret < 0 ? ret : 0;
+}
+
+/* cat /proc/@name > @out */
+static int lkp_proc_cat(const char *name, FILE *out)
+{
+	ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+	struct inode inode;
+	struct file file;
+	char buf[4096];
+	ssize_t ret;
+	int err;
+
+	err = lkp_proc_open(name, &file, &inode);
+	if (err)
+		return err;
+	read = inode.pde->seq_ops ? seq_read : inode.pde->proc_ops->proc_read;
+	while ((ret = read(&file, buf, sizeof(buf), &file.f_pos)) > 0)
+		fwrite(buf, 1, ret, out);
+	lkp_proc_release(&file, &inode);
+	return ret < 0 ? ret : 0;
+}
+
+/* ===================================================================
+ * Workqueues
+ * =================================================================== */
+
+struct workqueue_struct {
+	const char *name;
+};
+
+static struct workqueue_struct lkp_system_wq = { "events" };
+static struct workqueue_struct lkp_system_unbound_wq = { "events_unbound" };
+struct workqueue_struct *system_wq = &lkp_system_wq;
+struct workqueue_struct *system_unbound_wq = &lkp_system_unbound_wq;
+
+struct workqueue_struct *alloc_workqueue(const char *fmt, unsigned int flags,
+					 int max_active, ...)
+{
+	struct workqueue_struct *wq = calloc(1, sizeof(*wq));
+
+	if (wq)
+		wq->name = fmt;
+	return wq;
+}
+
+void destroy_workqueue(struct workqueue_struct *wq)
+{
+	free(wq);
+}
+
+/* ===================================================================
+ * perf events
+ * =================================================================== */
+
+struct perf_event {
+	int fd;
+};
+
+struct perf_event *
+perf_event_create_kernel_counter(struct perf_event_attr *attr, int cpu,
+				 struct task_struct *task,
+				 void *overflow_handler, void *context)
+{
+	struct perf_event *ev;
+	int fd;
+
+	attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			    PERF_FORMAT_TOTAL_TIME_RUNNING;
+	fd = syscall(__NR_perf_event_open, attr, 0, cpu, -1, 0);
+	if (fd < 0 && (errno == EACCES || errno == EPERM) &&
+	    !attr->exclude_kernel) {
+		/* perf_event_paranoid 2 and up: user-mode counts only */
+		attr->exclude_kernel = 1;
+		fd = syscall(__NR_perf_event_open, attr, 0, cpu, -1, 0);
+	}
+	if (fd < 0)
+		return ERR_PTR(-errno);
+
+	ev = malloc(sizeof(*ev));
+	if (!ev) {
+		close(fd);
+		return ERR_PTR(-ENOMEM);
+	}
+	ev->fd = fd;
+	return ev;
+}
+
+int perf_event_release_kernel(struct perf_event *event)
+{
+	close(event->fd);
+	free(event);
+	return 0;
+}
+
+u64 perf_event_read_value(struct perf_event *event, u64 *enabled,
+			  u64 *running)
+{
+	u64 v[3] = {};
+
+	if (read(event->fd, v, sizeof(v)) != sizeof(v))
+		return 0;
+	*enabled = v[1];
+	*running = v[2];
+	return v[0];
+}
+
+/* ===================================================================
+ * Module parameters and main()
+ * =================================================================== */
+
+static struct lkp_user_param *lkp_user_params;
+
+void lkp_user_param_add(struct lkp_user_param *p)
+{
+	p->next = lkp_user_params;
+	lkp_user_params = p;
+}
+
+/* Returns -ENOENT if @name is not a module parameter */
+static int lkp_user_param_set(const char *name, char *val)
+{
+	struct lkp_user_param *p;
+
+	for (p = lkp_user_params; p; p = p->next)
+		if (!strcmp(p->name, name))
+			break;
+	if (!p)
+		return -ENOENT;
+
+	switch (p->type) {
+	case LKP_PARAM_charp:
+		*(char **)p->arg = val;
+		return 0;
+	case LKP_PARAM_int:
+		return kstrtoint(val, 0, p->arg);
+	case LKP_PARAM_uint:
+		return kstrtouint(val, 0, p->arg);
+	case LKP_PARAM_ullong:
+		return kstrtoull(val, 0, p->arg);
+	case LKP_PARAM_bool:
+		return kstrtobool(val, p->arg);
+	}
+	return -EINVAL;
+}
+
+int main(int argc, char **argv)
+{
+	char *opts, *arg, *eq, *set_int_str = NULL;
+	bool bench_size_set = false;
+	size_t len = 0;
+	int i, err;
+
+	lkp_current = &lkp_main_task;
+	lkp_main_task.thread = pthread_self();
+	lkp_user_cpus_init();
+
+	for (i = 1; i < argc; i++)
+		len += strlen(argv[i]) + 1;
+	opts = calloc(1, len + 1);
+	if (!opts)
+		return 1;
+
+	for (i = 1; i < argc; i++) {
+		arg = argv[i];
+		eq = strchr(arg, '=');
+		if (!eq) {
+			fprintf(stderr, "usage: %s [param=value ...] [run option ...]\n",
+				argv[0]);
+			return 2;
+		}
+		*eq = '\0';
+		if (!strcmp(arg, "baseline")) {
+			err = kstrtobool(eq + 1, &lkp_user_baselines);
+		} else {
+			err = lkp_user_param_set(arg, eq + 1);
+			if (!err && !strcmp(arg, "int_str"))
+				set_int_str = eq + 1;
+			if (!err && !strcmp(arg, "bench_size"))
+				bench_size_set = true;
+		}
+		*eq = '=';
+		if (err == -ENOENT) {
+			/* not a parameter: a run option */
+			strcat(opts, " ");
+			strcat(opts, arg);
+		} else if (err) {
+			fprintf(stderr, "%s: invalid parameter %s\n", argv[0], arg);
+			return 2;
+		}
+	}
+
+	/* int_str is required by the module; any list will do for a benchmark */
+	if (!set_int_str)
+		lkp_user_param_set("int_str", "1");
+	/* with run options, the load-time run would only be thrown away */
+	if (*opts && !bench_size_set)
+		lkp_user_param_set("bench_size", "0");
+
+	err = lkp_user_module_init();
+	if (err) {
+		fprintf(stderr, "%s: init failed (error %d)\n", argv[0], err);
+		return 1;
+	}
+
+	if (*opts) {
+		len = strlen(opts) + 4;
+		arg = malloc(len);
+		if (!arg)
+			return 1;
+		snprintf(arg, len, "run%s", opts);
+		err = lkp_proc_write("lkp_ds_bench", arg);
+		free(arg);
+		if (err)
+			fprintf(stderr, "%s: run failed (error %d)\n", argv[0], err);
+	}
+
+	if (!err) {
+		lkp_proc_cat("lkp_ds_bench", stdout);
+		if (lkp_user_baselines)
+			lkp_user_baseline_show(stdout);
+	}
+	fflush(stdout);
+
+	lkp_user_module_exit();
+	synchronize_rcu();
+	free(opts);
+	return err ? 1 : 0;
+}
@@ -0,0 +1,1326 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * lkp_user.h - Kernel API for building lkp_ds.c as a userspace program
+ *
+ * "make user" compiles the module source unchanged (lkp_ds.c includes
+ * this instead of <linux/...> when __KERNEL__ is not defined) and links
+ * it with user/lkp_user.c, which supplies the runtime: libc allocators
+ * behind kmalloc() and kmem_cache, pthreads behind kthreads, mutexes and
+ * completions, a small RCU, procfs files that live in a table instead
+ * of /proc, and main().  The data structures are copies rather than
+ * wrappers: list.h and rbtree.c follow the kernel's code line for line,
+ * xarray.c is a minimal radix tree with the kernel's entry encoding and
+ * maple_tree.c a stand-in that the benchmark does not time.
+ *
+ * What does not carry over:
+ *  - lib/btree: CONFIG_BTREE is unset, so LKP_HAVE_BTREE is 0 and the
+ *    B+ tree rows read "-", exactly as on a kernel without it.
+ *  - NUMA: one node holding every CPU; numa=1 only has local rows.
+ *  - preemption, per-CPU state and IRQs: no-ops.
+ *  - /dev/lkp_ds: registered, but nothing can open it.
+ */
+#ifndef LKP_USER_H
+#define LKP_USER_H
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <linux/types.h>
+#include <linux/perf_event.h>
+
+/* ===================================================================
+ * Compiler and types
+ * =================================================================== */
+
+#define __init
+#define __exit
+#define __user
+#define __rcu
+#define __percpu
+#define __iomem
+#define __force
+#define __read_mostly
+#undef __always_inline
+#define __always_inline		inline __attribute__((__always_inline__))
+#define noinline		__attribute__((__noinline__))
+#define __maybe_unused		__attribute__((__unused__))
+#define __printf(a, b)		__attribute__((__format__(printf, a, b)))
+#define __aligned(x)		__attribute__((__aligned__(x)))
+#define __must_check		__attribute__((__warn_unused_result__))
+#define fallthrough		__attribute__((__fallthrough__))
+
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef long long s64;
+typedef unsigned int gfp_t;
+typedef unsigned int fmode_t;
+typedef unsigned short umode_t;
+
+#define U8_MAX			UINT8_MAX
+#define U16_MAX			UINT16_MAX
+#define U32_MAX			UINT32_MAX
+#define U64_MAX			UINT64_MAX
+#define S32_MAX			INT32_MAX
+#define S64_MAX			INT64_MAX
+
+#define BITS_PER_LONG		__LONG_WIDTH__
+#define BITS_PER_LONG_LONG	64
+#define L1_CACHE_BYTES		64
+#define PAGE_SHIFT		12
+#define PAGE_SIZE		(1UL << PAGE_SHIFT)
+#define PAGE_MASK		(~(PAGE_SIZE - 1))
+
+#define NSEC_PER_USEC		1000L
+#define NSEC_PER_MSEC		1000000L
+#define NSEC_PER_SEC		1000000000L
+
+#define container_of(ptr, type, member) ({				\
+	void *__mptr = (void *)(ptr);					\
+	((type *)(__mptr - offsetof(type, member))); })
+
+#define ARRAY_SIZE(arr)		(sizeof(arr) / sizeof((arr)[0]))
+
+/* IS_ENABLED(CONFIG_FOO): 1 if CONFIG_FOO is defined to 1, else 0 */
+#define __ARG_PLACEHOLDER_1	0,
+#define __take_second_arg(__ignored, val, ...) val
+#define __is_defined(x)		___is_defined(x)
+#define ___is_defined(val)	____is_defined(__ARG_PLACEHOLDER_##val)
+#define ____is_defined(arg1_or_junk)	__take_second_arg(arg1_or_junk 1, 0)
+#define IS_ENABLED(option)	__is_defined(option)
+
+#define READ_ONCE(x)		(*(const volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, val)	(*(volatile typeof(x) *)&(x) = (val))
+
+#define barrier()		__asm__ __volatile__("" : : : "memory")
+#define smp_mb()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#define smp_store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_load_acquire(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#else
+	barrier();
+#endif
+}
+
+/* ===================================================================
+ * Errors, warnings, printk
+ * =================================================================== */
+
+#define MAX_ERRNO		4095
+#ifndef ENOTSUPP
+#define ENOTSUPP		524
+#endif
+
+#define IS_ERR_VALUE(x)		unlikely((unsigned long)(void *)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error)
+{
+	return (void *)error;
+}
+
+static inline long PTR_ERR(const void *ptr)
+{
+	return (long)ptr;
+}
+
+static inline bool IS_ERR(const void *ptr)
+{
+	return IS_ERR_VALUE((unsigned long)ptr);
+}
+
+static inline bool IS_ERR_OR_NULL(const void *ptr)
+{
+	return unlikely(!ptr) || IS_ERR_VALUE((unsigned long)ptr);
+}
+
+#ifndef pr_fmt
+#define pr_fmt(fmt) fmt
+#endif
+
+/* Kernel log lines go to stderr, /proc output to stdout */
+#define printk(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_warn(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_notice(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_info(fmt, ...)	printk(pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_debug(fmt, ...)	do { } while (0)
+
+#define WARN_ON(cond) ({						\
+	bool __ret_warn_on = !!(cond);					\
+	if (unlikely(__ret_warn_on))					\
+		fprintf(stderr, "WARNING: %s:%d: %s\n",			\
+			__FILE__, __LINE__, #cond);			\
+	unlikely(__ret_warn_on);					\
+})
+
+#define WARN_ON_ONCE(cond) ({						\
+	static bool __warned;						\
+	bool __ret_warn_once = !!(cond);				\
+	if (unlikely(__ret_warn_once && !__warned)) {			\
+		__warned = true;					\
+		fprintf(stderr, "WARNING: %s:%d: %s\n",			\
+			__FILE__, __LINE__, #cond);			\
+	}								\
+	unlikely(__ret_warn_once);					\
+})
+
+#define BUG_ON(cond)		assert(!(cond))
+
+/* ===================================================================
+ * Arithmetic and bit helpers
+ * =================================================================== */
+
+#define BIT(nr)			(1UL << (nr))
+#define BIT_ULL(nr)		(1ULL << (nr))
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+#define min(x, y)		({ typeof(x) _x = (x); typeof(y) _y = (y); _x < _y ? _x : _y; })
+#define max(x, y)		({ typeof(x) _x = (x); typeof(y) _y = (y); _x > _y ? _x : _y; })
+#define min_t(type, x, y)	({ type __x = (x); type __y = (y); __x < __y ? __x : __y; })
+#define max_t(type, x, y)	({ type __x = (x); type __y = (y); __x > __y ? __x : __y; })
+#define clamp(val, lo, hi)	min(max(val, lo), hi)
+#define clamp_t(type, val, lo, hi) min_t(type, max_t(type, val, lo), hi)
+#define swap(a, b) \
+	do { typeof(a) __tmp = (a); (a) = (b); (b) = __tmp; } while (0)
+
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define DIV_ROUND_UP_ULL(ll, d)	((unsigned long long)DIV_ROUND_UP((unsigned long long)(ll), (d)))
+#define roundup(x, y)		((((x) + ((y) - 1)) / (y)) * (y))
+#define rounddown(x, y)		((x) - ((x) % (y)))
+#define ALIGN(x, a)		(((x) + ((typeof(x))(a) - 1)) & ~((typeof(x))(a) - 1))
+#define PAGE_ALIGN(addr)	ALIGN(addr, PAGE_SIZE)
+
+static inline bool is_power_of_2(unsigned long n)
+{
+	return n != 0 && ((n & (n - 1)) == 0);
+}
+
+static inline int fls64(u64 x)
+{
+	return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+#define ilog2(n)		(fls64(n) - 1)
+
+static inline unsigned long roundup_pow_of_two(unsigned long n)
+{
+	return 1UL << fls64(n - 1);
+}
+
+static inline unsigned long rounddown_pow_of_two(unsigned long n)
+{
+	return 1UL << ilog2(n);
+}
+
+#define order_base_2(n)		((n) > 1 ? ilog2((n) - 1) + 1 : 0)
+
+static inline unsigned int hweight_long(unsigned long w)
+{
+	return __builtin_popcountl(w);
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	unsigned long word;
+
+	while (offset < size) {
+		word = addr[offset / BITS_PER_LONG] >> (offset % BITS_PER_LONG);
+		if (word)
+			return min(offset + __builtin_ctzl(word), size);
+		offset = (offset | (BITS_PER_LONG - 1)) + 1;
+	}
+	return size;
+}
+
+static inline unsigned long find_first_bit(const unsigned long *addr,
+					   unsigned long size)
+{
+	return find_next_bit(addr, size, 0);
+}
+
+#define for_each_set_bit(bit, addr, size)				\
+	for ((bit) = find_first_bit((addr), (size));			\
+	     (bit) < (size);						\
+	     (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+/* Little-endian hosts only, as the snapshot format is */
+#define cpu_to_le16(x)		((__force __le16)(u16)(x))
+#define cpu_to_le32(x)		((__force __le32)(u32)(x))
+#define cpu_to_le64(x)		((__force __le64)(u64)(x))
+#define le16_to_cpu(x)		((__force u16)(__le16)(x))
+#define le32_to_cpu(x)		((__force u32)(__le32)(x))
+#define le64_to_cpu(x)		((__force u64)(__le64)(x))
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline u64 div64_u64(u64 dividend, u64 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline s64 div64_s64(s64 dividend, s64 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline u64 div64_u64_rem(u64 dividend, u64 divisor, u64 *remainder)
+{
+	*remainder = dividend % divisor;
+	return dividend / divisor;
+}
+
+static inline u64 mul_u64_u64_div_u64(u64 a, u64 b, u64 c)
+{
+	return (u64)((unsigned __int128)a * b / c);
+}
+
+static inline u64 int_sqrt64(u64 x)
+{
+	u64 b, m, y = 0;
+
+	if (x <= 1)
+		return x;
+
+	m = 1ULL << (fls64(x) & ~1U);
+	while (m != 0) {
+		b = y + m;
+		y >>= 1;
+
+		if (x >= b) {
+			x -= b;
+			y += m;
+		}
+		m >>= 2;
+	}
+
+	return y;
+}
+
+/* ---- overflow.h: saturate at SIZE_MAX so the allocation fails ---- */
+
+static inline size_t size_mul(size_t a, size_t b)
+{
+	size_t bytes;
+
+	if (__builtin_mul_overflow(a, b, &bytes))
+		return SIZE_MAX;
+	return bytes;
+}
+
+static inline size_t size_add(size_t a, size_t b)
+{
+	size_t bytes;
+
+	if (__builtin_add_overflow(a, b, &bytes))
+		return SIZE_MAX;
+	return bytes;
+}
+
+#define array_size(a, b)	size_mul(a, b)
+#define struct_size(p, member, count)					\
+	size_add(sizeof(*(p)), size_mul(sizeof(*(p)->member), count))
+
+/* ---- hash.h ---- */
+
+#define GOLDEN_RATIO_32		0x61C88647
+
+static inline u32 hash_32(u32 val, unsigned int bits)
+{
+	return (val * GOLDEN_RATIO_32) >> (32 - bits);
+}
+
+/* ===================================================================
+ * Atomics
+ * =================================================================== */
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	long counter;
+} atomic_long_t;
+
+#define ATOMIC_INIT(i)		{ (i) }
+#define ATOMIC_LONG_INIT(i)	{ (i) }
+
+#define __LKP_ATOMIC_OPS(pfx, type)					\
+static inline type pfx##_read(const pfx##_t *v)				\
+{									\
+	return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);		\
+}									\
+static inline void pfx##_set(pfx##_t *v, type i)			\
+{									\
+	__atomic_store_n(&v->counter, i, __ATOMIC_RELAXED);		\
+}									\
+static inline void pfx##_add(type i, pfx##_t *v)			\
+{									\
+	__atomic_fetch_add(&v->counter, i, __ATOMIC_RELAXED);		\
+}									\
+static inline void pfx##_inc(pfx##_t *v)				\
+{									\
+	__atomic_fetch_add(&v->counter, 1, __ATOMIC_RELAXED);		\
+}									\
+static inline void pfx##_dec(pfx##_t *v)				\
+{									\
+	__atomic_fetch_sub(&v->counter, 1, __ATOMIC_RELAXED);		\
+}									\
+static inline type pfx##_add_return(type i, pfx##_t *v)		\
+{									\
+	return __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST);	\
+}									\
+static inline type pfx##_inc_return(pfx##_t *v)				\
+{									\
+	return __atomic_add_fetch(&v->counter, 1, __ATOMIC_SEQ_CST);	\
+}									\
+static inline bool pfx##_dec_and_test(pfx##_t *v)			\
+{									\
+	return __atomic_sub_fetch(&v->counter, 1, __ATOMIC_SEQ_CST) == 0; \
+}
+
+__LKP_ATOMIC_OPS(atomic, int)
+__LKP_ATOMIC_OPS(atomic_long, long)
+
+/* ===================================================================
+ * Locks
+ * =================================================================== */
+
+/* Test-and-test-and-set; yields after a while so oversubscribed runs progress */
+typedef struct {
+	int locked;
+} spinlock_t;
+
+#define __SPIN_LOCK_UNLOCKED(name)	{ 0 }
+#define DEFINE_SPINLOCK(name)		spinlock_t name = __SPIN_LOCK_UNLOCKED(name)
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+	lock->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	unsigned int spins = 0;
+
+	while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED)) {
+			if (++spins & 1023)
+				cpu_relax();
+			else
+				sched_yield();
+		}
+	}
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	__atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+#define spin_lock_irqsave(lock, flags)	do { (void)(flags); spin_lock(lock); } while (0)
+#define spin_unlock_irqrestore(lock, flags) spin_unlock(lock)
+
+typedef struct {
+	pthread_rwlock_t rw;
+} rwlock_t;
+
+#define __RW_LOCK_UNLOCKED(name)	{ PTHREAD_RWLOCK_INITIALIZER }
+#define DEFINE_RWLOCK(name)		rwlock_t name = __RW_LOCK_UNLOCKED(name)
+#define rwlock_init(lock)		pthread_rwlock_init(&(lock)->rw, NULL)
+#define read_lock(lock)			pthread_rwlock_rdlock(&(lock)->rw)
+#define read_unlock(lock)		pthread_rwlock_unlock(&(lock)->rw)
+#define write_lock(lock)		pthread_rwlock_wrlock(&(lock)->rw)
+#define write_unlock(lock)		pthread_rwlock_unlock(&(lock)->rw)
+
+struct mutex {
+	pthread_mutex_t m;
+};
+
+#define __MUTEX_INITIALIZER(name)	{ PTHREAD_MUTEX_INITIALIZER }
+#define DEFINE_MUTEX(name)		struct mutex name = __MUTEX_INITIALIZER(name)
+#define mutex_init(lock)		pthread_mutex_init(&(lock)->m, NULL)
+#define mutex_lock(lock)		pthread_mutex_lock(&(lock)->m)
+#define mutex_unlock(lock)		pthread_mutex_unlock(&(lock)->m)
+#define mutex_trylock(lock)		(!pthread_mutex_trylock(&(lock)->m))
+#define lockdep_is_held(lock)		1
+
+/* ---- seqlock.h: the lock-associated variants are the plain one here ---- */
+
+typedef struct {
+	unsigned int sequence;
+} seqcount_t;
+
+typedef seqcount_t seqcount_spinlock_t;
+typedef seqcount_t seqcount_mutex_t;
+
+#define SEQCNT_ZERO(name)		{ 0 }
+#define SEQCNT_MUTEX_ZERO(name, lock)	SEQCNT_ZERO(name)
+#define seqcount_init(s)		((s)->sequence = 0)
+#define seqcount_spinlock_init(s, lock)	seqcount_init(s)
+#define seqcount_mutex_init(s, lock)	seqcount_init(s)
+
+static inline unsigned int read_seqcount_begin(const seqcount_t *s)
+{
+	unsigned int seq;
+
+	while ((seq = __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE)) & 1)
+		cpu_relax();
+	return seq;
+}
+
+static inline int read_seqcount_retry(const seqcount_t *s, unsigned int start)
+{
+	smp_rmb();
+	return __atomic_load_n(&s->sequence, __ATOMIC_RELAXED) != start;
+}
+
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+	__atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+	smp_wmb();
+}
+
+static inline void write_seqcount_end(seqcount_t *s)
+{
+	smp_wmb();
+	__atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+}
+
+/* ---- completion.h ---- */
+
+struct completion {
+	unsigned int done;
+	pthread_mutex_t lock;
+	pthread_cond_t wait;
+};
+
+#define COMPLETION_INITIALIZER(work) \
+	{ 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER }
+#define DECLARE_COMPLETION(work) \
+	struct completion work = COMPLETION_INITIALIZER(work)
+
+void init_completion(struct completion *x);
+void reinit_completion(struct completion *x);
+void complete(struct completion *x);
+void complete_all(struct completion *x);
+void wait_for_completion(struct completion *x);
+
+/* ===================================================================
+ * RCU
+ *
+ * Readers publish the grace-period counter they started under in a
+ * per-thread slot; synchronize_rcu() bumps the counter and waits until
+ * no thread is still in a section that began before.  Callbacks from
+ * call_rcu()/kfree_rcu() are batched and run by the next grace period.
+ * =================================================================== */
+
+struct rcu_head {
+	struct rcu_head *next;
+	void (*func)(struct rcu_head *head);
+};
+
+typedef void (*rcu_callback_t)(struct rcu_head *head);
+
+struct lkp_rcu_reader {
+	unsigned long ctr;		/* grace period at entry, 0 = outside */
+	unsigned int nesting;
+	bool registered;
+	struct lkp_rcu_reader *next;
+};
+
+extern __thread struct lkp_rcu_reader lkp_rcu_me;
+extern unsigned long lkp_rcu_gp;
+
+void lkp_rcu_register(void);
+void lkp_rcu_unregister(void);
+
+static inline void rcu_read_lock(void)
+{
+	struct lkp_rcu_reader *me = &lkp_rcu_me;
+
+	if (!me->nesting++) {
+		if (unlikely(!me->registered))
+			lkp_rcu_register();
+		__atomic_store_n(&me->ctr,
+				 __atomic_load_n(&lkp_rcu_gp, __ATOMIC_RELAXED),
+				 __ATOMIC_SEQ_CST);
+	}
+}
+
+static inline void rcu_read_unlock(void)
+{
+	struct lkp_rcu_reader *me = &lkp_rcu_me;
+
+	if (!--me->nesting)
+		__atomic_store_n(&me->ctr, 0, __ATOMIC_RELEASE);
+}
+
+void synchronize_rcu(void);
+void rcu_barrier(void);
+void call_rcu(struct rcu_head *head, rcu_callback_t func);
+
+#define rcu_dereference(p)		__atomic_load_n(&(p), __ATOMIC_CONSUME)
+#define rcu_dereference_raw(p)		rcu_dereference(p)
+#define rcu_dereference_check(p, c)	rcu_dereference(p)
+#define rcu_dereference_protected(p, c)	(p)
+#define rcu_access_pointer(p)		READ_ONCE(p)
+#define rcu_assign_pointer(p, v)	__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+#define RCU_INIT_POINTER(p, v)		WRITE_ONCE(p, v)
+
+/* As in the kernel, an offset below 4096 in ->func marks a kfree */
+void __lkp_kvfree_rcu(struct rcu_head *head, unsigned long offset);
+
+#define kfree_rcu(ptr, rhf) \
+	__lkp_kvfree_rcu(&(ptr)->rhf, offsetof(typeof(*(ptr)), rhf))
+#define kvfree_rcu(ptr, rhf)		kfree_rcu(ptr, rhf)
+
+/* ===================================================================
+ * Tasks, CPUs and NUMA nodes
+ * =================================================================== */
+
+#define TASK_RUNNING		0x0000
+#define TASK_INTERRUPTIBLE	0x0001
+#define TASK_UNINTERRUPTIBLE	0x0002
+
+/* A kthread is a pthread; main() runs as a task too */
+struct task_struct {
+	pthread_t thread;
+	int (*threadfn)(void *data);
+	void *data;
+	char comm[16];
+	int cpu;			/* kthread_bind(), -1 = anywhere */
+	int ret;
+	bool started, should_stop, woken;
+	volatile long state;
+	pthread_mutex_t lock;
+	pthread_cond_t wait;
+};
+
+extern __thread struct task_struct *lkp_current;
+#define current			lkp_current
+
+#define set_current_state(s)	__atomic_store_n(&current->state, (s), __ATOMIC_SEQ_CST)
+#define __set_current_state(s)	WRITE_ONCE(current->state, (s))
+
+void schedule(void);
+int wake_up_process(struct task_struct *p);
+
+struct task_struct *kthread_create_on_node(int (*threadfn)(void *data),
+					   void *data, int node,
+					   const char namefmt[], ...)
+	__printf(4, 5);
+#define kthread_create(threadfn, data, namefmt, arg...) \
+	kthread_create_on_node(threadfn, data, NUMA_NO_NODE, namefmt, ##arg)
+void kthread_bind(struct task_struct *k, unsigned int cpu);
+int kthread_stop(struct task_struct *k);
+bool kthread_should_stop(void);
+
+#define preempt_disable()	barrier()
+#define preempt_enable()	barrier()
+#define cond_resched()		((void)0)
+#define might_sleep()		((void)0)
+
+#define NR_CPUS			1024
+
+struct cpumask {
+	unsigned long bits[BITS_TO_LONGS(NR_CPUS)];
+};
+
+extern unsigned int nr_cpu_ids;
+extern struct cpumask __cpu_online_mask;
+#define cpu_online_mask		((const struct cpumask *)&__cpu_online_mask)
+
+static inline bool cpumask_test_cpu(int cpu, const struct cpumask *mask)
+{
+	return cpu >= 0 && (unsigned int)cpu < nr_cpu_ids &&
+	       (mask->bits[cpu / BITS_PER_LONG] >> (cpu % BITS_PER_LONG)) & 1;
+}
+
+static inline unsigned int cpumask_next(int n, const struct cpumask *mask)
+{
+	return find_next_bit(mask->bits, nr_cpu_ids, n + 1);
+}
+
+static inline unsigned int cpumask_first(const struct cpumask *mask)
+{
+	return find_first_bit(mask->bits, nr_cpu_ids);
+}
+
+static inline unsigned int cpumask_first_and(const struct cpumask *a,
+					     const struct cpumask *b)
+{
+	unsigned int cpu;
+
+	for (cpu = cpumask_first(a); cpu < nr_cpu_ids; cpu = cpumask_next(cpu, a))
+		if (cpumask_test_cpu(cpu, b))
+			break;
+	return cpu;
+}
+
+static inline unsigned int cpumask_weight(const struct cpumask *mask)
+{
+	unsigned int i, w = 0;
+
+	for (i = 0; i < BITS_TO_LONGS(NR_CPUS); i++)
+		w += hweight_long(mask->bits[i]);
+	return w;
+}
+
+#define cpu_online(cpu)		cpumask_test_cpu((cpu), cpu_online_mask)
+#define num_online_cpus()	cpumask_weight(cpu_online_mask)
+
+#define for_each_cpu(cpu, mask)						\
+	for ((cpu) = cpumask_first(mask); (cpu) < nr_cpu_ids;		\
+	     (cpu) = cpumask_next((cpu), (mask)))
+#define for_each_online_cpu(cpu) for_each_cpu((cpu), cpu_online_mask)
+
+#define NUMA_NO_NODE		(-1)
+#define NODES_SHIFT		0
+#define MAX_NUMNODES		(1 << NODES_SHIFT)
+#define LOCAL_DISTANCE		10
+#define REMOTE_DISTANCE		20
+
+typedef struct {
+	unsigned long bits[BITS_TO_LONGS(MAX_NUMNODES)];
+} nodemask_t;
+
+enum node_states {
+	N_POSSIBLE,
+	N_ONLINE,
+	N_MEMORY,
+	N_CPU,
+	NR_NODE_STATES
+};
+
+extern nodemask_t node_states[NR_NODE_STATES];
+
+static inline bool node_state(int node, enum node_states state)
+{
+	return node >= 0 && node < MAX_NUMNODES &&
+	       (node_states[state].bits[0] >> node) & 1;
+}
+
+static inline int next_node_in(int node, const nodemask_t srcp)
+{
+	unsigned int ret = find_next_bit(srcp.bits, MAX_NUMNODES, node + 1);
+
+	if (ret == MAX_NUMNODES)
+		ret = find_first_bit(srcp.bits, MAX_NUMNODES);
+	return ret;
+}
+
+#define for_each_node_state(node, state)				\
+	for ((node) = 0; (node) < MAX_NUMNODES; (node)++)		\
+		if (node_state((node), (state)))
+#define for_each_node_with_cpus(node)	for_each_node_state(node, N_CPU)
+#define for_each_online_node(node)	for_each_node_state(node, N_ONLINE)
+
+static inline int num_node_state(enum node_states state)
+{
+	int node, nr = 0;
+
+	for_each_node_state(node, state)
+		nr++;
+	return nr;
+}
+
+#define first_node(mask)	find_first_bit((mask).bits, MAX_NUMNODES)
+#define first_memory_node	((int)first_node(node_states[N_MEMORY]))
+#define first_online_node	((int)first_node(node_states[N_ONLINE]))
+#define node_distance(a, b)	((a) == (b) ? LOCAL_DISTANCE : REMOTE_DISTANCE)
+#define cpu_to_node(cpu)	0
+#define numa_node_id()		0
+#define cpumask_of_node(node)	cpu_online_mask
+
+/* ===================================================================
+ * Time and randomness
+ * =================================================================== */
+
+static inline u64 ktime_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* lib/random32.c, so a seed picks the same keys as in the module */
+struct rnd_state {
+	__u32 s1, s2, s3, s4;
+};
+
+u32 prandom_u32_state(struct rnd_state *state);
+
+static inline u32 __seed(u32 x, u32 m)
+{
+	return (x < m) ? x + m : x;
+}
+
+static inline void prandom_seed_state(struct rnd_state *state, u64 seed)
+{
+	u32 i = ((seed >> 32) ^ (seed << 10) ^ seed) & 0xffffffffUL;
+
+	state->s1 = __seed(i,   2U);
+	state->s2 = __seed(i,   8U);
+	state->s3 = __seed(i,  16U);
+	state->s4 = __seed(i, 128U);
+}
+
+u64 get_random_u64(void);
+
+/* ===================================================================
+ * Memory
+ * =================================================================== */
+
+#define GFP_KERNEL		0x01u
+#define GFP_ATOMIC		0x02u
+#define GFP_NOWAIT		0x04u
+#define __GFP_NOWARN		0x08u
+#define __GFP_ZERO		0x10u
+#define __GFP_THISNODE		0x20u
+
+void *kmalloc(size_t size, gfp_t flags);
+void kfree(const void *objp);
+size_t ksize(const void *objp);
+size_t kmalloc_size_roundup(size_t size);
+char *kstrdup(const char *s, gfp_t gfp);
+
+static inline void *kzalloc(size_t size, gfp_t flags)
+{
+	return kmalloc(size, flags | __GFP_ZERO);
+}
+
+static inline void *kmalloc_array(size_t n, size_t size, gfp_t flags)
+{
+	return kmalloc(size_mul(n, size), flags);
+}
+
+static inline void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+	return kmalloc_array(n, size, flags | __GFP_ZERO);
+}
+
+/* One node: the node arguments are accepted and ignored */
+#define kmalloc_node(size, flags, node)		kmalloc(size, flags)
+#define kvmalloc(size, flags)			kmalloc(size, flags)
+#define kvzalloc(size, flags)			kzalloc(size, flags)
+#define kvmalloc_node(size, flags, node)	kmalloc(size, flags)
+#define kvzalloc_node(size, flags, node)	kzalloc(size, flags)
+#define kvmalloc_array(n, size, flags)		kmalloc_array(n, size, flags)
+#define kvcalloc(n, size, flags)		kcalloc(n, size, flags)
+#define kvfree(p)				kfree(p)
+
+/* Everything comes from malloc(); there is no separate vmalloc area */
+static inline bool is_vmalloc_addr(const void *x)
+{
+	return false;
+}
+
+void *vmalloc_user(unsigned long size);
+#define vmalloc(size)				kmalloc(size, GFP_KERNEL)
+#define vzalloc(size)				kzalloc(size, GFP_KERNEL)
+#define vfree(p)				kfree(p)
+
+/* kmem_cache: sized and aligned malloc() so valgrind and ASan see every object */
+#define SLAB_HWCACHE_ALIGN	0x00002000U
+#define SLAB_PANIC		0x00040000U
+#define SLAB_ACCOUNT		0x04000000U
+
+struct kmem_cache {
+	const char *name;
+	unsigned int object_size;	/* requested */
+	unsigned int size;		/* what an object really takes */
+	unsigned int align;
+	void (*ctor)(void *);
+};
+
+struct kmem_cache *kmem_cache_create(const char *name, unsigned int size,
+				     unsigned int align, unsigned int flags,
+				     void (*ctor)(void *));
+void kmem_cache_destroy(struct kmem_cache *s);
+void *kmem_cache_alloc(struct kmem_cache *s, gfp_t flags);
+void kmem_cache_free(struct kmem_cache *s, void *objp);
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t nr,
+			  void **p);
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t nr, void **p);
+
+#define kmem_cache_alloc_node(s, flags, node)	kmem_cache_alloc(s, flags)
+#define kmem_cache_zalloc(s, flags)		kmem_cache_alloc(s, (flags) | __GFP_ZERO)
+
+static inline unsigned int kmem_cache_size(struct kmem_cache *s)
+{
+	return s->object_size;
+}
+
+#define KMEM_CACHE(__struct, __flags)					\
+	kmem_cache_create(#__struct, sizeof(struct __struct),		\
+			  __alignof__(struct __struct), (__flags), NULL)
+
+/* mempool.h: no reserve, just the callbacks */
+typedef void *(mempool_alloc_t)(gfp_t gfp_mask, void *pool_data);
+typedef void (mempool_free_t)(void *element, void *pool_data);
+
+typedef struct mempool_s {
+	mempool_alloc_t *alloc;
+	mempool_free_t *free;
+	void *pool_data;
+} mempool_t;
+
+mempool_t *mempool_create(int min_nr, mempool_alloc_t *alloc_fn,
+			  mempool_free_t *free_fn, void *pool_data);
+void mempool_destroy(mempool_t *pool);
+
+/* ===================================================================
+ * Strings and library routines
+ * =================================================================== */
+
+int kstrtoint(const char *s, unsigned int base, int *res);
+int kstrtouint(const char *s, unsigned int base, unsigned int *res);
+int kstrtou64(const char *s, unsigned int base, u64 *res);
+int kstrtoull(const char *s, unsigned int base, unsigned long long *res);
+int kstrtobool(const char *s, bool *res);
+char *strim(char *s);
+int match_string(const char * const *array, size_t n, const char *string);
+int scnprintf(char *buf, size_t size, const char *fmt, ...) __printf(3, 4);
+
+/* lib/sort.c's heapsort: same comparison count as in the module */
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp)(const void *, const void *),
+	  void (*swap)(void *, void *, int));
+
+/* <linux/bsearch.h> has libc's signature */
+
+/* ===================================================================
+ * Data structures
+ * =================================================================== */
+
+#include "list.h"
+#include "rbtree.h"
+#include "xarray.h"
+#include "maple_tree.h"
+
+/* lib/btree is not built (no CONFIG_BTREE): declarations only */
+struct btree_head {
+	unsigned long *node;
+	mempool_t *mempool;
+	int height;
+};
+
+struct btree_head64 {
+	struct btree_head h;
+};
+
+static inline int btree_init64(struct btree_head64 *head)
+{
+	return -ENOTSUPP;
+}
+
+static inline void btree_init_mempool64(struct btree_head64 *head,
+					mempool_t *mempool)
+{
+}
+
+static inline void btree_destroy64(struct btree_head64 *head)
+{
+}
+
+static inline void *btree_lookup64(struct btree_head64 *head, u64 key)
+{
+	return NULL;
+}
+
+static inline int btree_insert64(struct btree_head64 *head, u64 key,
+				 void *val, gfp_t gfp)
+{
+	return -ENOTSUPP;
+}
+
+static inline void *btree_remove64(struct btree_head64 *head, u64 key)
+{
+	return NULL;
+}
+
+static inline void *btree_last64(struct btree_head64 *head, u64 *key)
+{
+	return NULL;
+}
+
+static inline void *btree_get_prev64(struct btree_head64 *head, u64 *key)
+{
+	return NULL;
+}
+
+static inline size_t btree_grim_visitor64(struct btree_head64 *head,
+		unsigned long opaque,
+		void (*func)(void *elem, unsigned long opaque, u64 key,
+			     size_t index))
+{
+	return 0;
+}
+
+static inline void *btree_alloc(gfp_t gfp_mask, void *pool_data)
+{
+	return NULL;
+}
+
+static inline void btree_free(void *element, void *pool_data)
+{
+}
+
+/* ===================================================================
+ * Module glue
+ * =================================================================== */
+
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_PARM_DESC(name, desc)
+#define THIS_MODULE		((struct module *)0)
+
+struct module;
+
+enum lkp_user_param_type {
+	LKP_PARAM_charp,
+	LKP_PARAM_int,
+	LKP_PARAM_uint,
+	LKP_PARAM_ullong,
+	LKP_PARAM_bool,
+};
+
+struct lkp_user_param {
+	const char *name;
+	enum lkp_user_param_type type;
+	void *arg;
+	struct lkp_user_param *next;
+};
+
+void lkp_user_param_add(struct lkp_user_param *p);
+
+/* Parameters register themselves before main(), see lkp_user_param_set() */
+#define __lkp_module_param(name, value, ptype)				\
+	static struct lkp_user_param __lkp_param_##name = {		\
+		#name, ptype, &(value), NULL				\
+	};								\
+	static void __attribute__((constructor))			\
+	__lkp_param_init_##name(void)					\
+	{								\
+		lkp_user_param_add(&__lkp_param_##name);		\
+	}
+#define module_param_named(name, value, type, perm)			\
+	__lkp_module_param(name, value, LKP_PARAM_##type)
+#define module_param(name, type, perm)					\
+	__lkp_module_param(name, name, LKP_PARAM_##type)
+
+#define module_init(fn)							\
+	int lkp_user_module_init(void) { return fn(); }
+#define module_exit(fn)							\
+	void lkp_user_module_exit(void) { fn(); }
+
+/* ===================================================================
+ * Files: procfs, seq_file, simple_transaction, misc devices
+ * =================================================================== */
+
+struct proc_dir_entry;
+
+struct inode {
+	struct proc_dir_entry *pde;
+};
+
+struct file {
+	struct inode *f_inode;
+	void *private_data;
+	loff_t f_pos;
+	fmode_t f_mode;
+	unsigned int f_flags;
+};
+
+static inline struct inode *file_inode(const struct file *f)
+{
+	return f->f_inode;
+}
+
+struct proc_ops {
+	unsigned int proc_flags;
+	int	(*proc_open)(struct inode *, struct file *);
+	ssize_t	(*proc_read)(struct file *, char __user *, size_t, loff_t *);
+	ssize_t	(*proc_write)(struct file *, const char __user *, size_t, loff_t *);
+	loff_t	(*proc_lseek)(struct file *, loff_t, int);
+	int	(*proc_release)(struct inode *, struct file *);
+};
+
+struct seq_file {
+	char *buf;
+	size_t size;
+	size_t count;
+	size_t from;
+	loff_t index;
+	bool filled;
+	const struct seq_operations *op;
+	struct file *file;
+	void *private;
+};
+
+struct seq_operations {
+	void * (*start)(struct seq_file *m, loff_t *pos);
+	void (*stop)(struct seq_file *m, void *v);
+	void * (*next)(struct seq_file *m, void *v, loff_t *pos);
+	int (*show)(struct seq_file *m, void *v);
+};
+
+#define SEQ_SKIP 1
+
+struct proc_dir_entry *proc_create(const char *name, umode_t mode,
+				   struct proc_dir_entry *parent,
+				   const struct proc_ops *proc_ops);
+struct proc_dir_entry *proc_create_data(const char *name, umode_t mode,
+					struct proc_dir_entry *parent,
+					const struct proc_ops *proc_ops,
+					void *data);
+struct proc_dir_entry *proc_create_seq_private(const char *name, umode_t mode,
+					       struct proc_dir_entry *parent,
+					       const struct seq_operations *ops,
+					       unsigned int state_size,
+					       void *data);
+void proc_remove(struct proc_dir_entry *de);
+void *pde_data(const struct inode *inode);
+
+int seq_open(struct file *file, const struct seq_operations *op);
+void *__seq_open_private(struct file *file, const struct seq_operations *ops,
+			 int psize);
+int seq_release(struct inode *inode, struct file *file);
+int seq_release_private(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t size,
+		 loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+void seq_printf(struct seq_file *m, const char *fmt, ...) __printf(2, 3);
+void seq_puts(struct seq_file *m, const char *s);
+void seq_putc(struct seq_file *m, char c);
+int single_open(struct file *file, int (*show)(struct seq_file *, void *),
+		void *data);
+int single_release(struct inode *inode, struct file *file);
+
+loff_t noop_llseek(struct file *file, loff_t offset, int whence);
+loff_t default_llseek(struct file *file, loff_t offset, int whence);
+ssize_t simple_read_from_buffer(void __user *to, size_t count, loff_t *ppos,
+				const void *from, size_t available);
+
+struct simple_transaction_argresp {
+	ssize_t size;
+	char data[];
+};
+
+#define SIMPLE_TRANSACTION_LIMIT \
+	(PAGE_SIZE - sizeof(struct simple_transaction_argresp))
+
+char *simple_transaction_get(struct file *file, const char __user *buf,
+			     size_t size);
+void simple_transaction_set(struct file *file, size_t n);
+ssize_t simple_transaction_read(struct file *file, char __user *buf,
+				size_t size, loff_t *pos);
+int simple_transaction_release(struct inode *inode, struct file *file);
+
+/* "User" memory is ordinary memory */
+static inline unsigned long copy_from_user(void *to, const void __user *from,
+					   unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+static inline unsigned long copy_to_user(void __user *to, const void *from,
+					 unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+
+void *memdup_user_nul(const void __user *src, size_t len);
+
+#define VM_WRITE	0x00000002
+#define VM_MAYWRITE	0x00000020
+
+struct vm_area_struct {
+	unsigned long vm_flags;
+	unsigned long vm_pgoff;
+};
+
+static inline void vm_flags_clear(struct vm_area_struct *vma,
+				  unsigned long flags)
+{
+	vma->vm_flags &= ~flags;
+}
+
+static inline int remap_vmalloc_range(struct vm_area_struct *vma, void *addr,
+				      unsigned long pgoff)
+{
+	return -ENODEV;
+}
+
+struct file_operations {
+	struct module *owner;
+	loff_t (*llseek)(struct file *, loff_t, int);
+	ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+	int (*mmap)(struct file *, struct vm_area_struct *);
+	int (*open)(struct inode *, struct file *);
+	int (*release)(struct inode *, struct file *);
+};
+
+#define MISC_DYNAMIC_MINOR	255
+
+struct miscdevice {
+	int minor;
+	const char *name;
+	const struct file_operations *fops;
+	umode_t mode;
+};
+
+static inline int misc_register(struct miscdevice *misc)
+{
+	return 0;
+}
+
+static inline void misc_deregister(struct miscdevice *misc)
+{
+}
+
+/* ---- kref.h ---- */
+
+struct kref {
+	atomic_t refcount;
+};
+
+static inline void kref_init(struct kref *kref)
+{
+	atomic_set(&kref->refcount, 1);
+}
+
+static inline void kref_get(struct kref *kref)
+{
+	atomic_inc(&kref->refcount);
+}
+
+static inline int kref_put(struct kref *kref,
+			   void (*release)(struct kref *kref))
+{
+	if (atomic_dec_and_test(&kref->refcount)) {
+		release(kref);
+		return 1;
+	}
+	return 0;
+}
+
+/* ===================================================================
+ * Workqueues: work runs synchronously in queue_work()
+ *
+ * Nothing in lkp_ds.c waits on its own work item while holding a lock
+ * the work takes, so running it inline keeps the order of events
+ * and makes "run" block until the report is ready.
+ * =================================================================== */
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t func;
+};
+
+struct workqueue_struct;
+
+#define WQ_UNBOUND		(1 << 1)
+#define WQ_MEM_RECLAIM		(1 << 3)
+
+#define __WORK_INITIALIZER(n, f)	{ .func = (f) }
+#define DECLARE_WORK(n, f)		struct work_struct n = __WORK_INITIALIZER(n, f)
+#define INIT_WORK(_work, _func)		((_work)->func = (_func))
+
+extern struct workqueue_struct *system_wq;
+extern struct workqueue_struct *system_unbound_wq;
+
+struct workqueue_struct *alloc_workqueue(const char *fmt, unsigned int flags,
+					 int max_active, ...);
+void destroy_workqueue(struct workqueue_struct *wq);
+
+static inline bool queue_work(struct workqueue_struct *wq,
+			      struct work_struct *work)
+{
+	work->func(work);
+	return true;
+}
+
+static inline bool schedule_work(struct work_struct *work)
+{
+	return queue_work(system_wq, work);
+}
+
+static inline bool cancel_work_sync(struct work_struct *work)
+{
+	return false;
+}
+
+static inline void flush_workqueue(struct workqueue_struct *wq)
+{
+}
+
+/* ===================================================================
+ * perf events: perf_event_open() on the calling thread
+ * =================================================================== */
+
+struct perf_event;
+
+struct perf_event *
+perf_event_create_kernel_counter(struct perf_event_attr *attr, int cpu,
+				 struct task_struct *task,
+				 void *overflow_handler, void *context);
+int perf_event_release_kernel(struct perf_event *event);
+u64 perf_event_read_value(struct perf_event *event, u64 *enabled,
+			  u64 *running);
+
+/* ===================================================================
+ * Userspace driver (user/lkp_user.c, user/baseline.cc)
+ * =================================================================== */
+
+struct bench_probe;
+
+/*
+ * Times the same keys and probes through std::unordered_multimap and
+ * std::multimap, called by run_benchmark() after the module's trials.
+ * @hit, @miss and @mixed are lkp_ds.c's struct bench_probe arrays of
+ * @n entries, @del_order the delete order as positions in @keys.
+ */
+void lkp_user_baseline(int n, int trials, int warmup, int hit_pct,
+		       const u32 *keys, const struct bench_probe *hit,
+		       const struct bench_probe *miss,
+		       const struct bench_probe *mixed,
+		       const u32 *del_order);
+
+#endif /* LKP_USER_H */
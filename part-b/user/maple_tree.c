@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * maple_tree.c - Single-index maple tree stand-in, see user/maple_tree.h
+ */
+#include "lkp_user.h"
+
+struct mt_slot {
+	struct rb_node rb;
+	unsigned long index;
+	void *entry;
+};
+
+#define mt_slot_of(node)	rb_entry(node, struct mt_slot, rb)
+
+/* Entry with the smallest index >= @index */
+static struct mt_slot *mt_ceil(struct maple_tree *mt, unsigned long index)
+{
+	struct rb_node *node = mt->ma_root.rb_node;
+	struct mt_slot *best = NULL, *s;
+
+	while (node) {
+		s = mt_slot_of(node);
+		if (s->index >= index) {
+			best = s;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return best;
+}
+
+static struct mt_slot *mt_exact(struct maple_tree *mt, unsigned long index)
+{
+	struct mt_slot *s = mt_ceil(mt, index);
+
+	return s && s->index == index ? s : NULL;
+}
+
+int mtree_insert(struct maple_tree *mt, unsigned long index, void *entry,
+		 gfp_t gfp)
+{
+	struct rb_node **link = &mt->ma_root.rb_node, *parent = NULL;
+	struct mt_slot *new, *s;
+
+	if (WARN_ON_ONCE(xa_is_internal(entry)))
+		return -EINVAL;
+	new = kmalloc(sizeof(*new), gfp);
+	if (!new)
+		return -ENOMEM;
+	new->index = index;
+	new->entry = entry;
+
+	spin_lock(&mt->ma_lock);
+	while (*link) {
+		parent = *link;
+		s = mt_slot_of(parent);
+		if (index == s->index) {
+			spin_unlock(&mt->ma_lock);
+			kfree(new);
+			return -EEXIST;
+		}
+		link = index < s->index ? &parent->rb_left : &parent->rb_right;
+	}
+	rb_link_node(&new->rb, parent, link);
+	rb_insert_color(&new->rb, &mt->ma_root);
+	spin_unlock(&mt->ma_lock);
+	return 0;
+}
+
+void *mtree_load(struct maple_tree *mt, unsigned long index)
+{
+	struct mt_slot *s;
+	void *entry;
+
+	spin_lock(&mt->ma_lock);
+	s = mt_exact(mt, index);
+	entry = s ? s->entry : NULL;
+	spin_unlock(&mt->ma_lock);
+	return entry;
+}
+
+void *mtree_erase(struct maple_tree *mt, unsigned long index)
+{
+	struct mt_slot *s;
+	void *entry = NULL;
+
+	spin_lock(&mt->ma_lock);
+	s = mt_exact(mt, index);
+	if (s) {
+		rb_erase(&s->rb, &mt->ma_root);
+		entry = s->entry;
+	}
+	spin_unlock(&mt->ma_lock);
+	kfree(s);
+	return entry;
+}
+
+void mtree_destroy(struct maple_tree *mt)
+{
+	struct mt_slot *s, *tmp;
+	struct rb_root root;
+
+	spin_lock(&mt->ma_lock);
+	root = mt->ma_root;
+	mt->ma_root = RB_ROOT;
+	spin_unlock(&mt->ma_lock);
+
+	rbtree_postorder_for_each_entry_safe(s, tmp, &root, rb)
+		kfree(s);
+}
+
+/* On success *@index moves past the entry found, wrapping to 0 at the end */
+void *mt_find(struct maple_tree *mt, unsigned long *index, unsigned long max)
+{
+	struct mt_slot *s;
+	void *entry = NULL;
+
+	spin_lock(&mt->ma_lock);
+	s = mt_ceil(mt, *index);
+	if (s && s->index <= max) {
+		entry = s->entry;
+		*index = s->index + 1;
+	}
+	spin_unlock(&mt->ma_lock);
+	return entry;
+}
+
+void *mt_find_after(struct maple_tree *mt, unsigned long *index,
+		    unsigned long max)
+{
+	if (!(*index))
+		return NULL;
+
+	return mt_find(mt, index, max);
+}
+
+void *mas_find(struct ma_state *mas, unsigned long max)
+{
+	struct mt_slot *s = NULL;
+	void *entry = NULL;
+
+	spin_lock(&mas->tree->ma_lock);
+	if (mas->status == ma_start)
+		s = mt_ceil(mas->tree, mas->index);
+	else if (mas->status == ma_active && mas->last != ULONG_MAX)
+		s = mt_ceil(mas->tree, mas->last + 1);
+
+	if (s && s->index <= max) {
+		mas->index = mas->last = s->index;
+		mas->node = (struct maple_enode *)s;
+		mas->status = ma_active;
+		entry = s->entry;
+	} else {
+		mas->status = ma_overflow;
+	}
+	spin_unlock(&mas->tree->ma_lock);
+	return entry;
+}
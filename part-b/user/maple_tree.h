@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * maple_tree.h - Maple tree API stand-in for the userspace build
+ *
+ * lkp_ds.c only stores single-index entries in its maple trees, so this
+ * is an rbtree of (index, entry) pairs behind the maple calls it makes.
+ * It keeps the int_str structures and /proc/lkp_ds_maple working, but
+ * it is not a maple tree: the benchmark leaves BENCH_MAPLE out of the
+ * userspace build (LKP_BENCH_MAPLE) rather than report its numbers.
+ * Readers take ma_lock too; there is no lockless walk.
+ */
+#ifndef LKP_USER_MAPLE_TREE_H
+#define LKP_USER_MAPLE_TREE_H
+
+#define MT_FLAGS_USE_RCU	0x02
+
+/* Slots per node in the kernel's 64-bit range nodes */
+#define MAPLE_RANGE64_SLOTS	16
+
+struct maple_tree {
+	spinlock_t	ma_lock;
+	unsigned int	ma_flags;
+	struct rb_root	ma_root;
+};
+
+#define MTREE_INIT(name, __flags) {				\
+	.ma_lock = __SPIN_LOCK_UNLOCKED((name).ma_lock),	\
+	.ma_flags = __flags,					\
+	.ma_root = RB_ROOT,					\
+}
+
+#define DEFINE_MTREE(name)					\
+	struct maple_tree name = MTREE_INIT(name, 0)
+
+/* Sized like the kernel's node, for the memory estimate */
+struct maple_node {
+	void *parent;
+	void *slot[31];
+};
+
+/* Opaque; ma_state.node points at the stand-in's rbtree node */
+struct maple_enode;
+
+enum maple_status {
+	ma_active,
+	ma_start,
+	ma_root,
+	ma_none,
+	ma_pause,
+	ma_overflow,
+	ma_underflow,
+	ma_error,
+};
+
+struct ma_state {
+	struct maple_tree *tree;
+	unsigned long index;
+	unsigned long last;
+	struct maple_enode *node;
+	enum maple_status status;
+};
+
+#define MA_STATE(name, mt, first, end)				\
+	struct ma_state name = {				\
+		.tree = mt,					\
+		.index = first,					\
+		.last = end,					\
+		.node = NULL,					\
+		.status = ma_start,				\
+	}
+
+static inline void mt_init_flags(struct maple_tree *mt, unsigned int flags)
+{
+	spin_lock_init(&mt->ma_lock);
+	mt->ma_flags = flags;
+	mt->ma_root = RB_ROOT;
+}
+
+static inline void mt_init(struct maple_tree *mt)
+{
+	mt_init_flags(mt, 0);
+}
+
+static inline bool mtree_empty(const struct maple_tree *mt)
+{
+	return RB_EMPTY_ROOT(&mt->ma_root);
+}
+
+int mtree_insert(struct maple_tree *mt, unsigned long index, void *entry,
+		 gfp_t gfp);
+void *mtree_load(struct maple_tree *mt, unsigned long index);
+void *mtree_erase(struct maple_tree *mt, unsigned long index);
+void mtree_destroy(struct maple_tree *mt);
+void *mt_find(struct maple_tree *mt, unsigned long *index, unsigned long max);
+void *mt_find_after(struct maple_tree *mt, unsigned long *index,
+		    unsigned long max);
+void *mas_find(struct ma_state *mas, unsigned long max);
+
+#define mt_for_each(__tree, __entry, __index, __max) \
+	for (__entry = mt_find(__tree, &(__index), __max); \
+		__entry; __entry = mt_find_after(__tree, &(__index), __max))
+
+#define mas_for_each(__mas, __entry, __max) \
+	while (((__entry) = mas_find((__mas), (__max))) != NULL)
+
+#endif /* LKP_USER_MAPLE_TREE_H */
@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * xarray.c - Radix tree behind user/xarray.h
+ *
+ * xa_head is NULL or a node; each node covers XA_CHUNK_SIZE << shift
+ * indices and the leaves (shift 0) hold the entries.  The tree grows at
+ * the top when an index does not fit, and on erase empty nodes are
+ * freed bottom-up and a root with only slot 0 in use is dropped, as in
+ * lib/xarray.c.  Writers hold xa_lock; readers walk under RCU and nodes
+ * are freed after a grace period, so xa_load() and xa_find() are safe
+ * against a concurrent writer.
+ */
+#include "lkp_user.h"
+
+static inline unsigned long xa_node_max(const struct xa_node *node)
+{
+	/* wraps to ULONG_MAX for the top level of a 64-bit index */
+	return (XA_CHUNK_SIZE << node->shift) - 1;
+}
+
+static inline unsigned int xa_offset(const struct xa_node *node,
+				     unsigned long index)
+{
+	return (index >> node->shift) & XA_CHUNK_MASK;
+}
+
+static struct xa_node *xa_node_alloc(struct xarray *xa, struct xa_node *parent,
+				     unsigned int shift, unsigned int offset)
+{
+	struct xa_node *node = kzalloc(sizeof(*node), GFP_KERNEL);
+
+	if (!node)
+		return NULL;
+	node->shift = shift;
+	node->offset = offset;
+	node->parent = parent;
+	node->array = xa;
+	return node;
+}
+
+static void xa_node_free_rcu(struct rcu_head *head)
+{
+	kfree(container_of(head, struct xa_node, rcu_head));
+}
+
+static void xa_node_free(struct xa_node *node)
+{
+	call_rcu(&node->rcu_head, xa_node_free_rcu);
+}
+
+/* Add levels on top until the root covers @index */
+static struct xa_node *xa_expand(struct xarray *xa, unsigned long index)
+{
+	void *head = xa->xa_head;
+	struct xa_node *node, *top;
+	unsigned int shift = 0;
+
+	if (!head) {
+		while (shift < BITS_PER_LONG - XA_CHUNK_SHIFT &&
+		       index >> shift >= XA_CHUNK_SIZE)
+			shift += XA_CHUNK_SHIFT;
+		node = xa_node_alloc(xa, NULL, shift, 0);
+		if (node)
+			rcu_assign_pointer(xa->xa_head, xa_mk_node(node));
+		return node;
+	}
+
+	node = xa_to_node(head);
+	while (index > xa_node_max(node)) {
+		top = xa_node_alloc(xa, NULL, node->shift + XA_CHUNK_SHIFT, 0);
+		if (!top)
+			return NULL;
+		top->slots[0] = xa_mk_node(node);
+		top->count = 1;
+		WRITE_ONCE(node->parent, top);
+		rcu_assign_pointer(xa->xa_head, xa_mk_node(top));
+		node = top;
+	}
+	return node;
+}
+
+/* Leaf slot for @index, creating the path down to it */
+static void **xa_create(struct xarray *xa, unsigned long index,
+			struct xa_node **leaf)
+{
+	struct xa_node *node = xa_expand(xa, index), *child;
+	unsigned int offset;
+
+	if (!node)
+		return NULL;
+	while (node->shift) {
+		offset = xa_offset(node, index);
+		if (!node->slots[offset]) {
+			child = xa_node_alloc(xa, node,
+					      node->shift - XA_CHUNK_SHIFT, offset);
+			if (!child)
+				return NULL;
+			rcu_assign_pointer(node->slots[offset], xa_mk_node(child));
+			node->count++;
+		}
+		node = xa_to_node(node->slots[offset]);
+	}
+	*leaf = node;
+	return &node->slots[xa_offset(node, index)];
+}
+
+/* Leaf slot for @index if the path to it exists */
+static void **xa_lookup_slot(struct xarray *xa, unsigned long index,
+			     struct xa_node **leaf)
+{
+	void *entry = xa->xa_head;
+	struct xa_node *node;
+
+	if (!xa_is_node(entry) || index > xa_node_max(xa_to_node(entry)))
+		return NULL;
+	for (;;) {
+		node = xa_to_node(entry);
+		entry = node->slots[xa_offset(node, index)];
+		if (!node->shift)
+			break;
+		if (!xa_is_node(entry))
+			return NULL;
+	}
+	*leaf = node;
+	return &node->slots[xa_offset(node, index)];
+}
+
+/* Free empty nodes from @node up, then drop a root that only has slot 0 */
+static void xa_delete_empty(struct xarray *xa, struct xa_node *node)
+{
+	struct xa_node *parent, *root;
+	void *head;
+
+	while (node && !node->count) {
+		parent = node->parent;
+		if (parent) {
+			WRITE_ONCE(parent->slots[node->offset], NULL);
+			parent->count--;
+		} else {
+			WRITE_ONCE(xa->xa_head, NULL);
+		}
+		xa_node_free(node);
+		node = parent;
+	}
+
+	for (;;) {
+		head = xa->xa_head;
+		if (!xa_is_node(head))
+			break;
+		root = xa_to_node(head);
+		if (!root->shift || root->count != 1 || !root->slots[0])
+			break;
+		head = root->slots[0];
+		xa_to_node(head)->parent = NULL;
+		rcu_assign_pointer(xa->xa_head, head);
+		xa_node_free(root);
+	}
+}
+
+void *__xa_store(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp)
+{
+	struct xa_node *leaf;
+	void **slot, *old;
+
+	if (WARN_ON_ONCE(xa_is_internal(entry)))
+		return XA_ERROR(-EINVAL);
+
+	if (!entry) {
+		slot = xa_lookup_slot(xa, index, &leaf);
+		if (!slot || !*slot)
+			return NULL;
+		old = *slot;
+		WRITE_ONCE(*slot, NULL);
+		leaf->count--;
+		xa_delete_empty(xa, leaf);
+		return old;
+	}
+
+	slot = xa_create(xa, index, &leaf);
+	if (!slot)
+		return XA_ERROR(-ENOMEM);
+	old = *slot;
+	rcu_assign_pointer(*slot, entry);
+	if (!old)
+		leaf->count++;
+	return old;
+}
+
+void *xa_store(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp)
+{
+	void *curr;
+
+	xa_lock(xa);
+	curr = __xa_store(xa, index, entry, gfp);
+	xa_unlock(xa);
+	return curr;
+}
+
+void *__xa_erase(struct xarray *xa, unsigned long index)
+{
+	return __xa_store(xa, index, NULL, 0);
+}
+
+void *xa_erase(struct xarray *xa, unsigned long index)
+{
+	void *entry;
+
+	xa_lock(xa);
+	entry = __xa_erase(xa, index);
+	xa_unlock(xa);
+	return entry;
+}
+
+int __xa_insert(struct xarray *xa, unsigned long index, void *entry, gfp_t gfp)
+{
+	struct xa_node *leaf;
+	void **slot, *curr;
+
+	slot = xa_lookup_slot(xa, index, &leaf);
+	if (slot && *slot)
+		return -EBUSY;
+	curr = __xa_store(xa, index, entry, gfp);
+	return xa_err(curr);
+}
+
+void *xas_store(struct xa_state *xas, void *entry)
+{
+	void *curr = __xa_store(xas->xa, xas->xa_index, entry, GFP_KERNEL);
+
+	if (xa_is_err(curr)) {
+		xas->xa_error = xa_err(curr);
+		return NULL;
+	}
+	return curr;
+}
+
+void *xa_load(struct xarray *xa, unsigned long index)
+{
+	struct xa_node *node;
+	void *entry;
+
+	rcu_read_lock();
+	entry = rcu_dereference(xa->xa_head);
+	if (!xa_is_node(entry) || index > xa_node_max(xa_to_node(entry))) {
+		entry = NULL;
+		goto out;
+	}
+	do {
+		node = xa_to_node(entry);
+		entry = rcu_dereference(node->slots[xa_offset(node, index)]);
+	} while (xa_is_node(entry));
+out:
+	rcu_read_unlock();
+	return entry;
+}
+
+/*
+ * First entry at or above *@indexp and at most @max.  An empty slot is
+ * skipped as a whole, and leaving a node restarts from the root, which
+ * avoids following parent pointers that a concurrent expand may move.
+ */
+static void *xa_scan(struct xarray *xa, unsigned long *indexp, unsigned long max)
+{
+	unsigned long index = *indexp;
+	struct xa_node *root, *node;
+	unsigned int offset;
+	void *entry;
+
+	entry = rcu_dereference(xa->xa_head);
+	if (!xa_is_node(entry))
+		return NULL;
+	root = node = xa_to_node(entry);
+	if (index > xa_node_max(root))
+		return NULL;
+
+	while (index <= max) {
+		offset = xa_offset(node, index);
+		entry = rcu_dereference(node->slots[offset]);
+		if (xa_is_node(entry)) {
+			node = xa_to_node(entry);
+			continue;
+		}
+		if (entry) {
+			*indexp = index;
+			return entry;
+		}
+		index = (index | ((1UL << node->shift) - 1)) + 1;
+		if (!index)
+			break;
+		if (offset == XA_CHUNK_MASK) {
+			if (node == root)
+				break;
+			node = root;
+		}
+	}
+	return NULL;
+}
+
+void *xa_find(struct xarray *xa, unsigned long *indexp, unsigned long max,
+	      xa_mark_t filter)
+{
+	void *entry;
+
+	rcu_read_lock();
+	entry = xa_scan(xa, indexp, max);
+	rcu_read_unlock();
+	return entry;
+}
+
+void *xa_find_after(struct xarray *xa, unsigned long *indexp,
+		    unsigned long max, xa_mark_t filter)
+{
+	unsigned long index = *indexp + 1;
+	void *entry;
+
+	if (!index || index > max)
+		return NULL;
+	rcu_read_lock();
+	entry = xa_scan(xa, &index, max);
+	rcu_read_unlock();
+	if (entry)
+		*indexp = index;
+	return entry;
+}
+
+static void xa_free_nodes(struct xa_node *node)
+{
+	unsigned int i;
+
+	for (i = 0; node->shift && i < XA_CHUNK_SIZE; i++)
+		if (xa_is_node(node->slots[i]))
+			xa_free_nodes(xa_to_node(node->slots[i]));
+	xa_node_free(node);
+}
+
+void xa_destroy(struct xarray *xa)
+{
+	void *head;
+
+	xa_lock(xa);
+	head = xa->xa_head;
+	WRITE_ONCE(xa->xa_head, NULL);
+	xa_unlock(xa);
+	if (xa_is_node(head))
+		xa_free_nodes(xa_to_node(head));
+}
@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * xarray.h - Minimal XArray for the userspace build
+ *
+ * The entry encoding (value entries, internal entries, node pointers
+ * tagged with 2) and struct xa_node match <linux/xarray.h>, so lkp_ds.c
+ * can count nodes through xa_head and size them with sizeof().  The
+ * tree itself (user/xarray.c) is a plain 64-way radix tree: no marks,
+ * no multi-index entries, and xas_*() is only the store-and-step subset
+ * lkp_xa_fill() needs.  Stores allocate their nodes under the lock, so
+ * xas_nomem() never asks for a retry.
+ */
+#ifndef LKP_USER_XARRAY_H
+#define LKP_USER_XARRAY_H
+
+#define XA_CHUNK_SHIFT		6
+#define XA_CHUNK_SIZE		(1UL << XA_CHUNK_SHIFT)
+#define XA_CHUNK_MASK		(XA_CHUNK_SIZE - 1)
+#define XA_MAX_MARKS		3
+#define XA_MARK_LONGS		DIV_ROUND_UP(XA_CHUNK_SIZE, BITS_PER_LONG)
+
+/* Entries between two cond_resched() calls in a long xas walk */
+#define XA_CHECK_SCHED		4096
+
+typedef unsigned int xa_mark_t;
+#define XA_PRESENT		((xa_mark_t)8U)
+
+struct xarray {
+	spinlock_t	xa_lock;
+	gfp_t		xa_flags;
+	void __rcu	*xa_head;
+};
+
+#define XARRAY_INIT(name, flags) {				\
+	.xa_lock = __SPIN_LOCK_UNLOCKED(name.xa_lock),		\
+	.xa_flags = flags,					\
+	.xa_head = NULL,					\
+}
+
+#define DEFINE_XARRAY_FLAGS(name, flags)			\
+	struct xarray name = XARRAY_INIT(name, flags)
+#define DEFINE_XARRAY(name) DEFINE_XARRAY_FLAGS(name, 0)
+
+/* Same size as the kernel's, marks included, for the memory reports */
+struct xa_node {
+	unsigned char	shift;		/* Bits remaining in each slot */
+	unsigned char	offset;		/* Slot offset in parent */
+	unsigned char	count;		/* Total entry count */
+	unsigned char	nr_values;	/* Value entry count */
+	struct xa_node __rcu *parent;	/* NULL at top of tree */
+	struct xarray	*array;		/* The array we belong to */
+	struct rcu_head	rcu_head;	/* Used when freeing node */
+	void __rcu	*slots[XA_CHUNK_SIZE];
+	unsigned long	marks[XA_MAX_MARKS][XA_MARK_LONGS];
+};
+
+static inline void *xa_mk_value(unsigned long v)
+{
+	return (void *)((v << 1) | 1);
+}
+
+static inline unsigned long xa_to_value(const void *entry)
+{
+	return (unsigned long)entry >> 1;
+}
+
+static inline bool xa_is_value(const void *entry)
+{
+	return (unsigned long)entry & 1;
+}
+
+static inline void *xa_mk_internal(unsigned long v)
+{
+	return (void *)((v << 2) | 2);
+}
+
+static inline unsigned long xa_to_internal(const void *entry)
+{
+	return (unsigned long)entry >> 2;
+}
+
+static inline bool xa_is_internal(const void *entry)
+{
+	return ((unsigned long)entry & 3) == 2;
+}
+
+#define XA_ERROR(errno)		xa_mk_internal((unsigned long)(errno))
+
+static inline bool xa_is_err(const void *entry)
+{
+	return unlikely(xa_is_internal(entry) &&
+			entry >= xa_mk_internal(-MAX_ERRNO));
+}
+
+static inline int xa_err(void *entry)
+{
+	if (xa_is_err(entry))
+		return (long)entry >> 2;
+	return 0;
+}
+
+static inline bool xa_is_node(const void *entry)
+{
+	return xa_is_internal(entry) && (unsigned long)entry > 4096;
+}
+
+static inline struct xa_node *xa_to_node(const void *entry)
+{
+	return (struct xa_node *)((unsigned long)entry - 2);
+}
+
+static inline void *xa_mk_node(const struct xa_node *node)
+{
+	return (void *)((unsigned long)node | 2);
+}
+
+#define xa_lock(xa)		spin_lock(&(xa)->xa_lock)
+#define xa_unlock(xa)		spin_unlock(&(xa)->xa_lock)
+
+static inline void xa_init_flags(struct xarray *xa, gfp_t flags)
+{
+	spin_lock_init(&xa->xa_lock);
+	xa->xa_flags = flags;
+	xa->xa_head = NULL;
+}
+
+static inline void xa_init(struct xarray *xa)
+{
+	xa_init_flags(xa, 0);
+}
+
+static inline bool xa_empty(const struct xarray *xa)
+{
+	return READ_ONCE(xa->xa_head) == NULL;
+}
+
+void *xa_load(struct xarray *, unsigned long index);
+void *xa_store(struct xarray *, unsigned long index, void *entry, gfp_t);
+void *xa_erase(struct xarray *, unsigned long index);
+void *__xa_store(struct xarray *, unsigned long index, void *entry, gfp_t);
+void *__xa_erase(struct xarray *, unsigned long index);
+int __xa_insert(struct xarray *, unsigned long index, void *entry, gfp_t);
+void *xa_find(struct xarray *xa, unsigned long *index, unsigned long max,
+	      xa_mark_t);
+void *xa_find_after(struct xarray *xa, unsigned long *index,
+		    unsigned long max, xa_mark_t);
+void xa_destroy(struct xarray *);
+
+static inline int xa_insert(struct xarray *xa, unsigned long index,
+			    void *entry, gfp_t gfp)
+{
+	int err;
+
+	xa_lock(xa);
+	err = __xa_insert(xa, index, entry, gfp);
+	xa_unlock(xa);
+	return err;
+}
+
+#define xa_for_each_range(xa, index, entry, start, last)		\
+	for (index = start,						\
+	     entry = xa_find(xa, &index, last, XA_PRESENT);		\
+	     entry;							\
+	     entry = xa_find_after(xa, &index, last, XA_PRESENT))
+
+#define xa_for_each_start(xa, index, entry, start) \
+	xa_for_each_range(xa, index, entry, start, ULONG_MAX)
+
+#define xa_for_each(xa, index, entry) \
+	xa_for_each_start(xa, index, entry, 0)
+
+/* ---- advanced API ---- */
+
+struct xa_state {
+	struct xarray *xa;
+	unsigned long xa_index;
+	int xa_error;
+};
+
+#define XA_STATE(name, array, index)				\
+	struct xa_state name = {				\
+		.xa = array,					\
+		.xa_index = index,				\
+		.xa_error = 0,					\
+	}
+
+#define xas_lock(xas)		xa_lock((xas)->xa)
+#define xas_unlock(xas)		xa_unlock((xas)->xa)
+
+void *xas_store(struct xa_state *, void *entry);
+
+static inline int xas_error(const struct xa_state *xas)
+{
+	return xas->xa_error;
+}
+
+/* There is no cached walk position to drop */
+static inline void xas_reset(struct xa_state *xas)
+{
+}
+
+static inline void xas_next(struct xa_state *xas)
+{
+	xas->xa_index++;
+}
+
+static inline bool xas_nomem(struct xa_state *xas, gfp_t gfp)
+{
+	return false;
+}
+
+#endif /* LKP_USER_XARRAY_H */